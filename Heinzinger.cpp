@@ -1,24 +1,21 @@
 // Contents of PythonWrapper/ADCBoardControlPython/Heinzinger.cpp
 
 #include "headers/CommonIncludes.h" // For std::cerr, std::cout, std::endl from <iostream>
-#include "headers/Error.h" // For Utter
+#include "headers/Error.h" // For Shout
 // LinuxUtils.h is not directly used by Heinzinger class methods, but by the
 // original main() #include "headers/LinuxUtils.h" FGUSBBulk.h and AnalogPSU.h
 // are included via Heinzinger.h
 #include "headers/Heinzinger.h" // Includes the class DECLARATION from Heinzinger.h
 
+#include <algorithm> // For std::min
 #include <climits> // For UINT16_MAX
+#include <sstream> // For dump_trace
+#include <stdexcept> // For the constructors' errors
 #include <cmath> // For fabs, NAN, INFINITY if any string utils use them (though not directly here)
 // #include <vector> // Included via CommonIncludes.h or other headers
 // #include <fstream> // Included via CommonIncludes.h for the original main's
 // ofstream
 
-// This was defined in your original Heinzinger.cpp.
-// It's used in constructor, set_voltage, set_current.
-// For better design, this could be a static const member in Heinzinger.h
-// or passed as a constructor argument if it can vary per instance/board.
-#define BOARD_MAX_VOLT 11.3
-
 // --- Method Definitions for HeinzingerVia16BitDAC ---
 
 // Constructor Implementation
@@ -29,73 +26,222 @@ HeinzingerVia16BitDAC::HeinzingerVia16BitDAC(
                               // member was named max_current
     bool verbose_param,
     double max_input_voltage)
-    : max_volt(max_voltage),                 // Initialize from parameter
+    : Interface(FGAnalogPSUInterface::DeferOpen()), // opened below, once
+      max_volt(max_voltage),                 // Initialize from parameter
       max_curr(max_current_param),           // Initialize from parameter
       verbose(verbose_param),                // Initialize from parameter
       max_analog_in_volt(max_input_voltage), // Initialize from parameter
       // Initialize cache members defined in Heinzinger.h
       set_volt_cache(0.0), set_curr_cache(0.0), relay_cache(false),
-      max_analog_in_volt_bin(0) // Initialize this too
-// Interface member (FGAnalogPSUInterface) is default-constructed
-{
-  Interface.Close();                              // ensure nothing is open
-  if (!Interface.Bridge.OpenDevice(0xA0A0, 0x000C, device_index)) {
-    Utter("Unable to open USB device #" + std::to_string(device_index));
-  }
-  if (!Interface) {
-    Utter("Unable to open interface to analog PSU interface board.\n");
-    // Consider throwing an exception here for better error handling in Python
-  }
+      max_analog_in_volt_bin(0), // Initialize this too
+      verify_setpoints(false), acquisition_errors(0), capture_active(false),
+      capture_owns_acquisition(false), capture_saved_period_ns(0) {
+  Interface.Verbose = this->verbose;
+  Interface.DeviceIndex = device_index; // also used when reopening
+  if (!Interface.Open())
+    throw std::runtime_error("Unable to open USB device #" +
+                             std::to_string(device_index));
+  configure();
+}
+
+// Constructor selecting the board by serial number or port path
+HeinzingerVia16BitDAC::HeinzingerVia16BitDAC(
+    const std::string &serial, const std::string &usb_path,
+    double max_voltage, double max_current_param, bool verbose_param,
+    double max_input_voltage)
+    : Interface(FGAnalogPSUInterface::DeferOpen()),
+      max_volt(max_voltage), max_curr(max_current_param),
+      verbose(verbose_param), max_analog_in_volt(max_input_voltage),
+      set_volt_cache(0.0), set_curr_cache(0.0), relay_cache(false),
+      max_analog_in_volt_bin(0), verify_setpoints(false),
+      acquisition_errors(0), capture_active(false),
+      capture_owns_acquisition(false), capture_saved_period_ns(0) {
+  Interface.Verbose = this->verbose;
+  Interface.Serial = serial;
+  Interface.Path = serial.empty() ? usb_path : std::string();
+  if (!Interface.Open())
+    throw std::runtime_error(
+        "Unable to open USB device " +
+        (serial.empty() ? "at " + usb_path : "with serial " + serial));
+  configure();
+}
+
+// Constructor for boards reached through a caller-provided bridge
+HeinzingerVia16BitDAC::HeinzingerVia16BitDAC(
+    const FGBulkBridge &link, double max_voltage, double max_current_param,
+    bool verbose_param, double max_input_voltage)
+    : Interface(FGAnalogPSUInterface::DeferOpen()),
+      max_volt(max_voltage), max_curr(max_current_param),
+      verbose(verbose_param), max_analog_in_volt(max_input_voltage),
+      set_volt_cache(0.0), set_curr_cache(0.0), relay_cache(false),
+      max_analog_in_volt_bin(0), verify_setpoints(false),
+      acquisition_errors(0), capture_active(false),
+      capture_owns_acquisition(false), capture_saved_period_ns(0) {
+  Interface.AttachBridge(link);
+  configure();
+}
+
+// Constructor for boards simulated below the USB transfer layer
+HeinzingerVia16BitDAC::HeinzingerVia16BitDAC(
+    const FGUSBTransferHook &transfers, double max_voltage,
+    double max_current_param, bool verbose_param, double max_input_voltage)
+    : Interface(FGAnalogPSUInterface::DeferOpen()),
+      max_volt(max_voltage), max_curr(max_current_param),
+      verbose(verbose_param), max_analog_in_volt(max_input_voltage),
+      set_volt_cache(0.0), set_curr_cache(0.0), relay_cache(false),
+      max_analog_in_volt_bin(0), verify_setpoints(false),
+      acquisition_errors(0), capture_active(false),
+      capture_owns_acquisition(false), capture_saved_period_ns(0) {
+  Interface.AttachTransfers(transfers);
+  configure();
+}
+
+// Constructor for boards located once on a shared context (see PSUArray)
+HeinzingerVia16BitDAC::HeinzingerVia16BitDAC(
+    libusb_context *shared_context, libusb_device *device, int device_index,
+    double max_voltage, double max_current_param, bool verbose_param,
+    double max_input_voltage)
+    : Interface(shared_context, device, device_index),
+      max_volt(max_voltage), max_curr(max_current_param),
+      verbose(verbose_param), max_analog_in_volt(max_input_voltage),
+      set_volt_cache(0.0), set_curr_cache(0.0), relay_cache(false),
+      max_analog_in_volt_bin(0), verify_setpoints(false),
+      acquisition_errors(0), capture_active(false),
+      capture_owns_acquisition(false), capture_saved_period_ns(0) {
+  if (!Interface)
+    throw std::runtime_error("Unable to open USB device #" +
+                             std::to_string(device_index));
+  configure();
+}
+
+// Checks and derived values shared by the constructors, once the interface
+// has been opened. Throws instead of exiting, so that Python sees which
+// board failed.
+void HeinzingerVia16BitDAC::configure() {
+  if (!Interface)
+    throw std::runtime_error(
+        "Unable to open interface to analog PSU interface board");
 
   Interface.Verbose = this->verbose; // Use the initialized member 'verbose'
 
-  if (BOARD_MAX_VOLT <
-      this->max_analog_in_volt) { // Use member 'max_analog_in_volt'
-    Utter("The board has insufficient output voltage to control the PSU");
-    // Consider throwing an exception
-  }
+  calibration = FGPSUCalibration(max_volt, max_curr, max_analog_in_volt);
+  if (calibration.BoardMaxVolt <
+      this->max_analog_in_volt) // Use member 'max_analog_in_volt'
+    throw std::invalid_argument(
+        "The board has insufficient output voltage to control the PSU");
 
   // Calculate max_analog_in_volt_bin using member max_analog_in_volt
   this->max_analog_in_volt_bin = static_cast<uint16_t>(
-      UINT16_MAX * (this->max_analog_in_volt / BOARD_MAX_VOLT));
+      UINT16_MAX * (this->max_analog_in_volt / calibration.BoardMaxVolt));
+
+  HeinzingerRampStatus idle = {ramp_state_idle, 0, 0, 0, 0.0, 0.0, NAN, NAN};
+  ramp_state = idle;
+  ramp_start_ns = 0;
+
+  // Default thresholds: 0.1% of full scale, well above the ADC noise
+  change_volt_threshold = max_volt * 1e-3;
+  change_curr_threshold = max_curr * 1e-3;
+  change_reference.ok = false;
+  change_reference.timestamp_ns = 0;
+
+  HeinzingerRegulationStatus stopped = {false, 0, 0, 0, 0,
+                                        0.0, 0.0, 0.0, 0.0};
+  regulation_state = stopped;
+  regulation_last_ns = 0;
+  regulation_sample_ns = 0;
+  volt_loop.Config.Enabled = true; // current regulation is opt-in
+
+  interlock_latched = false;
+  interlock_state.tripped = false;
+  interlock_state.rule = -1;
+  interlock_state.value = NAN;
+  interlock_state.trip_ns = interlock_state.shutdown_ns = 0;
+  interlock_state.trips = 0;
+  interlock_trips = 0;
+  interlock_state.snapshot.ok = false;
+
+  HeinzingerSweepStatus no_sweep = {sweep_state_idle, 0, 0, 0, 0, 0.0};
+  sweep_state = no_sweep;
+  sweep_index = 0;
+  sweep_phase = sweep_step;
+  sweep_step_ns = sweep_start_ns = sweep_end_ns = 0;
+  sweep_attempts = 0;
+  sweep_settled = false;
+  sweep_settle_s = 0;
+}
+
+HeinzingerVia16BitDAC::~HeinzingerVia16BitDAC() {
+  // The worker threads use Interface, so they must be gone first
+  stop_command_queue();
+  cancel_sweep();
+  cancel_ramp();
+  stop_regulation();
+  stop_acquisition();
+  stop_recording();
 }
 
 // Private helper method implementation
 bool HeinzingerVia16BitDAC::update() {
   if (!Interface.Readout()) {
-    std::cerr << "Unable to perform analog PSU interface readout. Will reset "
-                 "interface.\n";
-    // Consider more robust reset logic or error propagation
+    // Query() has already tried to reconnect if the link itself failed
+    std::cerr << "Unable to perform analog PSU interface readout.\n";
     return false;
   } else {
-    // Update cache members if you intend to use them to reflect current state
-    // e.g., this->relay_cache = this->Interface.Relay_val; (assuming Relay_val
-    // exists and is updated in Interface)
-    //      this->set_volt_cache = this->read_voltage(); // but careful about
-    //      re-entrancy or performance
+    // Keep the relay cache in step with the board; the setpoint caches are
+    // updated by the individual setters once their command is accepted.
+    this->relay_cache = this->Interface.Readback.Relay != 0;
     return true;
   }
 }
 
+bool HeinzingerVia16BitDAC::confirm(bool sent, uint8_t mask, uint16_t daca,
+                                    uint16_t dacb, bool relay) {
+  if (!sent)
+    return false;
+  // Query() has already decoded the full status from the command's own
+  // response, so the interface state is fresh without another readout.
+  this->relay_cache = this->Interface.Readback.Relay != 0;
+  if (!this->verify_setpoints)
+    return true;
+
+  if (!update())
+    return false;
+  bool matches = true;
+  if ((mask & FGAnalogPSUInterface::MaskDACA) && Interface.Readback.DACA != daca)
+    matches = false;
+  if ((mask & FGAnalogPSUInterface::MaskDACB) && Interface.Readback.DACB != dacb)
+    matches = false;
+  if ((mask & FGAnalogPSUInterface::MaskRelay) &&
+      (Interface.Readback.Relay != 0) != relay)
+    matches = false;
+  if (!matches)
+    std::cerr << "Readback does not match the commanded setpoint\n";
+  return matches;
+}
+
 // Public method implementations
 bool HeinzingerVia16BitDAC::switch_on() {
-  Interface.SetRelay(true);
-  // Original code had: relay = update(); return relay;
-  // 'relay' was a local variable in your original main's scope or uninitialized
-  // member. Assuming 'update()' returning true means the operation was
-  // successful. If you want to cache the relay state: if (update()) {
-  //     this->relay_cache = Interface.Relay_val; // Assuming Interface updates
-  //     a readable relay state return this->relay_cache;
-  // }
-  // return false;
-  return update(); // Simpler: return true if update (which reads back) is
-                   // successful
+  std::lock_guard<std::recursive_mutex> lock(Interface.QueryMutex);
+  if (interlock_blocks()) // checked under the lock the interlock trips with
+    return false;
+  return confirm(Interface.SetRelay(true), FGAnalogPSUInterface::MaskRelay,
+                 0, 0, true);
 }
 
 bool HeinzingerVia16BitDAC::switch_off() {
-  Interface.SetRelay(false);
-  // Similar logic to switch_on for caching and returning state
-  return update();
+  std::lock_guard<std::recursive_mutex> lock(Interface.QueryMutex);
+  return confirm(Interface.SetRelay(false), FGAnalogPSUInterface::MaskRelay,
+                 0, 0, false);
+}
+
+// Scale factors are precomputed by the calibration; the register saturates
+// at the programming input range (max_analog_in_volt).
+uint16_t HeinzingerVia16BitDAC::voltage_register(double set_val_param) const {
+  return calibration.VoltageRegister(set_val_param);
+}
+
+uint16_t HeinzingerVia16BitDAC::current_register(double set_val_param) const {
+  return calibration.CurrentRegister(set_val_param);
 }
 
 bool HeinzingerVia16BitDAC::set_voltage(
@@ -105,39 +251,17 @@ bool HeinzingerVia16BitDAC::set_voltage(
     return false;
   }
 
-  // Using this-> to be explicit about members
-  double set_percent_of_max = set_val_param / 0.98 / this->max_volt;
-  double required_analog_volt = this->max_analog_in_volt * set_percent_of_max;
-  // Ensure required_analog_volt doesn't exceed max_analog_in_volt (could happen
-  // if set_val_param is at the edge due to 0.98 factor)
-  if (required_analog_volt > this->max_analog_in_volt) {
-    required_analog_volt = this->max_analog_in_volt;
-  }
-  if (required_analog_volt < 0) {
-    required_analog_volt = 0;
-  }
-
-  uint16_t required_register_value = static_cast<uint16_t>(
-      UINT16_MAX * (required_analog_volt / BOARD_MAX_VOLT));
-  if (required_register_value > this->max_analog_in_volt_bin &&
-      this->max_analog_in_volt < BOARD_MAX_VOLT) {
-    // This check is a bit complex. If max_analog_in_volt_bin represents the
-    // true writable max for the analog voltage, use that. The original code
-    // directly calculated required_register_value based on BOARD_MAX_VOLT. If
-    // max_analog_in_volt_bin is the cap for register values due to PSU input
-    // limits: required_register_value =
-    // static_cast<uint16_t>(this->max_analog_in_volt_bin * set_percent_of_max);
-    // This needs careful review of how max_analog_in_volt_bin is intended to be
-    // used. Sticking to your original calculation logic for now:
-  }
-
-  Interface.SetDACA(required_register_value);
-  // if (update()) {
-  //     this->set_volt_cache = set_val_param; // Cache the requested set value
-  //     return true;
-  // }
-  // return false;
-  return update();
+  // The register is computed under the lock that guards the calibration
+  std::lock_guard<std::recursive_mutex> lock(Interface.QueryMutex);
+  uint16_t reg = voltage_register(set_val_param);
+  if (interlock_blocks())
+    return false;
+  if (confirm(Interface.SetDACA(reg), FGAnalogPSUInterface::MaskDACA, reg, 0,
+              false)) {
+    this->set_volt_cache = set_val_param; // Cache the requested set value
+    return true;
+  }
+  return false;
 }
 
 bool HeinzingerVia16BitDAC::set_current(
@@ -147,88 +271,1193 @@ bool HeinzingerVia16BitDAC::set_current(
     return false;
   }
 
-  double set_percent_of_max = set_val_param / 0.98 / this->max_curr;
-  double required_analog_volt = this->max_analog_in_volt * set_percent_of_max;
-  if (required_analog_volt > this->max_analog_in_volt) {
-    required_analog_volt = this->max_analog_in_volt;
+  std::lock_guard<std::recursive_mutex> lock(Interface.QueryMutex);
+  uint16_t reg = current_register(set_val_param);
+  if (interlock_blocks())
+    return false;
+  if (confirm(Interface.SetDACB(reg), FGAnalogPSUInterface::MaskDACB, 0, reg,
+              false)) {
+    this->set_curr_cache = set_val_param;
+    return true;
+  }
+  return false;
+}
+
+HeinzingerSnapshot HeinzingerVia16BitDAC::apply(double volt, double curr,
+                                                int relay) {
+  uint8_t mask = 0;
+  uint16_t daca = 0, dacb = 0;
+
+  // Readback and calibration are only read under the lock
+  std::lock_guard<std::recursive_mutex> lock(Interface.QueryMutex);
+  if (!std::isnan(volt)) {
+    if (volt > this->max_volt || volt < 0) {
+      std::cerr
+          << "Set voltage value lies outside of device's specified range\n";
+      return decode_snapshot(false);
+    }
+    daca = voltage_register(volt);
+    mask |= FGAnalogPSUInterface::MaskDACA;
   }
-  if (required_analog_volt < 0) {
-    required_analog_volt = 0;
+  if (!std::isnan(curr)) {
+    if (curr > this->max_curr || curr < 0) {
+      std::cerr
+          << "Set current value lies outside of device's specified range\n";
+      return decode_snapshot(false);
+    }
+    dacb = current_register(curr);
+    mask |= FGAnalogPSUInterface::MaskDACB;
   }
-  uint16_t required_register_value = static_cast<uint16_t>(
-      UINT16_MAX * (required_analog_volt / BOARD_MAX_VOLT));
+  if (relay >= 0)
+    mask |= FGAnalogPSUInterface::MaskRelay;
 
-  Interface.SetDACB(required_register_value);
-  // if (update()) {
-  //     this->set_curr_cache = set_val_param;
-  //     return true;
-  // }
-  // return false;
-  return update();
+  // The response to the combined command already carries the full readback,
+  // so a single Query() both applies the setpoints and refreshes the state.
+  // Switching off and reading out stay possible while the interlock is tripped
+  bool off_only = (mask & ~FGAnalogPSUInterface::MaskRelay) == 0 && relay <= 0;
+  if (!off_only && interlock_blocks())
+    return decode_snapshot(false);
+  bool ok = confirm(Interface.Set(mask, daca, dacb, relay > 0), mask, daca,
+                    dacb, relay > 0);
+  if (ok) {
+    if (mask & FGAnalogPSUInterface::MaskDACA)
+      this->set_volt_cache = volt;
+    if (mask & FGAnalogPSUInterface::MaskDACB)
+      this->set_curr_cache = curr;
+  }
+  return decode_snapshot(ok);
+}
+
+// The PSU's monitor outputs are 0-10 V for 0-max_volt / 0-max_curr
+double HeinzingerVia16BitDAC::convert_voltage(uint16_t raw) const {
+  return calibration.Voltage(raw);
+}
+
+double HeinzingerVia16BitDAC::convert_current(uint16_t raw) const {
+  return calibration.Current(raw);
+}
+
+FGPSUCalibration HeinzingerVia16BitDAC::get_calibration() const {
+  std::lock_guard<std::recursive_mutex> lock(Interface.QueryMutex);
+  return calibration;
+}
+
+bool HeinzingerVia16BitDAC::set_calibration(const FGPSUCalibration &cal) {
+  // The ranges are checked against without the lock by every setter, so
+  // they stay as constructed; only the analog chain may be recalibrated.
+  if (cal.MaxVolt != max_volt || cal.MaxCurr != max_curr ||
+      cal.MaxInputVolt != max_analog_in_volt) {
+    std::cerr << "A calibration cannot change the PSU's voltage, current or "
+                 "programming input range\n";
+    return false;
+  }
+  if (!(cal.BoardMaxVolt >= max_analog_in_volt) || !(cal.Headroom > 0) ||
+      !(cal.MonitorFullScale > 0) || !(cal.ADCInputScale > 0)) {
+    std::cerr << "The board has insufficient output voltage to control the "
+                 "PSU, or a scale factor is not positive\n";
+    return false;
+  }
+  std::lock_guard<std::recursive_mutex> lock(Interface.QueryMutex);
+  calibration = cal;
+  calibration.Update();
+  max_analog_in_volt_bin = static_cast<uint16_t>(
+      UINT16_MAX * (max_analog_in_volt / calibration.BoardMaxVolt));
+  return true;
+}
+
+bool HeinzingerVia16BitDAC::load_voltage_correction(const std::string &csv) {
+  std::lock_guard<std::recursive_mutex> lock(Interface.QueryMutex);
+  if (!FGPSUCalibration::LoadCorrection(csv, calibration.VoltageCorrection))
+    return Shout("Unable to load voltage correction from " + csv, 0);
+  return true;
+}
+
+bool HeinzingerVia16BitDAC::load_current_correction(const std::string &csv) {
+  std::lock_guard<std::recursive_mutex> lock(Interface.QueryMutex);
+  if (!FGPSUCalibration::LoadCorrection(csv, calibration.CurrentCorrection))
+    return Shout("Unable to load current correction from " + csv, 0);
+  return true;
+}
+
+void HeinzingerVia16BitDAC::clear_corrections() {
+  std::lock_guard<std::recursive_mutex> lock(Interface.QueryMutex);
+  calibration.VoltageCorrection.Clear();
+  calibration.CurrentCorrection.Clear();
+}
+
+HeinzingerSnapshot HeinzingerVia16BitDAC::failed_snapshot() {
+  std::lock_guard<std::recursive_mutex> lock(Interface.QueryMutex);
+  return decode_snapshot(false);
+}
+
+HeinzingerSnapshot HeinzingerVia16BitDAC::decode_snapshot(bool ok) {
+  HeinzingerSnapshot snap;
+  snap.ok = ok;
+  snap.voltage = convert_voltage(Interface.Readback.ADCB[2]);
+  snap.current = convert_current(Interface.Readback.ADCB[3]);
+  snap.relay = Interface.Readback.Relay != 0;
+  snap.daca = Interface.Readback.DACA;
+  snap.dacb = Interface.Readback.DACB;
+  snap.sequence_no = Interface.Readback.SequenceNo;
+  snap.errors = Interface.Readback.Response;
+  snap.timestamp_ns = FGMonotonicNs();
+  for (int i = 0; i < 4; ++i) {
+    snap.adca[i] = Interface.Readback.ADCA[i];
+    snap.adcb[i] = Interface.Readback.ADCB[i];
+  }
+  if (ok)
+    this->relay_cache = snap.relay;
+  return snap;
 }
 
 double HeinzingerVia16BitDAC::read_voltage() {
+  if (acquisition.IsRunning()) { // served from the acquisition cache
+    HeinzingerSnapshot snap = latest();
+    return snap.ok ? snap.voltage : -1.0; // same sentinel as below
+  }
+  // Hold the query lock so another thread cannot overwrite ADCB in between
+  std::lock_guard<std::recursive_mutex> lock(Interface.QueryMutex);
   if (!Interface.Readout()) { // Ensure data is fresh
     std::cerr << "Failed to readout interface for voltage reading."
               << std::endl;
     return -1.0; // Or some other error indicator, or throw exception
   }
 
-  uint16_t readout_register_value =
-      Interface.ADCB[2]; // Assuming ADCB is populated by Readout()
-  // Constants from your original code for conversion:
-  const double adc_conversion_factor = 3.2 * 3.3 * 1.12;
-  double readout_analog_volt =
-      adc_conversion_factor * readout_register_value / UINT16_MAX;
-  // The PSU's analog input for voltage monitoring is 0-10V, representing
-  // 0-max_volt
-  double converted_output_volt = this->max_volt * readout_analog_volt / 10.0;
-
-  return converted_output_volt;
+  // Assuming ADCB is populated by Readout()
+  return convert_voltage(Interface.Readback.ADCB[2]);
 }
 
 double HeinzingerVia16BitDAC::read_current() {
+  if (acquisition.IsRunning()) {
+    HeinzingerSnapshot snap = latest();
+    return snap.ok ? snap.current : -1.0;
+  }
+  std::lock_guard<std::recursive_mutex> lock(Interface.QueryMutex);
   if (!Interface.Readout()) { // Ensure data is fresh
     std::cerr << "Failed to readout interface for current reading."
               << std::endl;
     return -1.0; // Or some other error indicator, or throw exception
   }
 
-  uint16_t readout_register_value =
-      Interface.ADCB[3]; // Assuming ADCB is populated by Readout()
-  const double adc_conversion_factor = 3.2 * 3.3 * 1.12;
-  double readout_analog_volt =
-      adc_conversion_factor * readout_register_value / UINT16_MAX;
-  // The PSU's analog input for current monitoring is 0-10V, representing
-  // 0-max_curr
-  double converted_output_curr = this->max_curr * readout_analog_volt / 10.0;
+  // Assuming ADCB is populated by Readout()
+  return convert_current(Interface.Readback.ADCB[3]);
+}
+
+HeinzingerSnapshot HeinzingerVia16BitDAC::read_snapshot() {
+  if (acquisition.IsRunning())
+    return latest();
+  // One Query() carries ADC, DAC readback, relay and error word together, so
+  // decode all of them from the same response instead of reading twice.
+  std::lock_guard<std::recursive_mutex> lock(Interface.QueryMutex);
+  bool ok = Interface.Readout();
+  if (!ok)
+    std::cerr << "Failed to readout interface for snapshot." << std::endl;
+  return decode_snapshot(ok);
+}
+
+bool HeinzingerVia16BitDAC::set_async_usb(
+    bool enable, std::shared_ptr<FGUSBEventLoop> shared_loop) {
+  std::lock_guard<std::recursive_mutex> lock(Interface.QueryMutex);
+  if (!enable) {
+    Interface.Bridge.DisableAsync();
+    return true;
+  }
+  return Interface.Bridge.EnableAsync(shared_loop);
+}
+
+bool HeinzingerVia16BitDAC::acquire_once() {
+  HeinzingerSnapshot snap;
+  bool valid_frame;
+  {
+    std::lock_guard<std::recursive_mutex> lock(Interface.QueryMutex);
+    snap = decode_snapshot(Interface.Readout());
+    // A critical error word fails the readout but still comes with a valid
+    // frame, and is exactly what ErrorWord rules are for.
+    valid_frame = snap.ok || Interface.FrameValid;
+    if (valid_frame)
+      check_interlock(snap);
+    bool capturing = capture_active.load(std::memory_order_relaxed);
+    if (snap.ok && (capturing || shared_telemetry)) {
+      FGCaptureSample sample;
+      sample.timestamp_ns = snap.timestamp_ns;
+      sample.sequence_no = snap.sequence_no;
+      sample.errors = snap.errors;
+      sample.daca = snap.daca;
+      sample.dacb = snap.dacb;
+      for (int i = 0; i < 4; ++i) {
+        sample.adca[i] = snap.adca[i];
+        sample.adcb[i] = snap.adcb[i];
+      }
+      if (capturing)
+        capture_ring.Push(sample);
+      if (shared_telemetry) {
+        shared_telemetry->Publish(snap);
+        shared_telemetry->Push(sample);
+      }
+    }
+    std::lock_guard<std::mutex> rec_lock(recorder_mutex);
+    if (snap.ok && recorder) {
+      FGRecordSample record;
+      memset(&record, 0, sizeof(record));
+      record.timestamp_ns = snap.timestamp_ns;
+      record.sequence_no = snap.sequence_no;
+      record.errors = snap.errors;
+      record.daca = snap.daca;
+      record.dacb = snap.dacb;
+      for (int i = 0; i < 4; ++i) {
+        record.adca[i] = snap.adca[i];
+        record.adcb[i] = snap.adcb[i];
+      }
+      record.relay = snap.relay ? 1 : 0;
+      recorder->Push(record);
+    }
+  }
+  // Failed cycles are published too, so that readers of latest() see the
+  // link is down instead of the last good values with ok set.
+  latest_snapshot.Store(snap);
+  if (valid_frame)
+    detect_change(snap); // error word changes included
+  if (!snap.ok)
+    acquisition_errors.fetch_add(1, std::memory_order_relaxed);
+  return true; // keep polling; a failed readout is retried next period
+}
+
+void HeinzingerVia16BitDAC::detect_change(const HeinzingerSnapshot &snap) {
+  const HeinzingerSnapshot &ref = change_reference;
+  unsigned reasons = 0;
+  if (ref.timestamp_ns == 0) { // no event yet
+    reasons = change_voltage | change_current | change_relay | change_errors;
+  } else {
+    if (std::fabs(snap.voltage - ref.voltage) > change_volt_threshold.load())
+      reasons |= change_voltage;
+    if (std::fabs(snap.current - ref.current) > change_curr_threshold.load())
+      reasons |= change_current;
+    if (snap.relay != ref.relay)
+      reasons |= change_relay;
+    if (snap.errors != ref.errors)
+      reasons |= change_errors;
+  }
+  if (reasons == 0)
+    return;
+  change_reference = snap;
+  HeinzingerChange event;
+  event.sequence = changes.GetSequence() + 1; // the only publisher
+  event.reasons = reasons;
+  event.snapshot = snap;
+  changes.Publish(event);
+}
+
+void HeinzingerVia16BitDAC::check_interlock(const HeinzingerSnapshot &snap) {
+  if (interlock_latched) {
+    if (interlock_state.shutdown_ns == 0)
+      interlock_shutdown(); // the last attempt was not acknowledged
+    return;
+  }
+  if (interlock.Empty())
+    return;
+  double value = NAN;
+  int rule = interlock.Evaluate(snap.timestamp_ns, snap.voltage, snap.current,
+                                snap.errors, snap.relay, value);
+  if (rule < 0)
+    return;
+
+  // Act first, bookkeeping afterwards
+  interlock_latched = true;
+  interlock_state.shutdown_ns = 0;
+  interlock_shutdown();
+  interlock_state.tripped = true;
+  interlock_state.rule = rule;
+  interlock_state.rule_name = interlock.GetRules()[rule].Name;
+  interlock_state.value = value;
+  interlock_state.trip_ns = snap.timestamp_ns;
+  interlock_trips = ++interlock_state.trips;
+  interlock_state.snapshot = snap;
+  std::cerr << "Interlock tripped by rule " << interlock_state.rule_name
+            << " (value " << value << "); output switched off until "
+            << "reset_interlock()\n";
+
+  HeinzingerChange event;
+  event.sequence = changes.GetSequence() + 1; // the only publisher
+  event.reasons = change_interlock;
+  event.snapshot = snap;
+  changes.Publish(event);
+}
+
+bool HeinzingerVia16BitDAC::interlock_shutdown() {
+  bool ok = Interface.Set(FGAnalogPSUInterface::MaskDACA |
+                              FGAnalogPSUInterface::MaskDACB |
+                              FGAnalogPSUInterface::MaskRelay,
+                          0, 0, false);
+  if (!ok)
+    return false;
+  interlock_state.shutdown_ns = FGMonotonicNs();
+  this->set_volt_cache = 0.0;
+  this->set_curr_cache = 0.0;
+  this->relay_cache = false;
+  return true;
+}
+
+// Silent: the trip itself was reported once when it latched.
+bool HeinzingerVia16BitDAC::interlock_blocks() const {
+  return interlock_latched;
+}
+
+bool HeinzingerVia16BitDAC::add_interlock_rule(const FGInterlockRule &rule) {
+  std::lock_guard<std::recursive_mutex> lock(Interface.QueryMutex);
+  if (!interlock.Add(rule)) {
+    std::cerr << "Invalid interlock rule " << rule.Name << "\n";
+    return false;
+  }
+  return true;
+}
+
+void HeinzingerVia16BitDAC::clear_interlock_rules() {
+  std::lock_guard<std::recursive_mutex> lock(Interface.QueryMutex);
+  interlock.Clear();
+}
+
+std::vector<FGInterlockRule> HeinzingerVia16BitDAC::interlock_rules() const {
+  std::lock_guard<std::recursive_mutex> lock(Interface.QueryMutex);
+  return interlock.GetRules();
+}
+
+HeinzingerInterlockStatus HeinzingerVia16BitDAC::interlock_status() const {
+  std::lock_guard<std::recursive_mutex> lock(Interface.QueryMutex);
+  return interlock_state;
+}
+
+bool HeinzingerVia16BitDAC::reset_interlock() {
+  std::lock_guard<std::recursive_mutex> lock(Interface.QueryMutex);
+  if (interlock_latched && interlock_state.shutdown_ns == 0) {
+    std::cerr << "Interlock shutdown not acknowledged by the board yet\n";
+    return false;
+  }
+  interlock.Reset();
+  interlock_state.tripped = false;
+  interlock_latched = false;
+  return true;
+}
+
+bool HeinzingerVia16BitDAC::start_shared_telemetry(const std::string &name,
+                                                   size_t capacity) {
+  std::unique_ptr<FGTelemetryPublisher<HeinzingerSnapshot>> publisher(
+      new FGTelemetryPublisher<HeinzingerSnapshot>());
+  if (!publisher->Create(name, capacity))
+    return Shout("Unable to create shared telemetry segment " + name, 0);
+  std::lock_guard<std::recursive_mutex> lock(Interface.QueryMutex);
+  HeinzingerSnapshot snap = latest_snapshot.Load();
+  if (snap.ok)
+    publisher->Publish(snap); // readers see the current state right away
+  shared_telemetry = std::move(publisher);
+  return true;
+}
+
+void HeinzingerVia16BitDAC::stop_shared_telemetry() {
+  std::lock_guard<std::recursive_mutex> lock(Interface.QueryMutex);
+  shared_telemetry.reset();
+}
+
+std::string HeinzingerVia16BitDAC::shared_telemetry_name() const {
+  std::lock_guard<std::recursive_mutex> lock(Interface.QueryMutex);
+  return shared_telemetry ? shared_telemetry->GetName() : std::string();
+}
+
+bool HeinzingerVia16BitDAC::start_recording(const std::string &path,
+                                            const std::string &comment) {
+  FGRecordingHeader header;
+  memset(&header, 0, sizeof(header));
+  {
+    std::lock_guard<std::recursive_mutex> lock(Interface.QueryMutex);
+    header.MaxVoltage = calibration.MaxVolt;
+    header.MaxCurrent = calibration.MaxCurr;
+    header.VoltsPerCount = calibration.VoltsPerCount();
+    header.AmpsPerCount = calibration.AmpsPerCount();
+  }
+  header.StartNs = FGMonotonicNs();
+  header.StartUnixNs =
+      std::chrono::duration_cast<std::chrono::nanoseconds>(
+          std::chrono::system_clock::now().time_since_epoch())
+          .count();
+  strncpy(header.Comment, comment.c_str(), sizeof(header.Comment) - 1);
+
+  stop_recording();
+  std::unique_ptr<FGRecorder> rec(new FGRecorder());
+  if (!rec->Open(path, header))
+    return Shout("Unable to create recording " + path, 0);
+  std::lock_guard<std::mutex> lock(recorder_mutex);
+  recorder = std::move(rec);
+  return true;
+}
+
+bool HeinzingerVia16BitDAC::stop_recording() {
+  std::unique_ptr<FGRecorder> rec;
+  {
+    std::lock_guard<std::mutex> lock(recorder_mutex);
+    rec = std::move(recorder);
+  }
+  // Flushing may take a while; do it without holding up the acquisition
+  if (rec && !rec->Close())
+    return Shout("Recording " + rec->GetPath() + " is incomplete", 0);
+  return true;
+}
+
+bool HeinzingerVia16BitDAC::recording() const {
+  std::lock_guard<std::mutex> lock(recorder_mutex);
+  return recorder != nullptr;
+}
+
+void HeinzingerVia16BitDAC::set_change_thresholds(double volt, double curr) {
+  change_volt_threshold = volt;
+  change_curr_threshold = curr;
+}
+
+bool HeinzingerVia16BitDAC::wait_for_change(uint64_t after, double timeout_s,
+                                            HeinzingerChange &out) const {
+  uint64_t seq;
+  return changes.Wait(after, timeout_s, out, seq);
+}
+
+int HeinzingerVia16BitDAC::subscribe(
+    const std::function<void(const HeinzingerChange &)> &fn) {
+  return changes.Subscribe(fn);
+}
+
+bool HeinzingerVia16BitDAC::unsubscribe(int id) {
+  return changes.Unsubscribe(id);
+}
+
+void HeinzingerVia16BitDAC::set_verbose(bool on) {
+  std::lock_guard<std::recursive_mutex> lock(Interface.QueryMutex);
+  verbose = on;
+  Interface.Verbose = on;
+}
+
+std::string HeinzingerVia16BitDAC::dump_trace() const {
+  std::ostringstream out;
+  Interface.DumpTrace(out);
+  return out.str();
+}
+
+bool HeinzingerVia16BitDAC::reconnect() { return Interface.Reconnect(); }
+
+void HeinzingerVia16BitDAC::set_auto_reconnect(bool enable) {
+  std::lock_guard<std::recursive_mutex> lock(Interface.QueryMutex);
+  Interface.AutoReconnect = enable;
+}
+
+bool HeinzingerVia16BitDAC::get_auto_reconnect() const {
+  std::lock_guard<std::recursive_mutex> lock(Interface.QueryMutex);
+  return Interface.AutoReconnect;
+}
+
+FGUSBTransferPolicy HeinzingerVia16BitDAC::get_readout_policy() const {
+  std::lock_guard<std::recursive_mutex> lock(Interface.QueryMutex);
+  return Interface.ReadoutPolicy;
+}
+
+void HeinzingerVia16BitDAC::set_readout_policy(
+    const FGUSBTransferPolicy &policy) {
+  std::lock_guard<std::recursive_mutex> lock(Interface.QueryMutex);
+  Interface.ReadoutPolicy = policy;
+}
+
+FGUSBTransferPolicy HeinzingerVia16BitDAC::get_command_policy() const {
+  std::lock_guard<std::recursive_mutex> lock(Interface.QueryMutex);
+  return Interface.CommandPolicy;
+}
+
+void HeinzingerVia16BitDAC::set_command_policy(
+    const FGUSBTransferPolicy &policy) {
+  std::lock_guard<std::recursive_mutex> lock(Interface.QueryMutex);
+  Interface.CommandPolicy = policy;
+}
+
+static void add_histogram(std::map<std::string, double> &out,
+                          const std::string &name,
+                          const FGLatencyHistogram &h) {
+  out[name + "_count"] = (double)h.Count();
+  out[name + "_mean_us"] = h.Mean() * 1e-3;
+  out[name + "_p50_us"] = h.Percentile(0.50) * 1e-3;
+  out[name + "_p90_us"] = h.Percentile(0.90) * 1e-3;
+  out[name + "_p99_us"] = h.Percentile(0.99) * 1e-3;
+  out[name + "_max_us"] = h.Max() * 1e-3;
+}
+
+std::map<std::string, double> HeinzingerVia16BitDAC::stats() const {
+  const FGQueryStats &q = Interface.Stats;
+  const FGUSBStats &u = Interface.Bridge.Stats;
+  std::map<std::string, double> out;
+  add_histogram(out, "query", q.QueryLatency);
+  add_histogram(out, "usb_write", u.WriteLatency);
+  add_histogram(out, "usb_read", u.ReadLatency);
+  add_histogram(out, "usb_transact", u.TransactLatency);
+  out["queries"] = (double)q.Queries.load();
+  out["comm_failures"] = (double)q.CommFailures.load();
+  out["magic_failures"] = (double)q.MagicFailures.load();
+  out["checksum_failures"] = (double)q.ChecksumFailures.load();
+  out["status_f00"] = (double)q.StatusF00.load();
+  out["device_errors"] = (double)q.DeviceErrors.load();
+  out["usb_transfers"] = (double)u.Transfers.load();
+  out["usb_transfer_failures"] = (double)u.TransferFailures.load();
+  out["usb_retries_mean"] = u.Retries.Mean();
+  out["usb_retries_max"] = (double)u.Retries.Max();
+  out["usb_reopens"] = (double)u.Reopens.load();
+  add_histogram(out, "reconnect", q.ReconnectLatency);
+  out["reconnects"] = (double)q.Reconnects.load();
+  out["reconnect_failures"] = (double)q.ReconnectFailures.load();
+  out["acquisition_errors"] = (double)acquisition_errors.load();
+  out["acquisition_overruns"] = (double)acquisition.GetOverruns();
+  const FGCoalescingQueue<HeinzingerSnapshot>::Counters &c =
+      command_queue.GetCounters();
+  out["queue_submitted"] = (double)c.Submitted.load();
+  out["queue_commands"] = (double)c.Batches.load();
+  out["queue_largest_batch"] = (double)c.Largest.load();
+  out["interlock_trips"] = (double)interlock_trips.load();
+  out["interlock_tripped"] = interlock_latched ? 1.0 : 0.0;
+  std::lock_guard<std::mutex> lock(recorder_mutex);
+  if (recorder) {
+    out["recording_records"] = (double)recorder->GetRecords();
+    out["recording_dropped"] = (double)recorder->GetDropped();
+    out["recording_bytes"] = (double)recorder->GetBytesWritten();
+    out["recording_write_errors"] = (double)recorder->GetWriteErrors();
+  }
+  return out;
+}
+
+void HeinzingerVia16BitDAC::reset_stats() {
+  Interface.Stats.Reset();
+  Interface.Bridge.Stats.Reset();
+}
+
+bool HeinzingerVia16BitDAC::start_acquisition(double rate_hz) {
+  // One caller primes and starts; the seqlock allows a single writer
+  std::lock_guard<std::mutex> lock(acquisition_start_mutex);
+  if (acquisition.IsRunning()) {
+    acquisition.SetRate(rate_hz); // just retune the running loop
+    return true;
+  }
+  // Prime the cache so that readers never see an empty snapshot once
+  // acquisition_running() reports true.
+  acquire_once();
+  return acquisition.Start(rate_hz, [this]() { return acquire_once(); });
+}
+
+void HeinzingerVia16BitDAC::stop_acquisition() {
+  std::lock_guard<std::mutex> lock(acquisition_start_mutex);
+  capture_active = false; // a capture cannot outlive its producer
+  acquisition.Stop();
+}
+
+bool HeinzingerVia16BitDAC::start_capture(size_t capacity, double rate_hz) {
+  if (capacity == 0) {
+    std::cerr << "Capture capacity must be non-zero\n";
+    return false;
+  }
+  stop_capture();
+  {
+    // The acquisition thread pushes while holding the query lock, so this
+    // is the only safe moment to swap the storage underneath it.
+    std::lock_guard<std::recursive_mutex> lock(Interface.QueryMutex);
+    capture_ring.Allocate(capacity);
+    capture_active = true;
+  }
+  if (acquisition.IsRunning()) {
+    capture_owns_acquisition = false;
+    capture_saved_period_ns = acquisition.GetPeriodNs();
+    acquisition.SetRate(rate_hz);
+    return true;
+  }
+  capture_owns_acquisition = true;
+  if (!start_acquisition(rate_hz)) {
+    capture_active = false;
+    return false;
+  }
+  return true;
+}
+
+void HeinzingerVia16BitDAC::stop_capture() {
+  if (!capture_active.exchange(false))
+    return;
+  if (capture_owns_acquisition)
+    acquisition.Stop();
+  else
+    acquisition.SetPeriodNs(capture_saved_period_ns);
+  capture_owns_acquisition = false;
+}
+
+bool HeinzingerVia16BitDAC::start_ramp(const std::vector<FGRampPoint> &points,
+                                       double update_hz) {
+  if (points.empty()) {
+    std::cerr << "A ramp needs at least one point\n";
+    return false;
+  }
+  if (!(update_hz > 0)) {
+    std::cerr << "Ramp update rate must be positive\n";
+    return false;
+  }
+  for (const FGRampPoint &p : points) {
+    if (!std::isnan(p.Voltage) && (p.Voltage > max_volt || p.Voltage < 0)) {
+      std::cerr << "Ramp voltage lies outside of device's specified range\n";
+      return false;
+    }
+    if (!std::isnan(p.Current) && (p.Current > max_curr || p.Current < 0)) {
+      std::cerr << "Ramp current lies outside of device's specified range\n";
+      return false;
+    }
+  }
+  FGRampProfile profile;
+  if (!profile.Assign(points)) {
+    std::cerr << "Ramp point times must be non-negative and non-decreasing\n";
+    return false;
+  }
+
+  cancel_ramp();
+  {
+    std::lock_guard<std::mutex> lock(ramp_mutex);
+    ramp_profile = profile;
+    HeinzingerRampStatus running = {ramp_state_running, 0, 0, 0, 0.0,
+                                    profile.Duration(), NAN, NAN};
+    ramp_state = running;
+    ramp_log.clear();
+    ramp_log.reserve((size_t)(profile.Duration() * update_hz) + 2);
+    ramp_start_ns = FGMonotonicNs();
+  }
+  return ramp_task.Start(update_hz, [this]() { return ramp_once(); });
+}
+
+bool HeinzingerVia16BitDAC::ramp_to(double volt, double volt_slew,
+                                    double curr, double curr_slew,
+                                    double update_hz) {
+  double v0 = get_set_voltage(), c0 = get_set_current();
+  double duration = 0;
+  if (!std::isnan(volt) && volt_slew > 0)
+    duration = std::max(duration, std::fabs(volt - v0) / volt_slew);
+  if (!std::isnan(curr) && curr_slew > 0)
+    duration = std::max(duration, std::fabs(curr - c0) / curr_slew);
+
+  // Both channels arrive together, paced by the slower of the two
+  std::vector<FGRampPoint> points;
+  if (duration > 0) {
+    FGRampPoint from = {0.0, std::isnan(volt) ? NAN : v0,
+                        std::isnan(curr) ? NAN : c0};
+    points.push_back(from);
+  }
+  FGRampPoint to = {duration, volt, curr};
+  points.push_back(to);
+  return start_ramp(points, update_hz);
+}
+
+bool HeinzingerVia16BitDAC::ramp_once() {
+  uint64_t start_ns, overruns = ramp_task.GetOverruns();
+  FGRampPoint target;
+  bool last;
+  {
+    std::lock_guard<std::mutex> lock(ramp_mutex);
+    start_ns = ramp_start_ns;
+    double t = (FGMonotonicNs() - start_ns) * 1e-9;
+    target = ramp_profile.At(t);
+    last = t >= ramp_profile.Duration();
+  }
+
+  HeinzingerSnapshot snap = apply(target.Voltage, target.Current, -1);
+
+  std::lock_guard<std::mutex> lock(ramp_mutex);
+  HeinzingerRampStatus &st = ramp_state;
+  st.steps++;
+  if (!snap.ok)
+    st.failed_steps++;
+  st.overruns = overruns;
+  st.elapsed_s = (snap.timestamp_ns - start_ns) * 1e-9;
+  if (!std::isnan(target.Voltage))
+    st.voltage = target.Voltage;
+  if (!std::isnan(target.Current))
+    st.current = target.Current;
+  ramp_log.push_back(snap);
+  if (!last)
+    return true;
+  st.state = snap.ok ? ramp_state_done : ramp_state_failed;
+  return false;
+}
+
+void HeinzingerVia16BitDAC::cancel_ramp() {
+  ramp_task.Stop();
+  std::lock_guard<std::mutex> lock(ramp_mutex);
+  if (ramp_state.state == ramp_state_running)
+    ramp_state.state = ramp_state_cancelled;
+}
+
+HeinzingerRampStatus HeinzingerVia16BitDAC::ramp_status() const {
+  std::lock_guard<std::mutex> lock(ramp_mutex);
+  HeinzingerRampStatus st = ramp_state;
+  if (st.state == ramp_state_running)
+    st.elapsed_s = (FGMonotonicNs() - ramp_start_ns) * 1e-9;
+  return st;
+}
+
+std::vector<HeinzingerSnapshot> HeinzingerVia16BitDAC::ramp_readback() const {
+  std::lock_guard<std::mutex> lock(ramp_mutex);
+  return ramp_log;
+}
+
+bool HeinzingerVia16BitDAC::start_sweep(const std::vector<double> &points,
+                                        const FGSweepConfig &config) {
+  if (points.empty()) {
+    std::cerr << "A sweep needs at least one point\n";
+    return false;
+  }
+  double limit = config.SweepCurrent ? max_curr : max_volt;
+  for (double p : points) {
+    if (!(p >= 0 && p <= limit)) {
+      std::cerr << "Sweep point lies outside of device's specified range\n";
+      return false;
+    }
+  }
+  if (config.SamplesPerPoint == 0 || !(config.SettleTime >= 0) ||
+      std::isinf(config.SettleTime) || config.SettleTolerance < 0) {
+    std::cerr << "Sweep needs samples per point >= 1, a finite settle time "
+                 "and a non-negative settle tolerance\n";
+    return false;
+  }
+
+  cancel_sweep();
+  sweep_points = points;
+  sweep_config = config;
+  sweep_index = 0;
+  sweep_phase = sweep_step;
+  sweep_volts.reserve(config.SamplesPerPoint);
+  sweep_currs.reserve(config.SamplesPerPoint);
+  {
+    std::lock_guard<std::mutex> lock(sweep_mutex);
+    HeinzingerSweepStatus running = {sweep_state_running, 0, points.size(),
+                                     0, 0, 0.0};
+    sweep_state = running;
+    sweep_log.clear();
+    sweep_log.reserve(points.size());
+    sweep_start_ns = FGMonotonicNs();
+  }
+  return sweep_task.Start(config.SampleHz, [this]() { return sweep_once(); });
+}
+
+bool HeinzingerVia16BitDAC::sweep_once() {
+  const FGSweepConfig &cfg = sweep_config;
+  double setpoint = sweep_points[sweep_index];
+  if (sweep_phase == sweep_step) {
+    HeinzingerSnapshot snap = cfg.SweepCurrent ? apply(NAN, setpoint, -1)
+                                               : apply(setpoint, NAN, -1);
+    if (!snap.ok)
+      return finish_sweep(sweep_state_failed);
+    sweep_step_ns = FGMonotonicNs();
+    sweep_detector.Reset(cfg.SettleWindow);
+    sweep_settled = false;
+    sweep_settle_s = 0;
+    sweep_volts.clear();
+    sweep_currs.clear();
+    sweep_attempts = 0;
+    sweep_phase = cfg.SettleTime > 0 ? sweep_settle : sweep_measure;
+    return true;
+  }
+
+  // Without settle detection the settle phase only waits, off the bus
+  bool detect = cfg.SettleTolerance > 0;
+  HeinzingerSnapshot snap;
+  snap.ok = false;
+  if (sweep_phase == sweep_measure || detect) {
+    {
+      std::lock_guard<std::recursive_mutex> lock(Interface.QueryMutex);
+      snap = decode_snapshot(Interface.Readout());
+    }
+    if (!snap.ok) {
+      std::lock_guard<std::mutex> lock(sweep_mutex);
+      sweep_state.failed_readouts++;
+    }
+  }
+
+  if (sweep_phase == sweep_settle) {
+    double waited = (FGMonotonicNs() - sweep_step_ns) * 1e-9;
+    double value = cfg.SweepCurrent ? snap.current : snap.voltage;
+    sweep_settled =
+        detect && snap.ok && sweep_detector.Add(value, cfg.SettleTolerance);
+    if (!sweep_settled && waited < cfg.SettleTime) {
+      // A free-running task has nothing to pace the plain wait; sleep in
+      // short slices so that cancel_sweep() still ends it promptly
+      if (!detect && !(cfg.SampleHz > 0)) {
+        uint64_t now = FGMonotonicNs();
+        uint64_t until = sweep_step_ns + (uint64_t)(cfg.SettleTime * 1e9);
+        FGSleepUntilNs(std::min(until, now + (uint64_t)10000000));
+      }
+      return true;
+    }
+    if (!sweep_settled && detect) {
+      std::lock_guard<std::mutex> lock(sweep_mutex);
+      sweep_state.settle_timeouts++;
+    }
+    sweep_settle_s = waited;
+    sweep_phase = sweep_measure;
+    return true;
+  }
+
+  if (snap.ok) {
+    sweep_volts.push_back(snap.voltage);
+    sweep_currs.push_back(snap.current);
+  }
+  ++sweep_attempts;
+  if (sweep_volts.size() < cfg.SamplesPerPoint) {
+    // Give up on a point whose readouts keep failing
+    if (sweep_attempts >= 2 * cfg.SamplesPerPoint + 10)
+      return finish_sweep(sweep_state_failed);
+    return true;
+  }
 
-  return converted_output_curr;
+  HeinzingerSweepPoint point;
+  point.setpoint = setpoint;
+  point.samples = (unsigned)sweep_volts.size();
+  point.settle_s = sweep_settle_s;
+  point.settled = sweep_settled;
+  FGSweepStats(sweep_volts, cfg.Reduce, point.voltage, point.voltage_std);
+  FGSweepStats(sweep_currs, cfg.Reduce, point.current, point.current_std);
+  {
+    std::lock_guard<std::mutex> lock(sweep_mutex);
+    sweep_log.push_back(point);
+    sweep_state.points_done++;
+  }
+  if (++sweep_index == sweep_points.size())
+    return finish_sweep(sweep_state_done);
+  sweep_phase = sweep_step;
+  return true;
+}
+
+bool HeinzingerVia16BitDAC::finish_sweep(HeinzingerSweepState state) {
+  std::vector<std::function<void(const std::vector<HeinzingerSweepPoint> &)>>
+      waiters;
+  std::vector<HeinzingerSweepPoint> results;
+  {
+    std::lock_guard<std::mutex> lock(sweep_mutex);
+    if (sweep_state.state == sweep_state_running) {
+      sweep_state.state = state;
+      sweep_end_ns = FGMonotonicNs();
+    }
+    waiters.swap(sweep_waiters);
+    if (!waiters.empty())
+      results = sweep_log;
+  }
+  sweep_finished.notify_all();
+  for (auto &done : waiters)
+    done(results);
+  return false;
+}
+
+void HeinzingerVia16BitDAC::on_sweep_done(
+    const std::function<void(const std::vector<HeinzingerSweepPoint> &)>
+        &done) {
+  std::vector<HeinzingerSweepPoint> results;
+  {
+    std::lock_guard<std::mutex> lock(sweep_mutex);
+    if (sweep_state.state == sweep_state_running) {
+      sweep_waiters.push_back(done);
+      return;
+    }
+    results = sweep_log;
+  }
+  done(results);
+}
+
+bool HeinzingerVia16BitDAC::wait_sweep(double timeout_s) {
+  std::unique_lock<std::mutex> lock(sweep_mutex);
+  auto done = [this]() { return sweep_state.state != sweep_state_running; };
+  if (timeout_s < 0) {
+    sweep_finished.wait(lock, done);
+    return true;
+  }
+  return sweep_finished.wait_for(
+      lock, std::chrono::duration<double>(timeout_s), done);
+}
+
+void HeinzingerVia16BitDAC::cancel_sweep() {
+  sweep_task.Stop();
+  finish_sweep(sweep_state_cancelled);
+}
+
+HeinzingerSweepStatus HeinzingerVia16BitDAC::sweep_status() const {
+  std::lock_guard<std::mutex> lock(sweep_mutex);
+  HeinzingerSweepStatus st = sweep_state;
+  if (st.state != sweep_state_idle) {
+    uint64_t end = st.state == sweep_state_running ? FGMonotonicNs()
+                                                   : sweep_end_ns;
+    st.elapsed_s = (end - sweep_start_ns) * 1e-9;
+  }
+  return st;
+}
+
+std::vector<HeinzingerSweepPoint> HeinzingerVia16BitDAC::sweep_results() const {
+  std::lock_guard<std::mutex> lock(sweep_mutex);
+  return sweep_log;
+}
+
+std::vector<HeinzingerSweepPoint>
+HeinzingerVia16BitDAC::sweep(const std::vector<double> &points,
+                             const FGSweepConfig &config) {
+  if (!start_sweep(points, config))
+    return std::vector<HeinzingerSweepPoint>();
+  wait_sweep();
+  return sweep_results();
+}
+
+bool HeinzingerVia16BitDAC::start_regulation(double rate_hz) {
+  if (!(rate_hz > 0)) {
+    std::cerr << "Regulation rate must be positive\n";
+    return false;
+  }
+  if (regulation.IsRunning()) {
+    regulation.SetRate(rate_hz);
+    return true;
+  }
+  {
+    std::lock_guard<std::recursive_mutex> lock(Interface.QueryMutex);
+    volt_loop.Reset(set_volt_cache.load());
+    curr_loop.Reset(set_curr_cache.load());
+    HeinzingerRegulationStatus running = {true, 0, 0, 0, 0, 0.0, 0.0,
+                                          set_volt_cache.load(),
+                                          set_curr_cache.load()};
+    regulation_state = running;
+    regulation_last_ns = FGMonotonicNs();
+    regulation_sample_ns = 0;
+    // The loop works on the readback of its previous cycle; prime it.
+    update();
+  }
+  return regulation.Start(rate_hz, [this]() { return regulate_once(); });
+}
+
+void HeinzingerVia16BitDAC::stop_regulation() {
+  regulation.Stop();
+  std::lock_guard<std::recursive_mutex> lock(Interface.QueryMutex);
+  regulation_state.running = false;
+}
+
+bool HeinzingerVia16BitDAC::regulate_once() {
+  std::lock_guard<std::recursive_mutex> lock(Interface.QueryMutex);
+  uint64_t now = FGMonotonicNs();
+  uint64_t max_age_ns = 3 * regulation.GetPeriodNs();
+  // Only a successful exchange newer than the one integrated last is a
+  // measurement; anything else is stale and must not wind the loops up.
+  uint64_t sample_ns = Interface.LastGoodNs;
+  bool fresh = sample_ns != 0 && sample_ns > regulation_sample_ns &&
+               now - sample_ns <= max_age_ns;
+
+  double volt_target = set_volt_cache.load();
+  double curr_target = set_curr_cache.load();
+  double volt_measured = convert_voltage(Interface.Readback.ADCB[2]);
+  double curr_measured = convert_current(Interface.Readback.ADCB[3]);
+  HeinzingerRegulationStatus &st = regulation_state;
+
+  uint8_t mask = 0;
+  uint16_t daca = 0, dacb = 0;
+  if (Interface.Readback.Relay == 0 || interlock_latched) {
+    // Nothing to regulate with the output off; start afresh once it is on
+    volt_loop.Reset(volt_target);
+    curr_loop.Reset(curr_target);
+    regulation_last_ns = now;
+  } else if (!fresh) {
+    // Hold: the board keeps its last command, this cycle just reads out
+    st.held_cycles++;
+  } else {
+    // After a stall (e.g. a reconnect) do not integrate over the whole gap
+    double dt = (now - regulation_last_ns) * 1e-9;
+    if (dt > max_age_ns * 1e-9)
+      dt = max_age_ns * 1e-9;
+    regulation_last_ns = now;
+    regulation_sample_ns = sample_ns;
+    if (volt_loop.Config.Enabled) {
+      st.voltage_command =
+          volt_loop.Update(volt_target, volt_measured, dt, 0, max_volt);
+      daca = voltage_register(st.voltage_command);
+      mask |= FGAnalogPSUInterface::MaskDACA;
+    }
+    if (curr_loop.Config.Enabled) {
+      st.current_command =
+          curr_loop.Update(curr_target, curr_measured, dt, 0, max_curr);
+      dacb = current_register(st.current_command);
+      mask |= FGAnalogPSUInterface::MaskDACB;
+    }
+  }
+  st.voltage_error = volt_target - volt_measured;
+  st.current_error = curr_target - curr_measured;
+
+  // The response to the command is the readback for the next cycle
+  bool ok = mask ? Interface.Set(mask, daca, dacb, false) : Interface.Readout();
+  if (ok)
+    this->relay_cache = Interface.Readback.Relay != 0;
+  else
+    st.failed_cycles++;
+  st.cycles++;
+  st.overruns = regulation.GetOverruns();
+  return true; // a failed cycle is retried next period
+}
+
+HeinzingerRegulationStatus HeinzingerVia16BitDAC::regulation_status() const {
+  std::lock_guard<std::recursive_mutex> lock(Interface.QueryMutex);
+  HeinzingerRegulationStatus st = regulation_state;
+  st.running = regulation.IsRunning();
+  return st;
+}
+
+FGPIConfig HeinzingerVia16BitDAC::get_voltage_loop() const {
+  std::lock_guard<std::recursive_mutex> lock(Interface.QueryMutex);
+  return volt_loop.Config;
+}
+
+void HeinzingerVia16BitDAC::set_voltage_loop(const FGPIConfig &config) {
+  std::lock_guard<std::recursive_mutex> lock(Interface.QueryMutex);
+  volt_loop.Config = config;
+  volt_loop.Reset(set_volt_cache.load());
+}
+
+FGPIConfig HeinzingerVia16BitDAC::get_current_loop() const {
+  std::lock_guard<std::recursive_mutex> lock(Interface.QueryMutex);
+  return curr_loop.Config;
+}
+
+void HeinzingerVia16BitDAC::set_current_loop(const FGPIConfig &config) {
+  std::lock_guard<std::recursive_mutex> lock(Interface.QueryMutex);
+  curr_loop.Config = config;
+  curr_loop.Reset(set_curr_cache.load());
+}
+
+bool HeinzingerVia16BitDAC::queued_command(double volt, double curr,
+                                           int relay,
+                                           FGSetpointCommand &cmd) const {
+  bool valid = true;
+  if (!std::isnan(volt)) {
+    if (volt > this->max_volt || volt < 0) {
+      std::cerr
+          << "Set voltage value lies outside of device's specified range\n";
+      valid = false;
+    }
+    cmd.Volt = volt;
+    cmd.Mask |= FGAnalogPSUInterface::MaskDACA;
+  }
+  if (!std::isnan(curr)) {
+    if (curr > this->max_curr || curr < 0) {
+      std::cerr
+          << "Set current value lies outside of device's specified range\n";
+      valid = false;
+    }
+    cmd.Curr = curr;
+    cmd.Mask |= FGAnalogPSUInterface::MaskDACB;
+  }
+  if (relay >= 0) {
+    cmd.Relay = relay > 0;
+    cmd.Mask |= FGAnalogPSUInterface::MaskRelay;
+  }
+  return valid;
+}
+
+// An invalid submission is answered at once and never joins the pending
+// command, so it cannot spoil the others merged into it.
+std::future<HeinzingerSnapshot>
+HeinzingerVia16BitDAC::submit(double volt, double curr, int relay) {
+  FGSetpointCommand cmd;
+  std::future<HeinzingerSnapshot> out;
+  if (queued_command(volt, curr, relay, cmd) &&
+      (command_task.IsRunning() || start_command_queue()) &&
+      command_queue.Submit(cmd, out))
+    return out;
+  std::promise<HeinzingerSnapshot> failed;
+  failed.set_value(failed_snapshot());
+  return failed.get_future();
+}
+
+void HeinzingerVia16BitDAC::submit(
+    double volt, double curr, int relay,
+    const std::function<void(const HeinzingerSnapshot &)> &done) {
+  FGSetpointCommand cmd;
+  if (queued_command(volt, curr, relay, cmd) &&
+      (command_task.IsRunning() || start_command_queue()) &&
+      command_queue.Submit(cmd, done))
+    return;
+  done(failed_snapshot());
+}
+
+void HeinzingerVia16BitDAC::read_snapshot_async(
+    const std::function<void(const HeinzingerSnapshot &)> &done) {
+  if (acquisition.IsRunning()) {
+    done(latest());
+    return;
+  }
+  // A pure readout rides along with whatever is pending, so any number of
+  // concurrent readers share one exchange.
+  submit(NAN, NAN, -1, done);
+}
+
+bool HeinzingerVia16BitDAC::start_command_queue() {
+  std::lock_guard<std::mutex> lock(command_start_mutex);
+  if (command_task.IsRunning())
+    return true;
+  command_queue.Open();
+  // Free-running: the loop blocks in Take() until something is pending
+  return command_task.Start(0, [this]() { return command_once(); });
+}
+
+void HeinzingerVia16BitDAC::stop_command_queue() {
+  std::lock_guard<std::mutex> lock(command_start_mutex);
+  command_queue.Close();
+  command_task.Stop();
+  // The loop may have stopped with a command still pending behind the one
+  // it was sending; nothing new can arrive once closed.
+  FGCoalescingQueue<HeinzingerSnapshot>::Batch batch;
+  while (command_queue.Take(batch))
+    send_batch(batch);
+}
+
+bool HeinzingerVia16BitDAC::command_once() {
+  FGCoalescingQueue<HeinzingerSnapshot>::Batch batch;
+  if (!command_queue.Take(batch))
+    return false; // closed and drained
+  send_batch(batch);
+  return true;
+}
+
+void HeinzingerVia16BitDAC::send_batch(
+    FGCoalescingQueue<HeinzingerSnapshot>::Batch &batch) {
+  const FGSetpointCommand &cmd = batch.Command;
+  HeinzingerSnapshot snap =
+      apply(cmd.Mask & FGAnalogPSUInterface::MaskDACA ? cmd.Volt : NAN,
+            cmd.Mask & FGAnalogPSUInterface::MaskDACB ? cmd.Curr : NAN,
+            cmd.Mask & FGAnalogPSUInterface::MaskRelay ? (cmd.Relay ? 1 : 0)
+                                                       : -1);
+  batch.Complete(snap);
 }
 
 bool HeinzingerVia16BitDAC::set_max_volt() {
   // This sets the DACA to its max value. The resulting voltage depends on
-  // how max_analog_in_volt relates to BOARD_MAX_VOLT and the PSU's response.
+  // how max_analog_in_volt relates to the board's DAC full scale
+  // (calibration.BoardMaxVolt) and the PSU's response.
   // If max_analog_in_volt_bin is the calibrated max register value for desired
   // max_analog_in_volt: Interface.SetDACA(this->max_analog_in_volt_bin); Your
   // original code just used UINT16_MAX which sets the DAC to its max physical
   // output.
-  Interface.SetDACA(UINT16_MAX);
-  return update();
+  std::lock_guard<std::recursive_mutex> lock(Interface.QueryMutex);
+  if (interlock_blocks())
+    return false;
+  return confirm(Interface.SetDACA(UINT16_MAX), FGAnalogPSUInterface::MaskDACA,
+                 UINT16_MAX, 0, false);
 }
 
 bool HeinzingerVia16BitDAC::set_max_curr() {
-  Interface.SetDACB(UINT16_MAX);
-  return update();
+  std::lock_guard<std::recursive_mutex> lock(Interface.QueryMutex);
+  if (interlock_blocks())
+    return false;
+  return confirm(Interface.SetDACB(UINT16_MAX), FGAnalogPSUInterface::MaskDACB,
+                 0, UINT16_MAX, false);
 }
 
 void HeinzingerVia16BitDAC::readADC() {
+  std::lock_guard<std::recursive_mutex> lock(Interface.QueryMutex);
   if (!Interface.Readout()) {
     std::cerr << "Failed to readout interface for ADC reading." << std::endl;
     return;
   }
-  // Interface.ADCB should be populated by Interface.Readout()
-  for (const auto &a : Interface.ADCB) { // Added const
+  // Interface.Readback.ADCB should be populated by Interface.Readout()
+  for (const auto &a : Interface.Readback.ADCB) { // Added const
     std::cout << a << " ";
   }
   std::cout << std::endl;
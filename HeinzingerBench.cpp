@@ -0,0 +1,197 @@
+// HeinzingerBench.cpp
+//
+// Throughput and latency benchmark of the control path against a simulated
+// analog board (headers/SimulatedBoard.h), so that regressions show up
+// without lab hardware. With --replay the board answers from a recording
+// instead (headers/ReplayBoard.h), at --speed times the original rate or, with
+// --speed 0, as fast as the stack can query; drop and corrupt then count
+// records skipped and commands the board rejected.
+//
+// Usage: heinzinger_bench [--seconds S] [--latency-us L] [--jitter-us J]
+//                         [--drop RATE] [--corrupt RATE] [--seed N]
+//                         [--replay FILE] [--speed X]
+
+#include "headers/CommonIncludes.h"
+#include "headers/Error.h"
+#include "headers/Heinzinger.h"
+#include "headers/ReplayBoard.h"
+#include "headers/SimulatedBoard.h"
+
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <functional>
+#include <iostream>
+#include <map>
+#include <memory>
+#include <string>
+
+namespace {
+
+struct BenchResult {
+  uint64_t ops = 0;
+  uint64_t failed = 0;
+  double seconds = 0;
+};
+
+// Runs op back to back for the given time.
+BenchResult run_for(double seconds, const std::function<bool(uint64_t)> &op) {
+  BenchResult r;
+  uint64_t start = FGMonotonicNs();
+  uint64_t end = start + (uint64_t)(seconds * 1e9);
+  uint64_t now = start;
+  while (now < end) {
+    if (!op(r.ops))
+      r.failed++;
+    r.ops++;
+    now = FGMonotonicNs();
+  }
+  r.seconds = (now - start) * 1e-9;
+  return r;
+}
+
+void print_header() {
+  printf("%-10s %10s %9s %9s %9s %9s %7s %7s %7s %7s\n", "phase", "ops/s",
+         "p50_us", "p99_us", "max_us", "failed", "drop", "corrupt", "magic",
+         "cksum");
+}
+
+void print_row(const char *phase, const BenchResult &r,
+               std::map<std::string, double> stats, uint64_t dropped,
+               uint64_t corrupted) {
+  printf("%-10s %10.0f %9.1f %9.1f %9.1f %9llu %7llu %7llu %7.0f %7.0f\n",
+         phase, r.ops / r.seconds, stats["query_p50_us"],
+         stats["query_p99_us"], stats["query_max_us"],
+         (unsigned long long)r.failed, (unsigned long long)dropped,
+         (unsigned long long)corrupted, stats["magic_failures"],
+         stats["checksum_failures"]);
+}
+
+} // namespace
+
+int main(int argc, char **argv) {
+  FGSimulatedBoard::Config cfg;
+  FGReplayBoard::Config replay_cfg;
+  replay_cfg.Loop = true; // keep answering for every phase
+  std::string replay_path;
+  double seconds = 2.0;
+  for (int i = 1; i < argc; i += 2) {
+    if (i + 1 >= argc) {
+      fprintf(stderr, "Missing value for option %s\n", argv[i]);
+      return 1;
+    }
+    double value = strtod(argv[i + 1], nullptr);
+    if (!strcmp(argv[i], "--seconds"))
+      seconds = value;
+    else if (!strcmp(argv[i], "--latency-us"))
+      cfg.LatencyUs = value;
+    else if (!strcmp(argv[i], "--jitter-us"))
+      cfg.JitterUs = value;
+    else if (!strcmp(argv[i], "--drop"))
+      cfg.DropRate = value;
+    else if (!strcmp(argv[i], "--corrupt"))
+      cfg.CorruptRate = value;
+    else if (!strcmp(argv[i], "--seed"))
+      cfg.Seed = (uint32_t)value;
+    else if (!strcmp(argv[i], "--replay"))
+      replay_path = argv[i + 1];
+    else if (!strcmp(argv[i], "--speed"))
+      replay_cfg.Speed = value;
+    else {
+      fprintf(stderr, "Unknown option %s\n", argv[i]);
+      return 1;
+    }
+  }
+
+  FGSimulatedBoard board(cfg);
+  FGReplayBoard replay(replay_cfg);
+  std::unique_ptr<HeinzingerVia16BitDAC> psu_ptr;
+  if (replay_path.empty()) {
+    printf("Simulated board: latency %.1f us, jitter %.1f us, drop %.4f, "
+           "corrupt %.4f, %.1f s per phase\n",
+           cfg.LatencyUs, cfg.JitterUs, cfg.DropRate, cfg.CorruptRate,
+           seconds);
+    psu_ptr.reset(new HeinzingerVia16BitDAC(board.MakeTransfers(), 30000.0,
+                                            2.0, false, 10.0));
+  } else {
+    if (!replay.Open(replay_path)) {
+      fprintf(stderr, "%s is not a recording\n", replay_path.c_str());
+      return 1;
+    }
+    const FGRecordingHeader &header = replay.GetHeader();
+    printf("Replayed board: %s, %llu records over %.1f s, speed %.1f, "
+           "%.1f s per phase\n",
+           replay_path.c_str(), (unsigned long long)replay.GetCount(),
+           replay.GetDuration(), replay_cfg.Speed, seconds);
+    psu_ptr.reset(new HeinzingerVia16BitDAC(
+        replay.MakeBridge(), header.MaxVoltage, header.MaxCurrent, false,
+        10.0));
+  }
+  HeinzingerVia16BitDAC &psu = *psu_ptr;
+
+  // Failed exchanges are expected with drops/corruption; keep them quiet.
+  std::ostream null_stream(nullptr);
+  ErrorStream = &null_stream;
+  std::streambuf *cerr_buf = std::cerr.rdbuf(nullptr);
+
+  // Faults injected by the board since the start of a phase
+  uint64_t dropped0 = 0, corrupted0 = 0;
+  auto board_faults = [&](uint64_t &dropped, uint64_t &corrupted) {
+    if (replay_path.empty()) {
+      dropped = board.GetCounters().Dropped.load();
+      corrupted = board.GetCounters().Corrupted.load();
+    } else {
+      dropped = replay.GetCounters().Skipped.load();
+      corrupted = replay.GetCounters().Rejected.load();
+    }
+  };
+  auto start_phase = [&]() {
+    psu.reset_stats();
+    board_faults(dropped0, corrupted0);
+  };
+  auto end_phase = [&](const char *phase, const BenchResult &r,
+                       const std::map<std::string, double> &stats) {
+    uint64_t dropped, corrupted;
+    board_faults(dropped, corrupted);
+    print_row(phase, r, stats, dropped - dropped0, corrupted - corrupted0);
+  };
+
+  print_header();
+  BenchResult r;
+
+  start_phase();
+  r = run_for(seconds, [&](uint64_t) { return psu.read_snapshot().ok; });
+  end_phase("readout", r, psu.stats());
+
+  start_phase();
+  r = run_for(seconds, [&](uint64_t i) {
+    return psu.set_voltage((i % 2) ? 1000.0 : 2000.0);
+  });
+  end_phase("setter", r, psu.stats());
+
+  start_phase();
+  r = run_for(seconds, [&](uint64_t i) {
+    return psu.apply((i % 2) ? 1000.0 : 2000.0, 0.5, 1).ok;
+  });
+  end_phase("apply", r, psu.stats());
+
+  // Streaming: the capture thread polls as fast as the board answers.
+  start_phase();
+  uint64_t errors0 = psu.get_acquisition_errors();
+  uint64_t start = FGMonotonicNs();
+  psu.start_capture(1 << 16, 0.0);
+  FGSleepUntilNs(start + (uint64_t)(seconds * 1e9));
+  psu.stop_capture();
+  std::map<std::string, double> stats = psu.stats();
+  r.seconds = (FGMonotonicNs() - start) * 1e-9;
+  r.ops = (uint64_t)stats["queries"];
+  r.failed = psu.get_acquisition_errors() - errors0;
+  end_phase("stream", r, stats);
+  printf("stream: %llu samples captured, %.0f overruns\n",
+         (unsigned long long)psu.capture_count(),
+         stats["acquisition_overruns"]);
+
+  std::cerr.rdbuf(cerr_buf);
+  psu.switch_off();
+  return 0;
+}
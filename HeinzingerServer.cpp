@@ -0,0 +1,530 @@
+// HeinzingerServer.cpp
+//
+// Native control server: the equivalent of run_psu_service.py's /read,
+// /relay, /set_voltage and /set_current endpoints over a line-based protocol
+// on a TCP port and/or a Unix socket, without Flask or Python in the path.
+//
+// Reads are served from the acquisition cache (HeinzingerVia16BitDAC::
+// latest()) and never touch USB; only setters go to the board. All clients
+// are handled by one poll() loop. Setters are handed to the PSU's command
+// queue and answered when their command completes, so a setter retrying
+// on the bus never stalls the other clients; each client still gets its
+// responses in request order.
+//
+// Usage: heinzinger_server [--port N] [--bind ADDR] [--unix PATH]
+//                          [--device-index N | --serial S | --usb-path P]
+//                          [--max-voltage V] [--max-current A]
+//                          [--max-input-voltage V] [--rate-hz R]
+//                          [--simulate | --replay FILE [--speed X]]
+//
+// --replay answers from a recording (see start_recording()) instead of a
+// board, looping at --speed times the original rate, to reproduce a run for
+// the clients.
+//
+// Protocol: one request per line, one response line per request, either
+// "OK ..." or "ERR <message>".
+//   READ                 -> OK <voltage> <current> <on> <errors> <seq> <t_ns>
+//   RELAY                -> OK <on>
+//   RELAY ON|OFF         -> OK <on>
+//   SET_VOLTAGE <value>  -> OK
+//   SET_CURRENT <value>  -> OK
+//   STATS                -> OK <name>=<value> ...
+//   PING                 -> OK
+//   QUIT                 -> OK, then the connection is closed
+
+#include "headers/CommonIncludes.h"
+#include "headers/Error.h"
+#include "headers/Heinzinger.h"
+#include "headers/ReplayBoard.h"
+#include "headers/SimulatedBoard.h"
+
+#include <arpa/inet.h>
+#include <cerrno>
+#include <csignal>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <fcntl.h>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <poll.h>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+#include <vector>
+
+namespace {
+
+const size_t max_line = 256; // longer requests close the connection
+
+volatile sig_atomic_t stop_requested = 0;
+void on_signal(int) { stop_requested = 1; }
+
+struct Client {
+  int fd;
+  uint64_t id = 0; // distinguishes clients reusing a closed client's fd
+  std::string in, out;
+  bool closing = false; // close once out has been flushed
+  // Responses by request number; released into out strictly in order
+  uint64_t next_request = 0, next_reply = 0;
+  std::map<uint64_t, std::string> replies;
+  uint64_t quit_request = UINT64_MAX; // the QUIT, if one was received
+};
+
+// Responses of queued setters, posted from the PSU's queue thread and
+// collected by the poll loop, which the write to wake_fd wakes up.
+struct Completions {
+  struct Item {
+    int fd;
+    uint64_t client, request;
+    std::string reply;
+  };
+  std::mutex lock;
+  std::vector<Item> items;
+  int wake_fd = -1;
+
+  void post(int fd, uint64_t client, uint64_t request,
+            const std::string &reply) {
+    {
+      std::lock_guard<std::mutex> guard(lock);
+      items.push_back(Item{fd, client, request, reply});
+    }
+    char byte = 1;
+    ssize_t ignored = write(wake_fd, &byte, 1); // full pipe: already woken
+    (void)ignored;
+  }
+  std::vector<Item> take() {
+    std::lock_guard<std::mutex> guard(lock);
+    std::vector<Item> out;
+    out.swap(items);
+    return out;
+  }
+};
+
+bool set_nonblocking(int fd) {
+  int flags = fcntl(fd, F_GETFL, 0);
+  return flags >= 0 && fcntl(fd, F_SETFL, flags | O_NONBLOCK) == 0;
+}
+
+int listen_tcp(const std::string &address, int port) {
+  int fd = socket(AF_INET, SOCK_STREAM, 0);
+  if (fd < 0)
+    return -1;
+  int one = 1;
+  setsockopt(fd, SOL_SOCKET, SO_REUSEADDR, &one, sizeof(one));
+  sockaddr_in addr;
+  memset(&addr, 0, sizeof(addr));
+  addr.sin_family = AF_INET;
+  addr.sin_port = htons((uint16_t)port);
+  if (inet_pton(AF_INET, address.c_str(), &addr.sin_addr) != 1 ||
+      bind(fd, (sockaddr *)&addr, sizeof(addr)) != 0 || listen(fd, 64) != 0 ||
+      !set_nonblocking(fd)) {
+    close(fd);
+    return -1;
+  }
+  return fd;
+}
+
+int listen_unix(const std::string &path) {
+  sockaddr_un addr;
+  if (path.size() >= sizeof(addr.sun_path))
+    return -1;
+  int fd = socket(AF_UNIX, SOCK_STREAM, 0);
+  if (fd < 0)
+    return -1;
+  memset(&addr, 0, sizeof(addr));
+  addr.sun_family = AF_UNIX;
+  strncpy(addr.sun_path, path.c_str(), sizeof(addr.sun_path) - 1);
+  unlink(path.c_str()); // stale socket of a previous run
+  if (bind(fd, (sockaddr *)&addr, sizeof(addr)) != 0 || listen(fd, 64) != 0 ||
+      !set_nonblocking(fd)) {
+    close(fd);
+    return -1;
+  }
+  return fd;
+}
+
+bool parse_number(const std::string &text, double &value) {
+  const char *s = text.c_str();
+  char *end;
+  value = strtod(s, &end);
+  return end != s && *end == '\0' && std::isfinite(value);
+}
+
+std::string format_snapshot(const HeinzingerSnapshot &snap) {
+  char line[160];
+  snprintf(line, sizeof(line), "OK %.6g %.6g %d %u %u %llu", snap.voltage,
+           snap.current, snap.relay ? 1 : 0, (unsigned)snap.errors,
+           (unsigned)snap.sequence_no, (unsigned long long)snap.timestamp_ns);
+  return line;
+}
+
+// Queues a setpoint command whose response is posted once it completes.
+void submit_setter(HeinzingerVia16BitDAC &psu,
+                   const std::shared_ptr<Completions> &completions,
+                   const Client &c, uint64_t request, double volt,
+                   double curr, int relay, const std::string &ok_reply,
+                   const std::string &err_reply) {
+  int fd = c.fd;
+  uint64_t client = c.id;
+  psu.submit(volt, curr, relay,
+             [=](const HeinzingerSnapshot &snap) {
+               completions->post(fd, client, request,
+                                 snap.ok ? ok_reply : err_reply);
+             });
+}
+
+// Executes one request line and returns the response (without newline).
+// Setters return an empty string: their response is posted later.
+std::string handle(HeinzingerVia16BitDAC &psu,
+                   const std::shared_ptr<Completions> &completions,
+                   const Client &c, uint64_t request, const std::string &line,
+                   bool &quit) {
+  std::istringstream words(line);
+  std::string verb, arg, extra;
+  words >> verb >> arg >> extra;
+  for (char &c : verb)
+    c = (char)toupper((unsigned char)c);
+  for (char &c : arg)
+    c = (char)toupper((unsigned char)c);
+  if (!extra.empty())
+    return "ERR too many arguments";
+
+  if (verb == "READ" && arg.empty()) {
+    HeinzingerSnapshot snap = psu.latest();
+    if (!snap.ok)
+      return "ERR no valid readout";
+    return format_snapshot(snap);
+  }
+  if (verb == "RELAY") {
+    if (arg.empty()) {
+      HeinzingerSnapshot snap = psu.latest();
+      if (!snap.ok)
+        return "ERR no valid readout";
+      return snap.relay ? "OK 1" : "OK 0";
+    }
+    bool on;
+    if (arg == "ON" || arg == "1")
+      on = true;
+    else if (arg == "OFF" || arg == "0")
+      on = false;
+    else
+      return "ERR relay state must be ON or OFF";
+    submit_setter(psu, completions, c, request, NAN, NAN, on ? 1 : 0,
+                  on ? "OK 1" : "OK 0", "ERR PSU did not accept the command");
+    return std::string();
+  }
+  if (verb == "SET_VOLTAGE" || verb == "SET_CURRENT") {
+    double value;
+    if (!parse_number(arg, value))
+      return "ERR expected a number";
+    bool volt = verb == "SET_VOLTAGE";
+    submit_setter(psu, completions, c, request, volt ? value : NAN,
+                  volt ? NAN : value, -1, "OK",
+                  "ERR PSU did not accept the setpoint");
+    return std::string();
+  }
+  if (verb == "STATS" && arg.empty()) {
+    std::string out = "OK";
+    char item[96];
+    for (const auto &kv : psu.stats()) {
+      snprintf(item, sizeof(item), " %s=%.6g", kv.first.c_str(), kv.second);
+      out += item;
+    }
+    return out;
+  }
+  if (verb == "PING" && arg.empty())
+    return "OK";
+  if (verb == "QUIT" && arg.empty()) {
+    quit = true;
+    return "OK";
+  }
+  return "ERR unknown request";
+}
+
+// Moves the responses that are next in request order into out.
+void release_replies(Client &c) {
+  std::map<uint64_t, std::string>::iterator it;
+  while ((it = c.replies.find(c.next_reply)) != c.replies.end()) {
+    c.out += it->second;
+    c.out += '\n';
+    c.replies.erase(it);
+    if (c.next_reply++ == c.quit_request)
+      c.closing = true;
+  }
+}
+
+// Handles every complete line in the client's input buffer. Nothing after a
+// QUIT is read.
+void serve_lines(HeinzingerVia16BitDAC &psu,
+                 const std::shared_ptr<Completions> &completions, Client &c) {
+  size_t start = 0, eol;
+  while (c.quit_request == UINT64_MAX &&
+         (eol = c.in.find('\n', start)) != std::string::npos) {
+    std::string line = c.in.substr(start, eol - start);
+    if (!line.empty() && line.back() == '\r')
+      line.pop_back();
+    start = eol + 1;
+    if (line.empty())
+      continue;
+    bool quit = false;
+    uint64_t request = c.next_request++;
+    std::string reply = handle(psu, completions, c, request, line, quit);
+    if (!reply.empty())
+      c.replies[request] = reply;
+    if (quit)
+      c.quit_request = request;
+  }
+  c.in.erase(0, start);
+  if (c.in.size() > max_line && c.quit_request == UINT64_MAX) {
+    c.quit_request = c.next_request++;
+    c.replies[c.quit_request] = "ERR request too long";
+  }
+  release_replies(c);
+}
+
+// Returns false if the connection has to be dropped.
+bool flush(Client &c) {
+  while (!c.out.empty()) {
+    ssize_t n = send(c.fd, c.out.data(), c.out.size(), MSG_NOSIGNAL);
+    if (n < 0)
+      return errno == EAGAIN || errno == EWOULDBLOCK || errno == EINTR;
+    c.out.erase(0, (size_t)n);
+  }
+  return !c.closing;
+}
+
+void print_usage() {
+  fprintf(stderr,
+          "Usage: heinzinger_server [--port N] [--bind ADDR] [--unix PATH]\n"
+          "         [--device-index N | --serial S | --usb-path P]\n"
+          "         [--max-voltage V] [--max-current A] "
+          "[--max-input-voltage V]\n"
+          "         [--rate-hz R] [--simulate | --replay FILE [--speed X]]\n");
+}
+
+} // namespace
+
+int main(int argc, char **argv) {
+  int port = 5025;
+  std::string bind_address = "127.0.0.1", unix_path, serial, usb_path;
+  int device_index = 0;
+  double max_voltage = 30000.0, max_current = 2.0, max_input_voltage = 10.0;
+  double rate_hz = 100.0;
+  bool simulate = false;
+  std::string replay_path;
+  FGReplayBoard::Config replay_cfg;
+  replay_cfg.Loop = true;
+  for (int i = 1; i < argc; ++i) {
+    std::string opt = argv[i];
+    if (opt == "--simulate") {
+      simulate = true;
+      continue;
+    }
+    if (i + 1 >= argc) {
+      print_usage();
+      return 1;
+    }
+    std::string value = argv[++i];
+    if (opt == "--port")
+      port = atoi(value.c_str());
+    else if (opt == "--bind")
+      bind_address = value;
+    else if (opt == "--unix")
+      unix_path = value;
+    else if (opt == "--device-index")
+      device_index = atoi(value.c_str());
+    else if (opt == "--serial")
+      serial = value;
+    else if (opt == "--usb-path")
+      usb_path = value;
+    else if (opt == "--max-voltage")
+      max_voltage = strtod(value.c_str(), nullptr);
+    else if (opt == "--max-current")
+      max_current = strtod(value.c_str(), nullptr);
+    else if (opt == "--max-input-voltage")
+      max_input_voltage = strtod(value.c_str(), nullptr);
+    else if (opt == "--rate-hz")
+      rate_hz = strtod(value.c_str(), nullptr);
+    else if (opt == "--replay")
+      replay_path = value;
+    else if (opt == "--speed")
+      replay_cfg.Speed = strtod(value.c_str(), nullptr);
+    else {
+      print_usage();
+      return 1;
+    }
+  }
+
+  std::unique_ptr<FGSimulatedBoard> board;
+  std::unique_ptr<FGReplayBoard> replay;
+  std::unique_ptr<HeinzingerVia16BitDAC> psu;
+  if (!replay_path.empty()) {
+    replay.reset(new FGReplayBoard(replay_cfg));
+    if (!replay->Open(replay_path)) {
+      fprintf(stderr, "%s is not a recording\n", replay_path.c_str());
+      return 1;
+    }
+    psu.reset(new HeinzingerVia16BitDAC(
+        replay->MakeBridge(), replay->GetHeader().MaxVoltage,
+        replay->GetHeader().MaxCurrent, false, max_input_voltage));
+  } else if (simulate) {
+    board.reset(new FGSimulatedBoard());
+    psu.reset(new HeinzingerVia16BitDAC(board->MakeTransfers(), max_voltage,
+                                        max_current, false,
+                                        max_input_voltage));
+  } else {
+    try {
+      if (!serial.empty() || !usb_path.empty())
+        psu.reset(new HeinzingerVia16BitDAC(serial, usb_path, max_voltage,
+                                            max_current, false,
+                                            max_input_voltage));
+      else
+        psu.reset(new HeinzingerVia16BitDAC(device_index, max_voltage,
+                                            max_current, false,
+                                            max_input_voltage));
+    } catch (const std::exception &e) {
+      fprintf(stderr, "%s\n", e.what());
+      return 1;
+    }
+  }
+  if (!psu->start_acquisition(rate_hz)) {
+    fprintf(stderr, "Unable to start the acquisition thread\n");
+    return 1;
+  }
+
+  std::vector<int> listeners;
+  if (port > 0) {
+    int fd = listen_tcp(bind_address, port);
+    if (fd < 0) {
+      fprintf(stderr, "Unable to listen on %s:%d: %s\n", bind_address.c_str(),
+              port, strerror(errno));
+      return 1;
+    }
+    listeners.push_back(fd);
+    printf("Listening on %s:%d\n", bind_address.c_str(), port);
+  }
+  if (!unix_path.empty()) {
+    int fd = listen_unix(unix_path);
+    if (fd < 0) {
+      fprintf(stderr, "Unable to listen on %s: %s\n", unix_path.c_str(),
+              strerror(errno));
+      return 1;
+    }
+    listeners.push_back(fd);
+    printf("Listening on %s\n", unix_path.c_str());
+  }
+  if (listeners.empty()) {
+    fprintf(stderr, "Nothing to listen on\n");
+    return 1;
+  }
+  fflush(stdout);
+
+  // The queue thread wakes the poll loop through this pipe
+  std::shared_ptr<Completions> completions = std::make_shared<Completions>();
+  int wake[2];
+  if (pipe(wake) != 0 || !set_nonblocking(wake[0]) ||
+      !set_nonblocking(wake[1])) {
+    perror("pipe");
+    return 1;
+  }
+  completions->wake_fd = wake[1];
+
+  signal(SIGINT, on_signal);
+  signal(SIGTERM, on_signal);
+  signal(SIGPIPE, SIG_IGN);
+
+  std::map<int, Client> clients;
+  uint64_t next_client = 1;
+  std::vector<pollfd> fds;
+  while (!stop_requested) {
+    fds.clear();
+    fds.push_back(pollfd{wake[0], POLLIN, 0});
+    for (int fd : listeners)
+      fds.push_back(pollfd{fd, POLLIN, 0});
+    for (const auto &kv : clients) {
+      short events = POLLIN;
+      if (!kv.second.out.empty())
+        events |= POLLOUT;
+      fds.push_back(pollfd{kv.first, events, 0});
+    }
+    if (poll(fds.data(), fds.size(), 500) < 0) {
+      if (errno == EINTR)
+        continue;
+      perror("poll");
+      break;
+    }
+
+    if (fds[0].revents != 0) {
+      char drain[64];
+      while (read(wake[0], drain, sizeof(drain)) > 0)
+        ;
+    }
+    // Responses of completed setters; a client that has gone meanwhile
+    // (or whose fd was reused) is skipped.
+    for (const Completions::Item &item : completions->take()) {
+      std::map<int, Client>::iterator it = clients.find(item.fd);
+      if (it == clients.end() || it->second.id != item.client)
+        continue;
+      it->second.replies[item.request] = item.reply;
+      release_replies(it->second);
+    }
+
+    for (size_t i = 1; i < fds.size(); ++i) {
+      int fd = fds[i].fd;
+      if (i <= listeners.size()) {
+        if (fds[i].revents == 0)
+          continue;
+        int conn;
+        while ((conn = accept(fd, nullptr, nullptr)) >= 0) {
+          set_nonblocking(conn);
+          int one = 1;
+          setsockopt(conn, IPPROTO_TCP, TCP_NODELAY, &one, sizeof(one));
+          clients[conn].fd = conn;
+          clients[conn].id = next_client++;
+        }
+        continue;
+      }
+
+      std::map<int, Client>::iterator it = clients.find(fd);
+      if (it == clients.end())
+        continue; // accepted after this poll round began
+      Client &c = it->second;
+      bool keep = true;
+      if (fds[i].revents & (POLLIN | POLLHUP | POLLERR)) {
+        char buf[4096];
+        ssize_t n = recv(fd, buf, sizeof(buf), 0);
+        if (n > 0) {
+          c.in.append(buf, (size_t)n);
+          serve_lines(*psu, completions, c);
+        } else if (n == 0 || (errno != EAGAIN && errno != EINTR)) {
+          keep = false;
+        }
+      }
+      if (keep)
+        keep = flush(c);
+      if (!keep) {
+        close(fd);
+        clients.erase(fd);
+      }
+    }
+  }
+
+  for (const auto &kv : clients)
+    close(kv.first);
+  for (int fd : listeners)
+    close(fd);
+  if (!unix_path.empty())
+    unlink(unix_path.c_str());
+  psu->stop_command_queue(); // its last completions post into the pipe
+  psu->stop_acquisition();
+  close(wake[0]);
+  close(wake[1]);
+  return 0;
+}
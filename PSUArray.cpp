@@ -0,0 +1,183 @@
+#include "headers/PSUArray.h"
+#include "headers/Error.h" // For Shout
+
+#include <cmath>
+#include <condition_variable>
+#include <exception>
+#include <functional>
+#include <stdexcept>
+#include <thread>
+
+// Thread that runs the fan-out jobs of one board, one at a time
+struct PSUArray::worker {
+  std::mutex lock;
+  std::condition_variable wake, finished;
+  std::function<void()> job;
+  std::exception_ptr error;
+  bool busy = false, stopping = false;
+  std::thread thread;
+
+  worker() : thread(&worker::loop, this) {}
+  ~worker() {
+    {
+      std::lock_guard<std::mutex> guard(lock);
+      stopping = true;
+    }
+    wake.notify_one();
+    thread.join();
+  }
+
+  void loop() {
+    std::unique_lock<std::mutex> guard(lock);
+    for (;;) {
+      wake.wait(guard, [this]() { return busy || stopping; });
+      if (!busy)
+        return;
+      std::function<void()> fn;
+      fn.swap(job);
+      guard.unlock();
+      std::exception_ptr caught;
+      try {
+        fn();
+      } catch (...) {
+        caught = std::current_exception();
+      }
+      guard.lock();
+      error = caught;
+      busy = false;
+      finished.notify_one();
+    }
+  }
+
+  void post(std::function<void()> fn) {
+    {
+      std::lock_guard<std::mutex> guard(lock);
+      job = std::move(fn);
+      busy = true;
+    }
+    wake.notify_one();
+  }
+
+  // Waits for the posted job and rethrows what it threw
+  void wait() {
+    std::unique_lock<std::mutex> guard(lock);
+    finished.wait(guard, [this]() { return !busy; });
+    std::exception_ptr caught = error;
+    error = nullptr;
+    if (caught)
+      std::rethrow_exception(caught);
+  }
+};
+
+PSUArray::PSUArray(double max_voltage, double max_current, bool verbose,
+                   double max_input_voltage, bool async_usb)
+    : context(FGUSBSharedContext::Get().GetContext()) {
+  if (context == nullptr) {
+    Shout("PSUArray: unable to initialize USB context.");
+    return;
+  }
+  event_loop = FGUSBSharedContext::Get().GetEventLoop();
+
+  // A single (cached) enumeration locates every board
+  std::vector<libusb_device *> found = FGUSBFindDevices(
+      context, FGAnalogPSUInterface::VendorID, FGAnalogPSUInterface::ProductID);
+  try {
+    for (size_t i = 0; i < found.size(); ++i) {
+      devices.emplace_back(new HeinzingerVia16BitDAC(
+          context, found[i], (int)i, max_voltage, max_current, verbose,
+          max_input_voltage));
+      if (async_usb)
+        devices.back()->set_async_usb(true, event_loop);
+    }
+  } catch (const std::exception &e) {
+    std::string which = "PSUArray: board " + std::to_string(devices.size()) +
+                        " of " + std::to_string(found.size()) + ": ";
+    FGUSBReleaseDevices(found);
+    throw std::runtime_error(which + e.what());
+  }
+  FGUSBReleaseDevices(found);
+  for (size_t i = 1; i < devices.size(); ++i)
+    workers.emplace_back(new worker());
+
+  if (verbose)
+    std::cout << "PSUArray: " << devices.size() << " board(s) opened."
+              << std::endl;
+}
+
+PSUArray::~PSUArray() {
+  // Boards close their handles and detach from the event loop first. Loop
+  // and context are the process-wide ones.
+  workers.clear();
+  devices.clear();
+  event_loop.reset();
+}
+
+HeinzingerVia16BitDAC &PSUArray::at(size_t index) {
+  if (index >= devices.size())
+    throw std::out_of_range("PSUArray index out of range");
+  return *devices[index];
+}
+
+// Runs fn(board, index) for every board concurrently and collects the
+// results in board order. Each board is serialized by its own query lock,
+// so the boards proceed independently on the bus.
+template <class F> std::vector<HeinzingerSnapshot> PSUArray::fan_out(F fn) {
+  std::vector<HeinzingerSnapshot> results(devices.size());
+  if (devices.empty())
+    return results;
+
+  std::lock_guard<std::mutex> guard(fan_out_lock);
+  for (size_t i = 1; i < devices.size(); ++i) {
+    HeinzingerVia16BitDAC *psu = devices[i].get();
+    HeinzingerSnapshot *out = &results[i];
+    workers[i - 1]->post([psu, i, out, &fn]() { *out = fn(*psu, i); });
+  }
+  std::exception_ptr first;
+  try {
+    results[0] = fn(*devices[0], 0);
+  } catch (...) {
+    first = std::current_exception();
+  }
+  // Every worker must be done with fn and results before returning
+  for (size_t i = 0; i < workers.size(); ++i) {
+    try {
+      workers[i]->wait();
+    } catch (...) {
+      if (!first)
+        first = std::current_exception();
+    }
+  }
+  if (first)
+    std::rethrow_exception(first);
+  return results;
+}
+
+std::vector<HeinzingerSnapshot> PSUArray::read_all() {
+  return fan_out([](HeinzingerVia16BitDAC &psu, size_t) {
+    return psu.read_snapshot();
+  });
+}
+
+std::vector<HeinzingerSnapshot>
+PSUArray::apply_all(const std::vector<double> &volts,
+                    const std::vector<double> &currs,
+                    const std::vector<int> &relays) {
+  const size_t n = devices.size();
+  if ((!volts.empty() && volts.size() != n) ||
+      (!currs.empty() && currs.size() != n) ||
+      (!relays.empty() && relays.size() != n))
+    throw std::invalid_argument(
+        "PSUArray::apply_all: need one value per board (or none)");
+
+  return fan_out([&](HeinzingerVia16BitDAC &psu, size_t i) {
+    return psu.apply(volts.empty() ? NAN : volts[i],
+                     currs.empty() ? NAN : currs[i],
+                     relays.empty() ? -1 : relays[i]);
+  });
+}
+
+std::vector<HeinzingerSnapshot> PSUArray::switch_all(bool on) {
+  return fan_out([on](HeinzingerVia16BitDAC &psu, size_t) {
+    return psu.apply(NAN, NAN, on ? 1 : 0);
+  });
+}
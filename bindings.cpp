@@ -1,11 +1,20 @@
+#include <pybind11/numpy.h> // For zero-copy views of the capture ring
 #include <pybind11/pybind11.h>
 #include <pybind11/stl.h> // For automatic C++/Python STL conversions if needed elsewhere
 
+#include "headers/ADCFrames.h" // For bulk reduction of raw ADC frames
 #include "headers/Error.h" // Include Error.h again for direct access to 'extern int Verbosity'
 #include "headers/Heinzinger.h" // This includes AnalogPSU.h -> FGUSBBulk.h -> Error.h (for Verbosity decl)
+#include "headers/PSUArray.h"
 
 namespace py = pybind11;
 
+// Every call that may reach the USB bus drops the GIL for its duration, so
+// other Python threads keep running while this one waits on libusb.
+// Concurrent callers on the same device are serialized by
+// FGAnalogPSUInterface::QueryMutex.
+using release_gil = py::call_guard<py::gil_scoped_release>;
+
 // --- Getter and Setter for global C++ Verbosity ---
 // These functions will be called from Python.
 // 'Verbosity' is declared as 'extern int Verbosity;' in Error.h
@@ -14,37 +23,1451 @@ int get_cpp_global_verbosity() { return Verbosity; }
 
 void set_cpp_global_verbosity(int v) { Verbosity = v; }
 
+// Per-board optional values for PSUArray: None leaves every board unchanged,
+// otherwise one entry per board where None leaves that board unchanged.
+std::vector<double> optional_values(py::object values) {
+  std::vector<double> out;
+  if (values.is_none())
+    return out;
+  for (py::handle v : values.cast<py::list>())
+    out.push_back(v.is_none() ? NAN : v.cast<double>());
+  return out;
+}
+
+std::vector<int> optional_relays(py::object values) {
+  std::vector<int> out;
+  if (values.is_none())
+    return out;
+  for (py::handle v : values.cast<py::list>())
+    out.push_back(v.is_none() ? -1 : (v.cast<bool>() ? 1 : 0));
+  return out;
+}
+
+// Ramp points from a sequence of (time_s, voltage, current) tuples, where
+// None leaves that channel unchanged.
+std::vector<FGRampPoint> ramp_points(py::object points) {
+  std::vector<FGRampPoint> out;
+  for (py::handle item : points.cast<py::list>()) {
+    py::tuple p = item.cast<py::tuple>();
+    if (p.size() != 3)
+      throw py::value_error("ramp points are (time_s, voltage, current)");
+    FGRampPoint point;
+    point.TimeS = p[0].cast<double>();
+    point.Voltage = p[1].is_none() ? NAN : p[1].cast<double>();
+    point.Current = p[2].is_none() ? NAN : p[2].cast<double>();
+    out.push_back(point);
+  }
+  return out;
+}
+
+// Result of psu.submit(). std::future is move-only, so Python gets a shared
+// one that any number of threads may wait on.
+struct SnapshotFuture {
+  std::shared_future<HeinzingerSnapshot> future;
+};
+
+const char *ramp_state_name(HeinzingerRampState state) {
+  switch (state) {
+  case ramp_state_idle:
+    return "idle";
+  case ramp_state_running:
+    return "running";
+  case ramp_state_done:
+    return "done";
+  case ramp_state_cancelled:
+    return "cancelled";
+  case ramp_state_failed:
+    return "failed";
+  }
+  return "unknown";
+}
+
+const char *sweep_state_name(HeinzingerSweepState state) {
+  switch (state) {
+  case sweep_state_idle:
+    return "idle";
+  case sweep_state_running:
+    return "running";
+  case sweep_state_done:
+    return "done";
+  case sweep_state_cancelled:
+    return "cancelled";
+  case sweep_state_failed:
+    return "failed";
+  }
+  return "unknown";
+}
+
+const char *interlock_kind_name(FGInterlockKind kind) {
+  switch (kind) {
+  case FGInterlockKind::Above:
+    return "above";
+  case FGInterlockKind::Below:
+    return "below";
+  case FGInterlockKind::RateAbove:
+    return "rate";
+  case FGInterlockKind::ErrorWord:
+    return "errors";
+  }
+  return "unknown";
+}
+
+FGInterlockKind interlock_kind(const std::string &name) {
+  if (name == "above")
+    return FGInterlockKind::Above;
+  if (name == "below")
+    return FGInterlockKind::Below;
+  if (name == "rate")
+    return FGInterlockKind::RateAbove;
+  if (name == "errors")
+    return FGInterlockKind::ErrorWord;
+  throw py::value_error("kind must be one of above, below, rate, errors");
+}
+
+const char *interlock_channel_name(FGInterlockChannel channel) {
+  switch (channel) {
+  case FGInterlockChannel::Voltage:
+    return "voltage";
+  case FGInterlockChannel::Current:
+    return "current";
+  case FGInterlockChannel::Errors:
+    return "errors";
+  }
+  return "unknown";
+}
+
+FGInterlockChannel interlock_channel(const std::string &name) {
+  if (name == "voltage")
+    return FGInterlockChannel::Voltage;
+  if (name == "current")
+    return FGInterlockChannel::Current;
+  if (name == "errors")
+    return FGInterlockChannel::Errors;
+  throw py::value_error("channel must be one of voltage, current, errors");
+}
+
+FGSweepConfig sweep_config(double settle_time, unsigned samples_per_point,
+                           const std::string &reduce, double settle_tolerance,
+                           unsigned settle_window, double sample_hz,
+                           const std::string &channel) {
+  FGSweepConfig config;
+  if (!FGParseSweepReduce(reduce, config.Reduce))
+    throw py::value_error("reduce must be mean or median");
+  if (channel != "voltage" && channel != "current")
+    throw py::value_error("channel must be voltage or current");
+  config.SettleTime = settle_time;
+  config.SamplesPerPoint = samples_per_point;
+  config.SettleTolerance = settle_tolerance;
+  config.SettleWindow = settle_window;
+  config.SampleHz = sample_hz;
+  config.SweepCurrent = channel == "current";
+  return config;
+}
+
+// Sweep results as rows of (setpoint, V, std V, I, std I)
+py::array_t<double> sweep_array(const std::vector<HeinzingerSweepPoint> &pts) {
+  py::array_t<double> out(
+      std::vector<py::ssize_t>{(py::ssize_t)pts.size(), 5});
+  double *dst = out.mutable_data();
+  for (const HeinzingerSweepPoint &p : pts) {
+    *dst++ = p.setpoint;
+    *dst++ = p.voltage;
+    *dst++ = p.voltage_std;
+    *dst++ = p.current;
+    *dst++ = p.current_std;
+  }
+  return out;
+}
+
+// Why a sweep ended early, for the exception raised by sweep()/sweep_async()
+std::string sweep_failure(const HeinzingerVia16BitDAC &board,
+                          const HeinzingerSweepStatus &st) {
+  return "Sweep failed after " + std::to_string(st.points_done) + " of " +
+         std::to_string(st.points_total) + " points: " +
+         (board.interlock_tripped() ? "refused by the interlock"
+                                    : "the exchange failed") +
+         "; the last setpoint stays applied";
+}
+
+std::vector<std::string> change_reasons(unsigned reasons) {
+  std::vector<std::string> out;
+  if (reasons & change_voltage)
+    out.push_back("voltage");
+  if (reasons & change_current)
+    out.push_back("current");
+  if (reasons & change_relay)
+    out.push_back("relay");
+  if (reasons & change_errors)
+    out.push_back("errors");
+  if (reasons & change_interlock)
+    out.push_back("interlock");
+  return out;
+}
+
+// Adapts a Python callable to a change callback. It is invoked on the
+// feed's dispatcher thread, which takes the GIL only for the call itself
+// (and to drop the last reference to the callable).
+std::function<void(const HeinzingerChange &)> change_callback(py::function fn) {
+  std::shared_ptr<py::function> held(new py::function(fn), [](py::function *f) {
+    py::gil_scoped_acquire gil;
+    delete f;
+  });
+  return [held](const HeinzingerChange &change) {
+    py::gil_scoped_acquire gil;
+    try {
+      (*held)(change);
+    } catch (py::error_already_set &e) {
+      e.discard_as_unraisable("heinzinger_control change callback");
+    }
+  };
+}
+
+// asyncio future completed from a C++ thread. It is created on the running
+// event loop and resolved through loop.call_soon_threadsafe(), so an awaiter
+// costs no thread of its own; the loop skips it if it was cancelled in the
+// meantime. Loop and future are only touched and released with the GIL.
+struct AsyncResult {
+  py::object loop, future;
+};
+
+std::shared_ptr<AsyncResult> async_result() {
+  std::shared_ptr<AsyncResult> r(new AsyncResult(), [](AsyncResult *p) {
+    py::gil_scoped_acquire gil;
+    delete p;
+  });
+  r->loop = py::module_::import("asyncio").attr("get_running_loop")();
+  r->future = r->loop.attr("create_future")();
+  return r;
+}
+
+// Hands value to the future's loop; with the GIL held.
+void resolve_async(const AsyncResult &r, py::object value) {
+  py::object future = r.future;
+  try {
+    r.loop.attr("call_soon_threadsafe")(py::cpp_function([future, value]() {
+      if (!future.attr("done")().cast<bool>())
+        future.attr("set_result")(value);
+    }));
+  } catch (py::error_already_set &e) {
+    e.discard_as_unraisable("heinzinger_control async result"); // loop closed
+  }
+}
+
+// Fails the future with a new exception_type(message); with the GIL held.
+void reject_async(const AsyncResult &r, const char *exception_type,
+                  const std::string &message) {
+  py::object future = r.future;
+  py::object error =
+      py::module_::import("builtins").attr(exception_type)(message);
+  try {
+    r.loop.attr("call_soon_threadsafe")(py::cpp_function([future, error]() {
+      if (!future.attr("done")().cast<bool>())
+        future.attr("set_exception")(error);
+    }));
+  } catch (py::error_already_set &e) {
+    e.discard_as_unraisable("heinzinger_control async result"); // loop closed
+  }
+}
+
+std::function<void(const HeinzingerSnapshot &)>
+snapshot_done(const std::shared_ptr<AsyncResult> &r) {
+  return [r](const HeinzingerSnapshot &snap) {
+    py::gil_scoped_acquire gil;
+    resolve_async(*r, py::cast(snap));
+  };
+}
+
+// Holder deleter that drops the GIL while a board is destroyed: its worker
+// threads are joined and may be waiting for the GIL to complete a callback.
+template <typename T> struct release_gil_delete {
+  void operator()(T *p) const {
+    py::gil_scoped_release release;
+    delete p;
+  }
+};
+
+// Wraps the capture ring storage in a NumPy structured array without
+// copying. The array's base capsule holds a reference to the storage, so the
+// view stays valid even after a new capture reallocates the ring.
+py::array capture_view(const HeinzingerVia16BitDAC &psu) {
+  typedef std::shared_ptr<FGCaptureRing::Storage> StoragePtr;
+  StoragePtr *owner = new StoragePtr(psu.capture_storage());
+  py::capsule base(owner,
+                   [](void *p) { delete static_cast<StoragePtr *>(p); });
+  return py::array_t<FGCaptureSample>(
+      std::vector<py::ssize_t>{(py::ssize_t)(*owner)->size()},
+      std::vector<py::ssize_t>{(py::ssize_t)sizeof(FGCaptureSample)},
+      (*owner)->data(), base);
+}
+
+// Converts an array of raw monitor ADC counts (any shape) to volts or amps
+// with the board's current calibration, in one pass outside the GIL.
+py::array_t<double>
+convert_monitor(const HeinzingerVia16BitDAC &psu,
+                py::array_t<uint16_t, py::array::c_style | py::array::forcecast>
+                    raw,
+                bool current) {
+  FGPSUCalibration cal = psu.get_calibration();
+  std::vector<py::ssize_t> shape(raw.shape(), raw.shape() + raw.ndim());
+  py::array_t<double> out(shape);
+  const uint16_t *in = raw.data();
+  double *dst = out.mutable_data();
+  size_t n = (size_t)raw.size();
+  {
+    py::gil_scoped_release release;
+    if (current)
+      cal.Currents(in, n, 1, dst);
+    else
+      cal.Voltages(in, n, 1, dst);
+  }
+  return out;
+}
+
+// Zero-copy NumPy view of a mapped recording; the base capsule keeps the
+// mapping alive for as long as the array (or any view of it) exists.
+py::array recording_view(std::shared_ptr<FGRecordingReader> reader) {
+  typedef std::shared_ptr<FGRecordingReader> ReaderPtr;
+  ReaderPtr *owner = new ReaderPtr(reader);
+  py::capsule base(owner, [](void *p) { delete static_cast<ReaderPtr *>(p); });
+  py::array_t<FGRecordSample> view(
+      std::vector<py::ssize_t>{(py::ssize_t)reader->GetCount()},
+      std::vector<py::ssize_t>{(py::ssize_t)sizeof(FGRecordSample)},
+      reader->GetRecords(), base);
+  view.attr("setflags")(false); // the mapping is read-only
+  return view;
+}
+
+// Copies the telemetry ring samples from index `since` on into a new
+// structured array (the ring keeps being overwritten, so no view).
+py::tuple telemetry_read(const HeinzingerTelemetryReader &reader,
+                         uint64_t since) {
+  std::vector<FGCaptureSample> *buf = new std::vector<FGCaptureSample>();
+  uint64_t next;
+  {
+    py::gil_scoped_release release;
+    next = reader.Read(since, *buf);
+  }
+  py::capsule base(buf, [](void *p) {
+    delete static_cast<std::vector<FGCaptureSample> *>(p);
+  });
+  py::array_t<FGCaptureSample> samples(
+      std::vector<py::ssize_t>{(py::ssize_t)buf->size()},
+      std::vector<py::ssize_t>{(py::ssize_t)sizeof(FGCaptureSample)},
+      buf->data(), base);
+  return py::make_tuple(samples, next);
+}
+
+// Raw ADC frames as accepted by reduce_frames/convert_frames: either a
+// capture_buffer() (or a slice of it), read in place through its adca/adcb
+// fields, or an (N, 8) array of ADCA[4] + ADCB[4] counts. 16-bit integer
+// arrays are read in place; anything else is converted once to uint16, which
+// keeps the bit pattern of negative ADCA counts.
+struct FrameSource {
+  py::array keep; // owns the memory the pointer refers to
+  const uint8_t *first = nullptr;
+  size_t count = 0;
+  size_t stride = 0;
+};
+
+FrameSource frame_source(py::array frames) {
+  FrameSource src;
+  if (py::isinstance<py::array_t<FGCaptureSample>>(frames)) {
+    if (frames.ndim() != 1)
+      throw py::value_error("capture frames must be one-dimensional");
+    src.keep = frames;
+    src.first = static_cast<const uint8_t *>(frames.data()) +
+                offsetof(FGCaptureSample, adca);
+    src.count = (size_t)frames.shape(0);
+    src.stride = (size_t)frames.strides(0);
+    return src;
+  }
+  bool in_place = (py::isinstance<py::array_t<uint16_t>>(frames) ||
+                   py::isinstance<py::array_t<int16_t>>(frames)) &&
+                  frames.ndim() == 2 && frames.strides(1) == 2;
+  if (!in_place)
+    frames = py::array_t<uint16_t, py::array::c_style | py::array::forcecast>(
+        frames);
+  if (frames.ndim() != 2 || frames.shape(1) != FGFrameChannels)
+    throw py::value_error("frames must have shape (N, 8): adca[4], adcb[4]");
+  src.keep = frames;
+  src.first = static_cast<const uint8_t *>(frames.data());
+  src.count = (size_t)frames.shape(0);
+  src.stride = (size_t)frames.strides(0);
+  return src;
+}
+
+FGReduceMode reduce_mode(const std::string &name, size_t block) {
+  FGReduceMode mode;
+  if (!FGParseReduceMode(name, mode))
+    throw py::value_error("mode must be one of decimate, mean, min, max, rms");
+  if (block == 0)
+    throw py::value_error("block must be at least 1");
+  return mode;
+}
+
+// Reduces the frames to an (ceil(N / block), 8) float64 array, scaled per
+// channel by scale (nullptr: counts), outside the GIL.
+py::array_t<double> reduce_frames(py::array frames, size_t block,
+                                  const std::string &mode_name,
+                                  const double *scale) {
+  FGReduceMode mode = reduce_mode(mode_name, block);
+  FrameSource src = frame_source(frames);
+  size_t rows = FGReducedRows(src.count, block);
+  py::array_t<double> out(std::vector<py::ssize_t>{
+      (py::ssize_t)rows, (py::ssize_t)FGFrameChannels});
+  double *dst = out.mutable_data();
+  {
+    py::gil_scoped_release release;
+    FGReduceFrames(src.first, src.count, src.stride, block, mode, scale, dst);
+  }
+  return out;
+}
+
+// Output voltage and current (ADCB[2], ADCB[3]) of each block of frames.
+py::tuple convert_frames(const HeinzingerVia16BitDAC &psu, py::array frames,
+                         size_t block, const std::string &mode_name) {
+  FGPSUCalibration cal = psu.get_calibration();
+  double scale[FGFrameChannels] = {0, 0, 0, 0, 0, 0, cal.VoltsPerCount(),
+                                   cal.AmpsPerCount()};
+  py::array_t<double> reduced = reduce_frames(frames, block, mode_name, scale);
+  size_t rows = (size_t)reduced.shape(0);
+  py::array_t<double> voltage((py::ssize_t)rows), current((py::ssize_t)rows);
+  const double *in = reduced.data();
+  double *v = voltage.mutable_data(), *c = current.mutable_data();
+  for (size_t r = 0; r < rows; ++r) {
+    v[r] = in[r * FGFrameChannels + 6];
+    c[r] = in[r * FGFrameChannels + 7];
+  }
+  return py::make_tuple(voltage, current);
+}
+
+// Time spent in PYBIND11_MODULE, i.e. the C++ share of the import
+static uint64_t module_init_ns = 0;
+
+static double ns_to_ms(uint64_t ns) { return (double)ns * 1e-6; }
+
+// Where the time to the first command went, in ms since the module load
+static std::map<std::string, double> startup_timings() {
+  const FGStartupTimes &t = FGStartup();
+  uint64_t origin = t.OriginNs.load(), first = t.FirstExchangeNs.load();
+  std::map<std::string, double> out;
+  out["module_init_ms"] = ns_to_ms(module_init_ns);
+  out["context_init_ms"] = ns_to_ms(t.ContextInitNs.load());
+  out["enumerations"] = (double)t.Enumerations.load();
+  out["enumeration_ms"] = ns_to_ms(t.EnumerationNs.load());
+  out["cached_lookups"] = (double)t.CachedLookups.load();
+  out["device_opens"] = (double)t.Opens.load();
+  out["device_open_ms"] = ns_to_ms(t.OpenNs.load());
+  out["hotplug_events"] = (double)t.HotplugEvents.load();
+  // NAN until the first successful exchange
+  out["first_exchange_ms"] =
+      first != 0 && first >= origin ? ns_to_ms(first - origin) : NAN;
+  return out;
+}
+
 PYBIND11_MODULE(heinzinger_control, m) {
+  FGStartup().MarkOrigin();
+  uint64_t init_start = FGMonotonicNs();
   m.doc() = "Python bindings for Heinzinger Power Supply Control";
 
-  py::class_<HeinzingerVia16BitDAC>(m, "HeinzingerPSU")
+  PYBIND11_NUMPY_DTYPE(FGCaptureSample, timestamp_ns, sequence_no, errors,
+                       daca, dacb, adca, adcb);
+  PYBIND11_NUMPY_DTYPE(FGRecordSample, timestamp_ns, sequence_no, errors, daca,
+                       dacb, adca, adcb, relay, flags);
+
+  py::class_<HeinzingerSnapshot>(m, "PSUSnapshot")
+      .def_readonly("ok", &HeinzingerSnapshot::ok,
+                    "False if the readout failed (other fields are stale).")
+      .def_readonly("voltage", &HeinzingerSnapshot::voltage)
+      .def_readonly("current", &HeinzingerSnapshot::current)
+      .def_readonly("relay", &HeinzingerSnapshot::relay)
+      .def_readonly("daca", &HeinzingerSnapshot::daca)
+      .def_readonly("dacb", &HeinzingerSnapshot::dacb)
+      .def_readonly("sequence_no", &HeinzingerSnapshot::sequence_no)
+      .def_readonly("errors", &HeinzingerSnapshot::errors)
+      .def_readonly("timestamp_ns", &HeinzingerSnapshot::timestamp_ns,
+                    "Monotonic clock timestamp of the readout.")
+      .def_readonly("adca", &HeinzingerSnapshot::adca)
+      .def_readonly("adcb", &HeinzingerSnapshot::adcb)
+      .def("__repr__", [](const HeinzingerSnapshot &s) {
+        return "<PSUSnapshot ok=" + std::string(s.ok ? "True" : "False") +
+               " voltage=" + std::to_string(s.voltage) +
+               " current=" + std::to_string(s.current) +
+               " relay=" + std::string(s.relay ? "True" : "False") +
+               " daca=" + std::to_string(s.daca) +
+               " dacb=" + std::to_string(s.dacb) +
+               " seq=" + std::to_string(s.sequence_no) +
+               " errors=0x" + ToHex(s.errors) + ">";
+      });
+
+  py::class_<SnapshotFuture>(m, "SnapshotFuture",
+                             "Pending result of psu.submit().")
+      .def("done",
+           [](const SnapshotFuture &f) {
+             return f.future.wait_for(std::chrono::seconds(0)) ==
+                    std::future_status::ready;
+           })
+      .def(
+          "result",
+          [](const SnapshotFuture &f, py::object timeout) -> py::object {
+            double t = timeout.is_none() ? -1.0 : timeout.cast<double>();
+            bool ready = true;
+            {
+              py::gil_scoped_release release;
+              if (t < 0)
+                f.future.wait();
+              else
+                ready = f.future.wait_for(std::chrono::duration<double>(t)) ==
+                        std::future_status::ready;
+            }
+            if (!ready)
+              return py::none();
+            return py::cast(f.future.get());
+          },
+          py::arg("timeout") = py::none(),
+          "Waits (without the GIL) for the PSUSnapshot read back with the "
+          "command this submission went out with; None on timeout.");
+
+  py::class_<FGRecordingReader, std::shared_ptr<FGRecordingReader>>(
+      m, "Recording",
+      "Read-only memory map of a file written by psu.start_recording().")
+      .def(py::init([](const std::string &path) {
+             std::shared_ptr<FGRecordingReader> reader =
+                 std::make_shared<FGRecordingReader>();
+             if (!reader->Open(path))
+               throw std::runtime_error("Not a readable recording: " + path);
+             return reader;
+           }),
+           py::arg("path"))
+      .def_property_readonly("records", &recording_view,
+                             "Zero-copy structured array of all records "
+                             "(timestamp_ns, sequence_no, errors, daca, dacb, "
+                             "adca[4], adcb[4], relay, flags).")
+      .def("__len__", &FGRecordingReader::GetCount)
+      .def_property_readonly("closed_cleanly",
+                             [](const FGRecordingReader &r) {
+                               return r.GetHeader().RecordCount != 0 ||
+                                      r.GetCount() == 0;
+                             })
+      .def_property_readonly("start_ns",
+                             [](const FGRecordingReader &r) {
+                               return r.GetHeader().StartNs;
+                             },
+                             "Monotonic time of the start (timestamp_ns scale)")
+      .def_property_readonly("start_unix_ns",
+                             [](const FGRecordingReader &r) {
+                               return r.GetHeader().StartUnixNs;
+                             })
+      .def_property_readonly("max_voltage",
+                             [](const FGRecordingReader &r) {
+                               return r.GetHeader().MaxVoltage;
+                             })
+      .def_property_readonly("max_current",
+                             [](const FGRecordingReader &r) {
+                               return r.GetHeader().MaxCurrent;
+                             })
+      .def_property_readonly("volts_per_count",
+                             [](const FGRecordingReader &r) {
+                               return r.GetHeader().VoltsPerCount;
+                             },
+                             "Scale of adcb[2] at the time of recording")
+      .def_property_readonly("amps_per_count",
+                             [](const FGRecordingReader &r) {
+                               return r.GetHeader().AmpsPerCount;
+                             },
+                             "Scale of adcb[3] at the time of recording")
+      .def_property_readonly("layout",
+                             [](const FGRecordingReader &r) {
+                               return std::string(r.GetHeader().Layout);
+                             })
+      .def_property_readonly("comment", [](const FGRecordingReader &r) {
+        return std::string(r.GetHeader().Comment);
+      });
+
+  py::class_<HeinzingerTelemetryReader>(
+      m, "TelemetryReader",
+      "Read-only client of the shared-memory telemetry published by "
+      "another process with psu.start_shared_telemetry(); never touches "
+      "USB.")
+      .def(py::init([](const std::string &name) {
+             std::unique_ptr<HeinzingerTelemetryReader> reader(
+                 new HeinzingerTelemetryReader());
+             if (!reader->Attach(name))
+               throw std::runtime_error("No compatible telemetry segment " +
+                                        name);
+             return reader;
+           }),
+           py::arg("name"))
+      .def(
+          "latest",
+          [](const HeinzingerTelemetryReader &r) -> py::object {
+            HeinzingerSnapshot snap;
+            if (!r.Latest(snap))
+              return py::none();
+            return py::cast(snap);
+          },
+          "Latest PSUSnapshot published, or None if there is none yet.")
+      .def("read", &telemetry_read, py::arg("since") = 0,
+           "Returns (samples, next): the ring samples from index `since` on "
+           "that are still held (capture_buffer() dtype), and the index to "
+           "pass next time.")
+      .def("count", &HeinzingerTelemetryReader::Count,
+           "Samples published into the ring so far.")
+      .def("published", &HeinzingerTelemetryReader::Published)
+      .def("capacity", &HeinzingerTelemetryReader::Capacity)
+      .def("heartbeat_age", [](const HeinzingerTelemetryReader &r) {
+             return r.HeartbeatAgeNs() * 1e-9;
+           },
+           "Seconds since the owner last published.")
+      .def("writer_alive", &HeinzingerTelemetryReader::WriterAlive);
+
+  py::class_<HeinzingerChange>(m, "ChangeEvent")
+      .def_readonly("sequence", &HeinzingerChange::sequence,
+                    "Increases by one per event; pass as `since` to "
+                    "wait_for_change() to get the next one. The last 64 "
+                    "events are kept, so nothing in between is missed "
+                    "unless the caller falls further behind.")
+      .def_property_readonly(
+          "reasons",
+          [](const HeinzingerChange &c) { return change_reasons(c.reasons); },
+          "Any of 'voltage', 'current', 'relay', 'errors', 'interlock'")
+      .def_readonly("snapshot", &HeinzingerChange::snapshot)
+      .def("__repr__", [](const HeinzingerChange &c) {
+        std::string reasons;
+        for (const std::string &r : change_reasons(c.reasons))
+          reasons += (reasons.empty() ? "" : ",") + r;
+        return "<ChangeEvent seq=" + std::to_string(c.sequence) + " " +
+               reasons + ">";
+      });
+
+  py::class_<HeinzingerRampStatus>(m, "RampStatus")
+      .def_property_readonly("state",
+                             [](const HeinzingerRampStatus &s) {
+                               return ramp_state_name(s.state);
+                             },
+                             "idle, running, done, cancelled or failed")
+      .def_readonly("steps", &HeinzingerRampStatus::steps)
+      .def_readonly("failed_steps", &HeinzingerRampStatus::failed_steps)
+      .def_readonly("overruns", &HeinzingerRampStatus::overruns)
+      .def_readonly("elapsed_s", &HeinzingerRampStatus::elapsed_s)
+      .def_readonly("duration_s", &HeinzingerRampStatus::duration_s)
+      .def_readonly("voltage", &HeinzingerRampStatus::voltage,
+                    "Last voltage setpoint sent (NaN: none yet)")
+      .def_readonly("current", &HeinzingerRampStatus::current)
+      .def("__repr__", [](const HeinzingerRampStatus &s) {
+        return "<RampStatus " + std::string(ramp_state_name(s.state)) +
+               " steps=" + std::to_string(s.steps) +
+               " failed=" + std::to_string(s.failed_steps) +
+               " elapsed_s=" + std::to_string(s.elapsed_s) + "/" +
+               std::to_string(s.duration_s) + ">";
+      });
+
+  py::class_<FGPIConfig>(m, "PIConfig",
+                         "Gains and limits of one regulation channel; assign "
+                         "to psu.voltage_loop or psu.current_loop.")
+      .def(py::init<>())
+      .def(py::init([](bool enabled, double kp, double ki, double deadband,
+                       double max_rate, double max_trim) {
+             FGPIConfig c;
+             c.Enabled = enabled;
+             c.Kp = kp;
+             c.Ki = ki;
+             c.Deadband = deadband;
+             c.MaxRate = max_rate;
+             c.MaxTrim = max_trim;
+             return c;
+           }),
+           py::arg("enabled") = true, py::arg("kp") = 0.2,
+           py::arg("ki") = 20.0, py::arg("deadband") = 0.0,
+           py::arg("max_rate") = 0.0, py::arg("max_trim") = 0.05)
+      .def_readwrite("enabled", &FGPIConfig::Enabled)
+      .def_readwrite("kp", &FGPIConfig::Kp,
+                     "command change per unit of error")
+      .def_readwrite("ki", &FGPIConfig::Ki,
+                     "command change per unit of error and second")
+      .def_readwrite("deadband", &FGPIConfig::Deadband,
+                     "errors up to this size are ignored")
+      .def_readwrite("max_rate", &FGPIConfig::MaxRate,
+                     "largest command change per second, 0: unlimited")
+      .def_readwrite("max_trim", &FGPIConfig::MaxTrim,
+                     "largest |command - setpoint| as a fraction of full "
+                     "scale, 0: the whole output range")
+      .def("__repr__", [](const FGPIConfig &c) {
+        return "<PIConfig enabled=" +
+               std::string(c.Enabled ? "True" : "False") +
+               " kp=" + std::to_string(c.Kp) + " ki=" + std::to_string(c.Ki) +
+               " deadband=" + std::to_string(c.Deadband) +
+               " max_rate=" + std::to_string(c.MaxRate) +
+               " max_trim=" + std::to_string(c.MaxTrim) + ">";
+      });
+
+  py::class_<FGInterlockRule>(
+      m, "InterlockRule",
+      "Limit evaluated on every acquired sample; trips once its condition "
+      "has held for hold_s seconds. Pass to psu.add_interlock_rule().")
+      .def(py::init([](const std::string &kind, py::object channel,
+                       double limit, double hold_s, const std::string &name,
+                       uint16_t mask, bool require_relay) {
+             FGInterlockRule r;
+             r.Kind = interlock_kind(kind);
+             if (!channel.is_none())
+               r.Channel = interlock_channel(channel.cast<std::string>());
+             else if (r.Kind == FGInterlockKind::ErrorWord)
+               r.Channel = FGInterlockChannel::Errors;
+             r.Limit = limit;
+             r.HoldS = hold_s;
+             r.Name = name.empty() ? std::string(interlock_channel_name(
+                                         r.Channel)) + " " + kind
+                                   : name;
+             r.Mask = mask;
+             r.RequireRelay = require_relay;
+             return r;
+           }),
+           py::arg("kind"), py::arg("channel") = py::none(),
+           py::arg("limit") = 0.0, py::arg("hold_s") = 0.0,
+           py::arg("name") = "", py::arg("mask") = 0xFFFF,
+           py::arg("require_relay") = false,
+           "kind: 'above'/'below' (value beyond limit), 'rate' (|d/dt| "
+           "above limit per second) or 'errors' (error word & mask "
+           "non-zero, 0xF00 excepted); channel: 'voltage' (default), "
+           "'current' or, for 'errors', 'errors'.")
+      .def_readwrite("name", &FGInterlockRule::Name)
+      .def_property(
+          "kind",
+          [](const FGInterlockRule &r) { return interlock_kind_name(r.Kind); },
+          [](FGInterlockRule &r, const std::string &k) {
+            r.Kind = interlock_kind(k);
+          })
+      .def_property(
+          "channel",
+          [](const FGInterlockRule &r) {
+            return interlock_channel_name(r.Channel);
+          },
+          [](FGInterlockRule &r, const std::string &c) {
+            r.Channel = interlock_channel(c);
+          })
+      .def_readwrite("limit", &FGInterlockRule::Limit)
+      .def_readwrite("hold_s", &FGInterlockRule::HoldS,
+                     "time the condition must persist, 0: first sample")
+      .def_readwrite("mask", &FGInterlockRule::Mask)
+      .def_readwrite("require_relay", &FGInterlockRule::RequireRelay,
+                     "only evaluated while the output relay is on")
+      .def("__repr__", [](const FGInterlockRule &r) {
+        return "<InterlockRule '" + r.Name + "' " +
+               interlock_channel_name(r.Channel) + " " +
+               interlock_kind_name(r.Kind) + " " + std::to_string(r.Limit) +
+               ">";
+      });
+
+  py::class_<HeinzingerInterlockStatus>(m, "InterlockStatus")
+      .def_readonly("tripped", &HeinzingerInterlockStatus::tripped,
+                    "latched until psu.reset_interlock()")
+      .def_readonly("rule", &HeinzingerInterlockStatus::rule,
+                    "index of the rule that tripped, -1: none")
+      .def_readonly("rule_name", &HeinzingerInterlockStatus::rule_name)
+      .def_readonly("value", &HeinzingerInterlockStatus::value,
+                    "what the rule tested (a rate for rate rules)")
+      .def_readonly("trip_ns", &HeinzingerInterlockStatus::trip_ns,
+                    "timestamp_ns of the sample that tripped")
+      .def_readonly("shutdown_ns", &HeinzingerInterlockStatus::shutdown_ns,
+                    "when relay-off + DAC-zero was acknowledged, 0: pending")
+      .def_readonly("trips", &HeinzingerInterlockStatus::trips)
+      .def_readonly("snapshot", &HeinzingerInterlockStatus::snapshot)
+      .def("__repr__", [](const HeinzingerInterlockStatus &s) {
+        return s.tripped ? "<InterlockStatus tripped by '" + s.rule_name + "'>"
+                         : std::string("<InterlockStatus ok>");
+      });
+
+  py::class_<HeinzingerSweepStatus>(m, "SweepStatus")
+      .def_property_readonly("state",
+                             [](const HeinzingerSweepStatus &s) {
+                               return sweep_state_name(s.state);
+                             },
+                             "idle, running, done, cancelled or failed")
+      .def_readonly("points_done", &HeinzingerSweepStatus::points_done)
+      .def_readonly("points_total", &HeinzingerSweepStatus::points_total)
+      .def_readonly("failed_readouts", &HeinzingerSweepStatus::failed_readouts)
+      .def_readonly("settle_timeouts", &HeinzingerSweepStatus::settle_timeouts,
+                    "points that did not settle within settle_time")
+      .def_readonly("elapsed_s", &HeinzingerSweepStatus::elapsed_s)
+      .def("__repr__", [](const HeinzingerSweepStatus &s) {
+        return "<SweepStatus " + std::string(sweep_state_name(s.state)) +
+               " " + std::to_string(s.points_done) + "/" +
+               std::to_string(s.points_total) + ">";
+      });
+
+  py::class_<HeinzingerSweepPoint>(m, "SweepPoint")
+      .def_readonly("setpoint", &HeinzingerSweepPoint::setpoint)
+      .def_readonly("voltage", &HeinzingerSweepPoint::voltage,
+                    "mean or median of the samples")
+      .def_readonly("voltage_std", &HeinzingerSweepPoint::voltage_std)
+      .def_readonly("current", &HeinzingerSweepPoint::current)
+      .def_readonly("current_std", &HeinzingerSweepPoint::current_std)
+      .def_readonly("samples", &HeinzingerSweepPoint::samples)
+      .def_readonly("settle_s", &HeinzingerSweepPoint::settle_s,
+                    "time from the step to the first sample")
+      .def_readonly("settled", &HeinzingerSweepPoint::settled,
+                    "the readback settled before settle_time ran out");
+
+  py::class_<HeinzingerRegulationStatus>(m, "RegulationStatus")
+      .def_readonly("running", &HeinzingerRegulationStatus::running)
+      .def_readonly("cycles", &HeinzingerRegulationStatus::cycles)
+      .def_readonly("failed_cycles", &HeinzingerRegulationStatus::failed_cycles)
+      .def_readonly("held_cycles", &HeinzingerRegulationStatus::held_cycles,
+                    "cycles without fresh readback, with both loops held")
+      .def_readonly("overruns", &HeinzingerRegulationStatus::overruns)
+      .def_readonly("voltage_error", &HeinzingerRegulationStatus::voltage_error,
+                    "setpoint - measured at the last cycle")
+      .def_readonly("current_error", &HeinzingerRegulationStatus::current_error)
+      .def_readonly("voltage_command",
+                    &HeinzingerRegulationStatus::voltage_command,
+                    "value programmed in place of the voltage setpoint")
+      .def_readonly("current_command",
+                    &HeinzingerRegulationStatus::current_command);
+
+  py::class_<FGPSUCalibration>(
+      m, "Calibration",
+      "DAC/ADC scaling of one PSU; read psu.calibration, change fields and "
+      "assign it back.")
+      .def_readwrite("max_voltage", &FGPSUCalibration::MaxVolt)
+      .def_readwrite("max_current", &FGPSUCalibration::MaxCurr)
+      .def_readwrite("max_input_voltage", &FGPSUCalibration::MaxInputVolt)
+      .def_readwrite("board_max_voltage", &FGPSUCalibration::BoardMaxVolt,
+                     "DAC output at full scale (11.3 V nominal)")
+      .def_readwrite("headroom", &FGPSUCalibration::Headroom,
+                     "setpoint headroom factor (0.98 nominal)")
+      .def_readwrite("monitor_full_scale", &FGPSUCalibration::MonitorFullScale)
+      .def_readwrite("adc_input_scale", &FGPSUCalibration::ADCInputScale,
+                     "monitor ADC input volts at full count")
+      .def_property_readonly("voltage_correction_points",
+                             [](const FGPSUCalibration &c) {
+                               return c.VoltageCorrection.Size();
+                             })
+      .def_property_readonly("current_correction_points",
+                             [](const FGPSUCalibration &c) {
+                               return c.CurrentCorrection.Size();
+                             })
+      .def("voltage_register", &FGPSUCalibration::VoltageRegister)
+      .def("current_register", &FGPSUCalibration::CurrentRegister)
+      .def("voltage", &FGPSUCalibration::Voltage)
+      .def("current", &FGPSUCalibration::Current);
+
+  py::class_<FGUSBTransferPolicy>(m, "TransferPolicy",
+                                  "Retry behaviour of USB transfers; assign "
+                                  "to psu.readout_policy or "
+                                  "psu.command_policy.")
+      .def(py::init<>())
+      .def(py::init([](int attempts, unsigned timeout_ms, double backoff_ms,
+                       double backoff_factor, double max_backoff_ms,
+                       double deadline_ms) {
+             FGUSBTransferPolicy p;
+             p.Attempts = attempts;
+             p.TimeoutMs = timeout_ms;
+             p.BackoffMs = backoff_ms;
+             p.BackoffFactor = backoff_factor;
+             p.MaxBackoffMs = max_backoff_ms;
+             p.DeadlineMs = deadline_ms;
+             return p;
+           }),
+           py::arg("attempts") = 10, py::arg("timeout_ms") = 100,
+           py::arg("backoff_ms") = 10.0, py::arg("backoff_factor") = 1.0,
+           py::arg("max_backoff_ms") = 10.0, py::arg("deadline_ms") = 0.0)
+      .def_readwrite("attempts", &FGUSBTransferPolicy::Attempts)
+      .def_readwrite("timeout_ms", &FGUSBTransferPolicy::TimeoutMs,
+                     "libusb timeout of each attempt")
+      .def_readwrite("backoff_ms", &FGUSBTransferPolicy::BackoffMs,
+                     "pause before the first retry")
+      .def_readwrite("backoff_factor", &FGUSBTransferPolicy::BackoffFactor,
+                     "growth of the pause per further retry")
+      .def_readwrite("max_backoff_ms", &FGUSBTransferPolicy::MaxBackoffMs)
+      .def_readwrite("deadline_ms", &FGUSBTransferPolicy::DeadlineMs,
+                     "budget for a whole command/response exchange, 0: none")
+      .def("__repr__", [](const FGUSBTransferPolicy &p) {
+        return "<TransferPolicy attempts=" + std::to_string(p.Attempts) +
+               " timeout_ms=" + std::to_string(p.TimeoutMs) +
+               " backoff_ms=" + std::to_string(p.BackoffMs) +
+               " backoff_factor=" + std::to_string(p.BackoffFactor) +
+               " max_backoff_ms=" + std::to_string(p.MaxBackoffMs) +
+               " deadline_ms=" + std::to_string(p.DeadlineMs) + ">";
+      });
+
+  py::class_<HeinzingerVia16BitDAC,
+             std::unique_ptr<HeinzingerVia16BitDAC,
+                             release_gil_delete<HeinzingerVia16BitDAC>>>(
+      m, "HeinzingerPSU")
       .def(py::init<int, double, double, bool, double>(),
            py::arg("device_index")    = 0,
            py::arg("max_voltage") = 50000.0,
            py::arg("max_current") = 0.0005, // 0.5 mA
            py::arg("verbose") =
                false, // This sets FGAnalogPSUInterface::Verbose member
-           py::arg("max_input_voltage") = 10.0)
+           py::arg("max_input_voltage") = 10.0, release_gil())
+      .def(py::init<const std::string &, const std::string &, double, double,
+                    bool, double>(),
+           py::arg("serial") = "", py::arg("usb_path") = "",
+           py::arg("max_voltage") = 50000.0,
+           py::arg("max_current") = 0.0005, // 0.5 mA
+           py::arg("verbose") = false, py::arg("max_input_voltage") = 10.0,
+           release_gil(),
+           "Opens the board with the given USB serial number or, if serial "
+           "is empty, at the given port path (e.g. \"1-2.3\"). Use keyword "
+           "arguments, e.g. HeinzingerPSU(serial=\"A0A0-0001\").")
+      .def_property_readonly("usb_serial", &HeinzingerVia16BitDAC::usb_serial)
+      .def_property_readonly("usb_path", &HeinzingerVia16BitDAC::usb_path)
       .def("switch_on", &HeinzingerVia16BitDAC::switch_on,
+           release_gil(),
            "Switches the PSU relay on.")
       .def("switch_off", &HeinzingerVia16BitDAC::switch_off,
+           release_gil(),
            "Switches the PSU relay off.")
       .def("set_voltage", &HeinzingerVia16BitDAC::set_voltage,
+           release_gil(),
            py::arg("set_val"), "Sets the output voltage.")
       .def("set_current", &HeinzingerVia16BitDAC::set_current,
+           release_gil(),
            py::arg("set_val"), "Sets the output current limit.")
       .def("read_voltage", &HeinzingerVia16BitDAC::read_voltage,
+           release_gil(),
            "Reads the measured output voltage.")
       .def("read_current", &HeinzingerVia16BitDAC::read_current,
+           release_gil(),
            "Reads the measured output current.")
+      .def("read_snapshot", &HeinzingerVia16BitDAC::read_snapshot,
+           release_gil(),
+           "Reads voltage, current, relay, DAC readback, sequence number and "
+           "error word from a single USB round trip.")
+      .def(
+          "read_snapshot_async",
+          [](HeinzingerVia16BitDAC &self) {
+            std::shared_ptr<AsyncResult> r = async_result();
+            py::object future = r->future;
+            {
+              py::gil_scoped_release release;
+              self.read_snapshot_async(snapshot_done(r));
+            }
+            return future;
+          },
+          "Awaitable read_snapshot(): the readout is queued like submit() "
+          "and shared by every reader waiting at the same time (the cached "
+          "snapshot while acquisition runs). Call from a running asyncio "
+          "loop.")
+      .def(
+          "apply",
+          [](HeinzingerVia16BitDAC &self, py::object voltage,
+             py::object current, py::object relay) {
+            double v = voltage.is_none() ? NAN : voltage.cast<double>();
+            double c = current.is_none() ? NAN : current.cast<double>();
+            int r = relay.is_none() ? -1 : (relay.cast<bool>() ? 1 : 0);
+            py::gil_scoped_release release;
+            return self.apply(v, c, r);
+          },
+          py::arg("voltage") = py::none(), py::arg("current") = py::none(),
+          py::arg("relay") = py::none(),
+          "Applies any of voltage, current and relay (None = unchanged) in a "
+          "single USB round trip and returns the resulting PSUSnapshot.")
+      .def(
+          "apply_async",
+          [](HeinzingerVia16BitDAC &self, py::object voltage,
+             py::object current, py::object relay) {
+            double v = voltage.is_none() ? NAN : voltage.cast<double>();
+            double c = current.is_none() ? NAN : current.cast<double>();
+            int rl = relay.is_none() ? -1 : (relay.cast<bool>() ? 1 : 0);
+            std::shared_ptr<AsyncResult> r = async_result();
+            py::object future = r->future;
+            {
+              py::gil_scoped_release release;
+              self.submit(v, c, rl, snapshot_done(r));
+            }
+            return future;
+          },
+          py::arg("voltage") = py::none(), py::arg("current") = py::none(),
+          py::arg("relay") = py::none(),
+          "Awaitable apply() through the submit() queue: resolves to the "
+          "PSUSnapshot of the combined command it went out with.")
+      .def(
+          "submit",
+          [](HeinzingerVia16BitDAC &self, py::object voltage,
+             py::object current, py::object relay) {
+            double v = voltage.is_none() ? NAN : voltage.cast<double>();
+            double c = current.is_none() ? NAN : current.cast<double>();
+            int r = relay.is_none() ? -1 : (relay.cast<bool>() ? 1 : 0);
+            py::gil_scoped_release release;
+            SnapshotFuture f;
+            f.future = self.submit(v, c, r).share();
+            return f;
+          },
+          py::arg("voltage") = py::none(), py::arg("current") = py::none(),
+          py::arg("relay") = py::none(),
+          "Queues any of voltage, current and relay (None = unchanged) and "
+          "returns a SnapshotFuture at once. Submissions arriving while a "
+          "command is on the bus are merged, the last value per channel "
+          "winning, and sent as one command as soon as the bus is free.")
+      .def("start_command_queue", &HeinzingerVia16BitDAC::start_command_queue,
+           release_gil(), "Starts the submit() thread; done on first use.")
+      .def("stop_command_queue", &HeinzingerVia16BitDAC::stop_command_queue,
+           release_gil(), "Sends what is still pending and stops the thread.")
+      .def("command_queue_running",
+           &HeinzingerVia16BitDAC::command_queue_running)
+      .def(
+          "start_ramp",
+          [](HeinzingerVia16BitDAC &self, py::object points,
+             double update_hz) {
+            std::vector<FGRampPoint> p = ramp_points(points);
+            py::gil_scoped_release release;
+            return self.start_ramp(p, update_hz);
+          },
+          py::arg("points"), py::arg("update_hz") = 100.0,
+          "Runs a ramp through (time_s, voltage, current) points (None = "
+          "unchanged) on a C++ thread, interpolating update_hz times a "
+          "second on absolute deadlines. Returns immediately.")
+      .def(
+          "ramp_to",
+          [](HeinzingerVia16BitDAC &self, py::object voltage, double volt_slew,
+             py::object current, double curr_slew, double update_hz) {
+            double v = voltage.is_none() ? NAN : voltage.cast<double>();
+            double c = current.is_none() ? NAN : current.cast<double>();
+            py::gil_scoped_release release;
+            return self.ramp_to(v, volt_slew, c, curr_slew, update_hz);
+          },
+          py::arg("voltage") = py::none(), py::arg("volt_slew") = 0.0,
+          py::arg("current") = py::none(), py::arg("curr_slew") = 0.0,
+          py::arg("update_hz") = 100.0,
+          "Ramps from the last setpoints to voltage/current at no more than "
+          "volt_slew/curr_slew units per second (0: step).")
+      .def("cancel_ramp", &HeinzingerVia16BitDAC::cancel_ramp, release_gil(),
+           "Stops the ramp; the setpoints stay where the ramp left them.")
+      .def("add_interlock_rule", &HeinzingerVia16BitDAC::add_interlock_rule,
+           release_gil(), py::arg("rule"),
+           "Adds an InterlockRule, evaluated by the acquisition thread on "
+           "every sample. A trip switches the relay off and zeroes both DACs "
+           "at once and latches; setters then refuse until reset_interlock().")
+      .def("clear_interlock_rules",
+           &HeinzingerVia16BitDAC::clear_interlock_rules, release_gil())
+      .def("interlock_rules", &HeinzingerVia16BitDAC::interlock_rules,
+           release_gil())
+      .def("interlock_status", &HeinzingerVia16BitDAC::interlock_status,
+           release_gil())
+      .def("interlock_tripped", &HeinzingerVia16BitDAC::interlock_tripped)
+      .def("reset_interlock", &HeinzingerVia16BitDAC::reset_interlock,
+           release_gil(),
+           "Clears the latch; False while the shutdown is not acknowledged.")
+      .def(
+          "sweep",
+          [](HeinzingerVia16BitDAC &self, std::vector<double> points,
+             double settle_time, unsigned samples_per_point,
+             const std::string &reduce, double settle_tolerance,
+             unsigned settle_window, double sample_hz,
+             const std::string &channel) {
+            FGSweepConfig config =
+                sweep_config(settle_time, samples_per_point, reduce,
+                             settle_tolerance, settle_window, sample_hz,
+                             channel);
+            bool started;
+            {
+              py::gil_scoped_release release;
+              started = self.start_sweep(points, config);
+            }
+            if (!started)
+              throw py::value_error("Sweep not started, see the message "
+                                    "above");
+            // Waits in slices so that Ctrl-C cancels the sweep
+            for (;;) {
+              bool ended;
+              {
+                py::gil_scoped_release release;
+                ended = self.wait_sweep(0.1);
+              }
+              if (ended)
+                break;
+              if (PyErr_CheckSignals() != 0) {
+                {
+                  py::gil_scoped_release release;
+                  self.cancel_sweep();
+                }
+                throw py::error_already_set();
+              }
+            }
+            HeinzingerSweepStatus st = self.sweep_status();
+            if (st.state == sweep_state_failed)
+              throw std::runtime_error(sweep_failure(self, st));
+            return sweep_array(self.sweep_results());
+          },
+          py::arg("points"), py::arg("settle_time") = 5.0,
+          py::arg("samples_per_point") = 10, py::arg("reduce") = "mean",
+          py::arg("settle_tolerance") = 0.0, py::arg("settle_window") = 10,
+          py::arg("sample_hz") = 100.0, py::arg("channel") = "voltage",
+          "Steps through the setpoints on a C++ thread and returns an (N, 5) "
+          "array of (setpoint, V, std V, I, std I), reduced over "
+          "samples_per_point readouts by mean or median (with the scaled "
+          "MAD as spread). Each point waits settle_time seconds, or with "
+          "settle_tolerance > 0 only until the last settle_window readbacks "
+          "agree within it. sample_hz <= 0 reads out as fast as possible. "
+          "Raises RuntimeError if the sweep failed (see sweep_results() "
+          "for the points measured) and on KeyboardInterrupt stops it.")
+      .def(
+          "sweep_async",
+          [](HeinzingerVia16BitDAC &self, std::vector<double> points,
+             double settle_time, unsigned samples_per_point,
+             const std::string &reduce, double settle_tolerance,
+             unsigned settle_window, double sample_hz,
+             const std::string &channel) {
+            FGSweepConfig config =
+                sweep_config(settle_time, samples_per_point, reduce,
+                             settle_tolerance, settle_window, sample_hz,
+                             channel);
+            std::shared_ptr<AsyncResult> r = async_result();
+            py::object future = r->future;
+            bool started;
+            {
+              py::gil_scoped_release release;
+              started = self.start_sweep(points, config);
+              if (started)
+                self.on_sweep_done(
+                    [r, &self](
+                        const std::vector<HeinzingerSweepPoint> &results) {
+                      HeinzingerSweepStatus st = self.sweep_status();
+                      std::string failure;
+                      if (st.state == sweep_state_failed)
+                        failure = sweep_failure(self, st);
+                      py::gil_scoped_acquire gil;
+                      if (st.state == sweep_state_failed)
+                        reject_async(*r, "RuntimeError", failure);
+                      else
+                        resolve_async(*r, sweep_array(results));
+                    });
+            }
+            if (!started)
+              reject_async(*r, "ValueError",
+                           "Sweep not started, see the message above");
+            return future;
+          },
+          py::arg("points"), py::arg("settle_time") = 5.0,
+          py::arg("samples_per_point") = 10, py::arg("reduce") = "mean",
+          py::arg("settle_tolerance") = 0.0, py::arg("settle_window") = 10,
+          py::arg("sample_hz") = 100.0, py::arg("channel") = "voltage",
+          "Awaitable sweep(): starts the sweep and resolves to its (N, 5) "
+          "array from the sweep thread once it ends; raises like sweep() "
+          "if it could not start or failed.")
+      .def(
+          "start_sweep",
+          [](HeinzingerVia16BitDAC &self, std::vector<double> points,
+             double settle_time, unsigned samples_per_point,
+             const std::string &reduce, double settle_tolerance,
+             unsigned settle_window, double sample_hz,
+             const std::string &channel) {
+            FGSweepConfig config =
+                sweep_config(settle_time, samples_per_point, reduce,
+                             settle_tolerance, settle_window, sample_hz,
+                             channel);
+            py::gil_scoped_release release;
+            return self.start_sweep(points, config);
+          },
+          py::arg("points"), py::arg("settle_time") = 5.0,
+          py::arg("samples_per_point") = 10, py::arg("reduce") = "mean",
+          py::arg("settle_tolerance") = 0.0, py::arg("settle_window") = 10,
+          py::arg("sample_hz") = 100.0, py::arg("channel") = "voltage",
+          "Like sweep(), but returns immediately; see wait_sweep() and "
+          "sweep_results().")
+      .def(
+          "wait_sweep",
+          [](HeinzingerVia16BitDAC &self, py::object timeout) {
+            double t = timeout.is_none() ? -1.0 : timeout.cast<double>();
+            py::gil_scoped_release release;
+            return self.wait_sweep(t);
+          },
+          py::arg("timeout") = py::none(),
+          "Blocks (without the GIL) until the sweep ends; False on timeout.")
+      .def("cancel_sweep", &HeinzingerVia16BitDAC::cancel_sweep,
+           release_gil(), "Stops the sweep; the last setpoint stays applied.")
+      .def("sweep_running", &HeinzingerVia16BitDAC::sweep_running)
+      .def("sweep_status", &HeinzingerVia16BitDAC::sweep_status)
+      .def(
+          "sweep_results",
+          [](const HeinzingerVia16BitDAC &self) {
+            return sweep_array(self.sweep_results());
+          },
+          "(N, 5) array of the points measured so far, as from sweep().")
+      .def("sweep_details", &HeinzingerVia16BitDAC::sweep_results,
+           "SweepPoint of every point measured so far, with sample counts "
+           "and settle times.")
+      .def("start_regulation", &HeinzingerVia16BitDAC::start_regulation,
+           release_gil(), py::arg("rate_hz") = 200.0,
+           "Starts the closed-loop PI regulation of the enabled channels "
+           "towards the last setpoints, one combined command per cycle.")
+      .def("stop_regulation", &HeinzingerVia16BitDAC::stop_regulation,
+           release_gil())
+      .def("regulation_running", &HeinzingerVia16BitDAC::regulation_running)
+      .def("regulation_status", &HeinzingerVia16BitDAC::regulation_status,
+           release_gil())
+      // Both sides take the bus lock, so the accessors drop the GIL too
+      .def_property(
+          "voltage_loop",
+          py::cpp_function(&HeinzingerVia16BitDAC::get_voltage_loop,
+                           release_gil()),
+          py::cpp_function(&HeinzingerVia16BitDAC::set_voltage_loop,
+                           release_gil()),
+          "PIConfig of the voltage channel (copy; assign to change)")
+      .def_property(
+          "current_loop",
+          py::cpp_function(&HeinzingerVia16BitDAC::get_current_loop,
+                           release_gil()),
+          py::cpp_function(&HeinzingerVia16BitDAC::set_current_loop,
+                           release_gil()),
+          "PIConfig of the current channel, disabled by default")
+      .def("ramp_running", &HeinzingerVia16BitDAC::ramp_running)
+      .def("ramp_status", &HeinzingerVia16BitDAC::ramp_status)
+      .def("ramp_readback", &HeinzingerVia16BitDAC::ramp_readback,
+           "PSUSnapshot readback of every step of the current or last ramp.")
       .def("set_max_volt", &HeinzingerVia16BitDAC::set_max_volt,
+           release_gil(),
            "Sets the voltage to its maximum configured value.")
       .def("set_max_curr", &HeinzingerVia16BitDAC::set_max_curr,
+           release_gil(),
            "Sets the current limit to its maximum configured value.")
       .def("is_relay_on", &HeinzingerVia16BitDAC::is_relay_on,
+           release_gil(),
          "Return True if the PSU output relay is closed (output ON).")
       .def("readADC", &HeinzingerVia16BitDAC::readADC,
-           "Reads and prints raw ADC values (for debugging).");
+           release_gil(),
+           "Reads and prints raw ADC values (for debugging).")
+      .def_property("verify", &HeinzingerVia16BitDAC::get_verify,
+                    &HeinzingerVia16BitDAC::set_verify,
+                    "If True, every setter performs an extra readout and "
+                    "checks that the DAC/relay readback matches the command. "
+                    "Off by default: the command's own response is trusted.")
+      .def_property("async_usb", &HeinzingerVia16BitDAC::is_async_usb,
+                    [](HeinzingerVia16BitDAC &self, bool enable) {
+                      py::gil_scoped_release release;
+                      self.set_async_usb(enable);
+                    },
+                    "Use the asynchronous libusb transport (transfers "
+                    "completed on a C++ event thread, response read posted "
+                    "before the command write).")
+      .def_property_readonly("set_voltage_value",
+                             &HeinzingerVia16BitDAC::get_set_voltage,
+                             "Last voltage setpoint accepted by the device.")
+      .def_property_readonly("set_current_value",
+                             &HeinzingerVia16BitDAC::get_set_current,
+                             "Last current setpoint accepted by the device.")
+      .def("start_acquisition", &HeinzingerVia16BitDAC::start_acquisition,
+           release_gil(), py::arg("rate_hz") = 100.0,
+           "Starts a C++ thread polling the board at rate_hz (<= 0: as fast "
+           "as possible). While it runs, read_voltage/read_current/"
+           "read_snapshot/is_relay_on return cached values without USB "
+           "traffic.")
+      .def("stop_acquisition", &HeinzingerVia16BitDAC::stop_acquisition,
+           release_gil(), "Stops the background acquisition thread.")
+      .def("acquisition_running", &HeinzingerVia16BitDAC::acquisition_running)
+      .def_property_readonly("acquisition_errors",
+                             &HeinzingerVia16BitDAC::get_acquisition_errors,
+                             "Number of failed background readouts.")
+      .def_property("verbose", &HeinzingerVia16BitDAC::get_verbose,
+                    &HeinzingerVia16BitDAC::set_verbose,
+                    "Record every command/response frame into the trace ring.")
+      .def("dump_trace", &HeinzingerVia16BitDAC::dump_trace, release_gil(),
+           "Formats the recorded trace (frames, and USB attempts when "
+           "Verbosity > 1), oldest first.")
+      .def("clear_trace", &HeinzingerVia16BitDAC::clear_trace)
+      .def_property(
+          "calibration", &HeinzingerVia16BitDAC::get_calibration,
+          [](HeinzingerVia16BitDAC &self, const FGPSUCalibration &cal) {
+            if (!self.set_calibration(cal))
+              throw py::value_error("Calibration rejected, see the message "
+                                    "above");
+          },
+          "Analog chain scaling; max_voltage, max_current and "
+          "max_input_voltage must stay as constructed.")
+      .def("load_voltage_correction",
+           &HeinzingerVia16BitDAC::load_voltage_correction, py::arg("csv"),
+           "Loads a 'setpoint,measured' linearity CSV; later voltage "
+           "setpoints are corrected so the measured output matches.")
+      .def("load_current_correction",
+           &HeinzingerVia16BitDAC::load_current_correction, py::arg("csv"))
+      .def("clear_corrections", &HeinzingerVia16BitDAC::clear_corrections)
+      .def(
+          "raw_to_voltage",
+          [](const HeinzingerVia16BitDAC &psu, py::array raw) {
+            return convert_monitor(psu, raw, false);
+          },
+          py::arg("raw"),
+          "Converts raw voltage-monitor counts (e.g. capture_buffer()"
+          "['adcb'][:, 2]) to output voltage.")
+      .def(
+          "raw_to_current",
+          [](const HeinzingerVia16BitDAC &psu, py::array raw) {
+            return convert_monitor(psu, raw, true);
+          },
+          py::arg("raw"), "Converts raw current-monitor counts to current.")
+      .def("convert_frames", &convert_frames, py::arg("frames"),
+           py::arg("block") = 1, py::arg("mode") = "decimate",
+           "Converts raw ADC frames (capture_buffer() or an (N, 8) array) to "
+           "(voltage, current) arrays, one value per block of `block` frames "
+           "reduced with mode decimate, mean, min, max or rms.")
+      .def("reconnect", &HeinzingerVia16BitDAC::reconnect, release_gil(),
+           "Reopens the board, clears endpoint stalls and replays the last "
+           "commanded voltage/current/relay state.")
+      .def_property("auto_reconnect",
+                    &HeinzingerVia16BitDAC::get_auto_reconnect,
+                    &HeinzingerVia16BitDAC::set_auto_reconnect,
+                    "Reconnect automatically after USB link errors.")
+      .def_property("readout_policy",
+                    &HeinzingerVia16BitDAC::get_readout_policy,
+                    &HeinzingerVia16BitDAC::set_readout_policy,
+                    "TransferPolicy of plain readouts (copy; assign to change)")
+      .def_property("command_policy",
+                    &HeinzingerVia16BitDAC::get_command_policy,
+                    &HeinzingerVia16BitDAC::set_command_policy,
+                    "TransferPolicy of setpoint/relay commands (copy; assign "
+                    "to change)")
+      .def("stats", &HeinzingerVia16BitDAC::stats, release_gil(),
+           "Returns query/USB counters and latency percentiles (in us) as a "
+           "flat dict, ready to be exported by the services.")
+      .def("reset_stats", &HeinzingerVia16BitDAC::reset_stats)
+      .def("latest", &HeinzingerVia16BitDAC::latest,
+           "Returns the most recent snapshot published by the acquisition "
+           "thread without touching USB (ok=False until the first one and "
+           "after a failed cycle).")
+      .def("start_recording", &HeinzingerVia16BitDAC::start_recording,
+           release_gil(), py::arg("path"), py::arg("comment") = "",
+           "Records every acquired readout into a compact binary file "
+           "written by a background thread; open it with Recording(path). "
+           "Needs the acquisition thread.")
+      .def("stop_recording", &HeinzingerVia16BitDAC::stop_recording,
+           release_gil(), "Flushes and closes the recording.")
+      .def("recording", &HeinzingerVia16BitDAC::recording, release_gil())
+      .def("start_shared_telemetry",
+           &HeinzingerVia16BitDAC::start_shared_telemetry, py::arg("name"),
+           py::arg("capacity") = 65536,
+           "Publishes every acquired snapshot and raw sample into the POSIX "
+           "shared-memory segment `name` (e.g. '/heinzinger0') for "
+           "TelemetryReader clients in other processes. Needs the "
+           "acquisition thread.")
+      .def("stop_shared_telemetry",
+           &HeinzingerVia16BitDAC::stop_shared_telemetry, release_gil())
+      .def_property_readonly("shared_telemetry_name",
+                             &HeinzingerVia16BitDAC::shared_telemetry_name)
+      .def("set_change_thresholds",
+           &HeinzingerVia16BitDAC::set_change_thresholds, py::arg("voltage"),
+           py::arg("current"),
+           "Smallest voltage/current move that counts as a change "
+           "(default 0.1% of full scale).")
+      .def_property_readonly("voltage_threshold",
+                             &HeinzingerVia16BitDAC::get_voltage_threshold)
+      .def_property_readonly("current_threshold",
+                             &HeinzingerVia16BitDAC::get_current_threshold)
+      .def("change_sequence", &HeinzingerVia16BitDAC::change_sequence)
+      .def(
+          "wait_for_change",
+          [](const HeinzingerVia16BitDAC &self, py::object timeout,
+             py::object since) -> py::object {
+            double t = timeout.is_none() ? -1.0 : timeout.cast<double>();
+            bool from_now = since.is_none();
+            uint64_t after = from_now ? 0 : since.cast<uint64_t>();
+            HeinzingerChange change;
+            bool ok;
+            {
+              py::gil_scoped_release release;
+              if (from_now)
+                after = self.change_sequence();
+              ok = self.wait_for_change(after, t, change);
+            }
+            if (!ok)
+              return py::none();
+            return py::cast(change);
+          },
+          py::arg("timeout") = py::none(), py::arg("since") = py::none(),
+          "Blocks (without the GIL) until the acquisition thread sees a "
+          "change newer than sequence `since` (None: from now on) and "
+          "returns the first such ChangeEvent still kept, or None after "
+          "`timeout` seconds.")
+      .def(
+          "subscribe",
+          [](HeinzingerVia16BitDAC &self, py::function fn) {
+            return self.subscribe(change_callback(fn));
+          },
+          py::arg("callback"),
+          "Calls callback(ChangeEvent) from a dispatcher thread on changes; "
+          "changes arriving while it runs are coalesced into the latest. "
+          "Returns an id for unsubscribe().")
+      .def("unsubscribe", &HeinzingerVia16BitDAC::unsubscribe, py::arg("id"))
+      .def("start_capture", &HeinzingerVia16BitDAC::start_capture,
+           release_gil(), py::arg("capacity") = 65536, py::arg("rate_hz") = 0.0,
+           "Starts streaming raw samples into a preallocated ring of "
+           "`capacity` entries at rate_hz (<= 0: as fast as the bus allows).")
+      .def("stop_capture", &HeinzingerVia16BitDAC::stop_capture,
+           release_gil(), "Stops the streaming capture.")
+      .def("capture_running", &HeinzingerVia16BitDAC::capture_running)
+      .def("capture_count", &HeinzingerVia16BitDAC::capture_count,
+           "Total samples captured; may exceed the capacity once wrapped.")
+      .def("capture_head", &HeinzingerVia16BitDAC::capture_head,
+           "Ring slot of the next write, i.e. the oldest sample once the "
+           "ring has wrapped.")
+      .def("capture_capacity", &HeinzingerVia16BitDAC::capture_capacity)
+      .def("capture_buffer", &capture_view,
+           "Zero-copy NumPy view of the whole capture ring (structured "
+           "dtype: timestamp_ns, sequence_no, errors, daca, dacb, adca[4], "
+           "adcb[4]). Slots are filled live; use capture_count() and "
+           "capture_head() to find valid and chronologically first entries, "
+           "e.g. numpy.roll(buf, -head) once wrapped.");
+
+  py::class_<PSUArray, std::unique_ptr<PSUArray, release_gil_delete<PSUArray>>>(
+      m, "PSUArray")
+      .def(py::init<double, double, bool, double, bool>(),
+           py::arg("max_voltage") = 50000.0,
+           py::arg("max_current") = 0.0005, // 0.5 mA
+           py::arg("verbose") = false, py::arg("max_input_voltage") = 10.0,
+           py::arg("async_usb") = true, release_gil(),
+           "Opens every analog interface board found by a single bus scan "
+           "on one shared libusb context and event thread. Raises "
+           "RuntimeError naming the first board that fails to open.")
+      .def("__len__", &PSUArray::size)
+      .def("__getitem__", &PSUArray::at, py::return_value_policy::reference_internal,
+           "The HeinzingerPSU for board #index (enumeration order).")
+      .def("read_all", &PSUArray::read_all, release_gil(),
+           "Reads a PSUSnapshot from every board in parallel.")
+      .def(
+          "apply_all",
+          [](PSUArray &self, py::object voltages, py::object currents,
+             py::object relays) {
+            std::vector<double> v = optional_values(voltages);
+            std::vector<double> c = optional_values(currents);
+            std::vector<int> r = optional_relays(relays);
+            py::gil_scoped_release release;
+            return self.apply_all(v, c, r);
+          },
+          py::arg("voltages") = py::none(), py::arg("currents") = py::none(),
+          py::arg("relays") = py::none(),
+          "Applies per-board setpoints (lists with one entry per board, None "
+          "= unchanged) to every board in parallel, one round trip each.")
+      .def("switch_all", &PSUArray::switch_all, py::arg("on"), release_gil(),
+           "Switches every board's relay in parallel.");
+
+  m.def(
+      "list_boards",
+      []() {
+        py::gil_scoped_release release;
+        return FGUSBListLocations(FGAnalogPSUInterface::VendorID,
+                                  FGAnalogPSUInterface::ProductID);
+      },
+      "Lists (usb_path, serial) of every analog interface board, in "
+      "device_index order.");
+  m.def(
+      "reduce_frames",
+      [](py::array frames, size_t block, const std::string &mode) {
+        return reduce_frames(frames, block, mode, nullptr);
+      },
+      py::arg("frames"), py::arg("block") = 1, py::arg("mode") = "decimate",
+      "Reduces raw ADC frames (capture_buffer() or an (N, 8) array of "
+      "adca[4], adcb[4]) per block of `block` frames with mode decimate, "
+      "mean, min, max or rms. Returns an (ceil(N / block), 8) float64 array "
+      "of counts.");
+  py::class_<FGUSBLocation>(m, "USBLocation")
+      .def_property_readonly("usb_path", &FGUSBLocation::Path)
+      .def_readonly("serial", &FGUSBLocation::Serial)
+      .def("__repr__", [](const FGUSBLocation &l) {
+        return "<USBLocation usb_path=" + l.Path() + " serial=" + l.Serial +
+               ">";
+      });
 
   // Expose the global C++ Verbosity variable to Python using getter and setter
   // functions
@@ -52,4 +1475,13 @@ PYBIND11_MODULE(heinzinger_control, m) {
         "Gets the C++ global Verbosity level.");
   m.def("set_cpp_verbosity_level", &set_cpp_global_verbosity, py::arg("level"),
         "Sets the C++ global Verbosity level.");
+
+  m.def("startup_timings", &startup_timings,
+        "Returns where the startup went as a flat dict: module_init_ms, "
+        "context_init_ms, enumerations and enumeration_ms (bus scans), "
+        "cached_lookups (device lookups served without a scan), device_opens, "
+        "device_open_ms, hotplug_events and first_exchange_ms (module load "
+        "to the first successful exchange, NaN until then). The libusb "
+        "context is created on the first open or listing, not at import.");
+  module_init_ns = FGMonotonicNs() - init_start;
 }
\ No newline at end of file
@@ -0,0 +1,136 @@
+/*
+ * ADCFrames.h
+ *
+ * Bulk reduction of raw ADC frames: 8 channels of 16 bits per frame, ADCA[4]
+ * (signed) followed by ADCB[4] (unsigned), exactly as they sit in Status_t
+ * and in FGCaptureSample. Frames may be strided, so that capture buffers are
+ * processed in place.
+ *
+ * The inner loops run over the 8 channels with fixed-size accumulators, which
+ * compilers turn into SIMD code; a pass touches every input byte once.
+ */
+
+#ifndef SOURCE_ADCFRAMES_H_
+#define SOURCE_ADCFRAMES_H_
+
+#include <cmath>
+#include <cstring>
+#include <stddef.h>
+#include <stdint.h>
+#include <string>
+
+const int FGFrameChannels = 8; // ADCA[0..3], ADCB[0..3]
+
+enum FGReduceMode {
+  FGReduceDecimate, // first frame of each block
+  FGReduceMean,
+  FGReduceMin,
+  FGReduceMax,
+  FGReduceRMS,
+};
+
+// Parses "decimate", "mean", "min", "max" or "rms"; false if unknown.
+inline bool FGParseReduceMode(const std::string &Name, FGReduceMode &Mode) {
+  if (Name == "decimate")
+    Mode = FGReduceDecimate;
+  else if (Name == "mean")
+    Mode = FGReduceMean;
+  else if (Name == "min")
+    Mode = FGReduceMin;
+  else if (Name == "max")
+    Mode = FGReduceMax;
+  else if (Name == "rms")
+    Mode = FGReduceRMS;
+  else
+    return false;
+  return true;
+}
+
+// Number of output rows for Count frames in blocks of Block (the last block
+// may be shorter).
+inline size_t FGReducedRows(size_t Count, size_t Block) {
+  if (Block == 0)
+    Block = 1;
+  return (Count + Block - 1) / Block;
+}
+
+// Loads one frame as doubles, sign-extending the ADCA channels.
+inline void FGLoadFrame(const uint8_t *Frame, double *Values) {
+  uint16_t Raw[FGFrameChannels];
+  memcpy(Raw, Frame, sizeof(Raw));
+  for (int c = 0; c < 4; ++c)
+    Values[c] = (int16_t)Raw[c];
+  for (int c = 4; c < FGFrameChannels; ++c)
+    Values[c] = Raw[c];
+}
+
+// Reduces Count frames starting at First, StrideBytes apart, in blocks of
+// Block frames, writing FGReducedRows() rows of 8 values to Out. Each value
+// is multiplied by Scale[channel] (nullptr: raw counts). Returns the number
+// of rows written.
+inline size_t FGReduceFrames(const uint8_t *First, size_t Count,
+                             size_t StrideBytes, size_t Block,
+                             FGReduceMode Mode, const double *Scale,
+                             double *Out) {
+  if (Block == 0)
+    Block = 1;
+  size_t Rows = FGReducedRows(Count, Block);
+  double Unit[FGFrameChannels];
+  for (int c = 0; c < FGFrameChannels; ++c)
+    Unit[c] = Scale != nullptr ? Scale[c] : 1.0;
+
+  for (size_t r = 0; r < Rows; ++r) {
+    size_t Begin = r * Block;
+    size_t N = Count - Begin < Block ? Count - Begin : Block;
+    const uint8_t *Frame = First + Begin * StrideBytes;
+    double *Row = Out + r * FGFrameChannels;
+    double Acc[FGFrameChannels], V[FGFrameChannels];
+
+    FGLoadFrame(Frame, Acc);
+    switch (Mode) {
+    case FGReduceDecimate:
+      break;
+    case FGReduceMean:
+      for (size_t i = 1; i < N; ++i) {
+        FGLoadFrame(Frame + i * StrideBytes, V);
+        for (int c = 0; c < FGFrameChannels; ++c)
+          Acc[c] += V[c];
+      }
+      for (int c = 0; c < FGFrameChannels; ++c)
+        Acc[c] /= N;
+      break;
+    case FGReduceMin:
+      for (size_t i = 1; i < N; ++i) {
+        FGLoadFrame(Frame + i * StrideBytes, V);
+        for (int c = 0; c < FGFrameChannels; ++c)
+          Acc[c] = V[c] < Acc[c] ? V[c] : Acc[c];
+      }
+      break;
+    case FGReduceMax:
+      for (size_t i = 1; i < N; ++i) {
+        FGLoadFrame(Frame + i * StrideBytes, V);
+        for (int c = 0; c < FGFrameChannels; ++c)
+          Acc[c] = V[c] > Acc[c] ? V[c] : Acc[c];
+      }
+      break;
+    case FGReduceRMS:
+      for (int c = 0; c < FGFrameChannels; ++c)
+        Acc[c] *= Acc[c];
+      for (size_t i = 1; i < N; ++i) {
+        FGLoadFrame(Frame + i * StrideBytes, V);
+        for (int c = 0; c < FGFrameChannels; ++c)
+          Acc[c] += V[c] * V[c];
+      }
+      for (int c = 0; c < FGFrameChannels; ++c)
+        Acc[c] = std::sqrt(Acc[c] / N);
+      break;
+    }
+    // Scaling after the reduction is exact for every mode as long as the
+    // scale is non-negative.
+    for (int c = 0; c < FGFrameChannels; ++c)
+      Row[c] = Acc[c] * Unit[c];
+  }
+  return Rows;
+}
+
+#endif /* SOURCE_ADCFRAMES_H_ */
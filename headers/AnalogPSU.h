@@ -10,12 +10,16 @@
 #include "Error.h"          // Specifically for Warn, Shout
 #include "FGUSBBulk.h" // Includes FGBulk.h, Hex.h, Error.h, StringUtils.h, libusb, etc.
 #include "Hex.h"   // Specifically for ToHex, ToBin used in logging
+#include "StatusCodec.h" // Frame encoding, validation and decoding
 #include <cstring> // For memset
+#include <mutex>   // For the per-device query lock
 #include <stdint.h>
 
 class FGAnalogPSUInterface {
 public:
-  static constexpr uint32_t ExpectedMagic = 0xA4A7051F;
+  static constexpr uint32_t ExpectedMagic = FGStatusMagic;
+  static constexpr uint16_t VendorID = 0xA0A0;
+  static constexpr uint16_t ProductID = 0x000C;
 
 #pragma pack(push, 1)
   class Status_t {
@@ -35,37 +39,103 @@ public:
 
     uint8_t SetMask;
 
-    uint16_t ComputeChecksum() {
-      uint16_t TempRes = 0xFFFF;
-      uint16_t *p = (uint16_t *)this;
-      for (unsigned int i = 0; i * 2 < sizeof(struct Status_t); ++i) {
-        TempRes ^= *(p++);
-      }
-      return TempRes;
+    // 0 for a frame with a valid checksum
+    uint16_t ComputeChecksum() const {
+      return (uint16_t)(0xFFFF ^ FGStatusXor((const uint8_t *)this));
     }
   };
 #pragma pack(pop)
+  static_assert(sizeof(Status_t) <= sizeof(FGTraceRecord::Payload),
+                "Status_t frames must fit a trace record");
+  static_assert(sizeof(Status_t) == FGStatusFrameSize &&
+                    offsetof(Status_t, Checksum) == FGStatusChecksumOffset &&
+                    offsetof(Status_t, SequenceNo) == FGStatusFieldsOffset,
+                "StatusCodec.h must match Status_t");
 
   // --- Member variables remain the same ---
   FGUSBBulk Bridge;
-  int16_t ADCA[4];
-  uint16_t ADCB[4];
-  uint16_t DACA_val;
-  uint16_t DACB_val;
-  uint8_t Relay_val;
-  uint16_t SequenceNo_val;
-  uint16_t Errors;
+  // Fields of the last valid response, decoded in one copy; Response is the
+  // device error word.
+  FGStatusFields Readback;
+  // True if the last exchange returned a frame with valid magic and
+  // checksum: Readback is then fresh even if the query failed on a critical
+  // error word.
+  bool FrameValid = false;
+  uint64_t LastGoodNs = 0; // FGMonotonicNs() of the last successful query
+  // Reused frame buffers: commands are encoded in place and responses are
+  // received and validated in place.
+  FGStatusFrame TxFrame, RxFrame, ReplayFrame;
+  FGStatusFrame ReadoutFrame; // the constant readout command
+  // Which of several identical boards Open() picks: by serial number if set,
+  // else by port path if set, else the DeviceIndex-th match. Once a board
+  // has been opened, reopening reuses its cached identity instead.
+  int DeviceIndex = 0;
+  std::string Serial;
+  std::string Path;
   bool Verbose = true;
+  FGQueryStats Stats; // see also Bridge.Stats for the USB transfers
+  FGBulkBridge External; // used instead of Bridge.Bridge once attached
+  // Transfer policies of plain readouts (SetMask == 0) and of commands, so
+  // that polling can fail fast while setpoints keep retrying.
+  FGUSBTransferPolicy ReadoutPolicy;
+  FGUSBTransferPolicy CommandPolicy;
+  // Reconnect state, see Reconnect()
+  enum LinkState { LinkUp, LinkRecovering, LinkDown };
+  LinkState Link = LinkUp;
+  bool AutoReconnect = true;
+  uint8_t CommandedMask = 0; // which of the values below were ever commanded
+  uint16_t CommandedDACA = 0;
+  uint16_t CommandedDACB = 0;
+  uint8_t CommandedRelay = 0;
+  bool UseExternal = false;
+  // Serializes every exchange with the board (and the decoded fields above)
+  // between threads. Recursive so that callers can hold it across a Query()
+  // and the subsequent read of ADCA/ADCB/... for a consistent view.
+  mutable std::recursive_mutex QueryMutex;
 
   // --- Constructor, Open, Close, operator bool remain the same ---
-  FGAnalogPSUInterface()
-      : DACA_val(0), DACB_val(0), Relay_val(0), SequenceNo_val(0), Errors(0) {
+  FGAnalogPSUInterface() {
+    InitFrames();
     Open();
   }
+  // Tag for constructing the interface closed: set DeviceIndex, Serial or
+  // Path first and then call Open() once, so that only the wanted board is
+  // enumerated and claimed.
+  struct DeferOpen {};
+  explicit FGAnalogPSUInterface(DeferOpen) { InitFrames(); }
+  // Opens a board already located on a context shared with other boards
+  // (see FGUSBFindDevices), without scanning the bus again. Index is the
+  // board's position among matching devices, used when reopening.
+  FGAnalogPSUInterface(libusb_context *SharedContext, libusb_device *Device,
+                       int Index)
+      : DeviceIndex(Index) {
+    InitFrames();
+    Bridge.UseContext(SharedContext);
+    bool success = Bridge.OpenDevice(Device, 0);
+    if (Verbose && !success)
+      std::cout << "Refactored AnalogPSU: Failed to open USB Device #"
+                << Index << "." << std::endl;
+  }
   FGAnalogPSUInterface(const FGAnalogPSUInterface &) = delete;
+  void InitFrames() {
+    memset(&Readback, 0, sizeof(Readback));
+    memset(&TxFrame, 0, sizeof(TxFrame));
+    memset(&RxFrame, 0, sizeof(RxFrame));
+    memset(&ReplayFrame, 0, sizeof(ReplayFrame));
+    FGEncodeStatusCommand(ReadoutFrame.Bytes, 0, 0, 0, 0);
+  }
   bool Open() {
+    std::lock_guard<std::recursive_mutex> Lock(QueryMutex);
     Close();
-    bool success = Bridge.OpenDevice(0xA0A0, 0x000C, 0);
+    bool success;
+    if (Bridge.HasCachedDevice())
+      success = Bridge.Reopen();
+    else if (!Serial.empty())
+      success = Bridge.OpenBySerial(VendorID, ProductID, Serial, 0);
+    else if (!Path.empty())
+      success = Bridge.OpenByPath(VendorID, ProductID, Path, 0);
+    else
+      success = Bridge.OpenDevice(VendorID, ProductID, 0, DeviceIndex);
     if (Verbose && success)
       std::cout << "Refactored AnalogPSU: USB Device Opened." << std::endl;
     else if (Verbose && !success)
@@ -74,6 +144,7 @@ public:
     return success;
   }
   bool Close() {
+    std::lock_guard<std::recursive_mutex> Lock(QueryMutex);
     if (!Bridge)
       return false;
     Bridge.CloseDevice();
@@ -81,196 +152,251 @@ public:
       std::cout << "Refactored AnalogPSU: USB Device Closed." << std::endl;
     return true;
   }
-  operator bool() { return Bridge; }
+  operator bool() { return UseExternal || Bridge; }
 
-  // --- Setters and Readout remain the same ---
-  bool SetDACA(uint16_t A) {
-    Status_t cmdStatus;
-    memset(&cmdStatus, 0, sizeof(cmdStatus));
-    cmdStatus.MagicNo = ExpectedMagic;
-    cmdStatus.SetMask = 1;
-    cmdStatus.DACA = A;
-    return Query(cmdStatus);
+  // Routes all queries through Link instead of the USB device, e.g. to a
+  // simulated or replayed board (see SimulatedBoard.h). The USB device is
+  // closed and not reopened.
+  void AttachBridge(const FGBulkBridge &Link) {
+    std::lock_guard<std::recursive_mutex> Lock(QueryMutex);
+    Close();
+    External = Link;
+    UseExternal = true;
   }
-  bool SetDACB(uint16_t B) {
-    Status_t cmdStatus;
-    memset(&cmdStatus, 0, sizeof(cmdStatus));
-    cmdStatus.MagicNo = ExpectedMagic;
-    cmdStatus.SetMask = 2;
-    cmdStatus.DACB = B;
-    return Query(cmdStatus);
+  bool HasExternalBridge() const { return UseExternal; }
+
+  // Keeps the USB transfer layer (policies, retries, statistics, trace) but
+  // has Hook stand in for the device below it, e.g. a simulated board. The
+  // USB device is closed and not reopened.
+  void AttachTransfers(const FGUSBTransferHook &Hook) {
+    std::lock_guard<std::recursive_mutex> Lock(QueryMutex);
+    Close();
+    UseExternal = false;
+    Bridge.UseHook(Hook);
   }
-  bool SetRelay(bool Power) {
-    Status_t cmdStatus;
-    memset(&cmdStatus, 0, sizeof(cmdStatus));
-    cmdStatus.MagicNo = ExpectedMagic;
-    cmdStatus.SetMask = 4;
-    cmdStatus.Relay = Power ? 1 : 0;
-    return Query(cmdStatus);
+
+  // --- Setters and Readout remain the same ---
+  // SetMask bits understood by the board; several may be combined.
+  static constexpr uint8_t MaskDACA = 1;
+  static constexpr uint8_t MaskDACB = 2;
+  static constexpr uint8_t MaskRelay = 4;
+
+  // Applies every channel selected in Mask with a single packet.
+  bool Set(uint8_t Mask, uint16_t A, uint16_t B, bool Power) {
+    std::lock_guard<std::recursive_mutex> Lock(QueryMutex);
+    Mask &= MaskDACA | MaskDACB | MaskRelay;
+    FGEncodeStatusCommand(TxFrame.Bytes, Mask, A, B, Power ? 1 : 0);
+    return Exchange(TxFrame, Mask, A, B, Power ? 1 : 0);
   }
+  bool SetDACA(uint16_t A) { return Set(MaskDACA, A, 0, false); }
+  bool SetDACB(uint16_t B) { return Set(MaskDACB, 0, B, false); }
+  bool SetRelay(bool Power) { return Set(MaskRelay, 0, 0, Power); }
   bool Readout() {
-    Status_t cmdStatus;
-    memset(&cmdStatus, 0, sizeof(cmdStatus));
-    cmdStatus.MagicNo = ExpectedMagic;
-    cmdStatus.SetMask = 0;
-    return Query(cmdStatus);
+    std::lock_guard<std::recursive_mutex> Lock(QueryMutex);
+    return Exchange(ReadoutFrame, 0, 0, 0, 0);
   }
 
-  // --- Query method with MODIFIED return logic ---
-  bool Query(Status_t CommandToSend) {
-    if (!Bridge && !Open()) {
-      Shout("Refactored AnalogPSU Query: Unable to open USB interface.", false);
-      return false; // Communication failed
+  // Link errors after which the handle is assumed broken and reconnected
+  static bool IsLinkError(int Code) {
+    return Code == LIBUSB_ERROR_NO_DEVICE || Code == LIBUSB_ERROR_PIPE ||
+           Code == LIBUSB_ERROR_IO;
+  }
+
+  // Reopens the same board from its cached identity (no bus rescan), clears
+  // any stall on endpoint 1 and replays the last commanded DAC/relay state,
+  // so that the supply carries on where it was before the error.
+  bool Reconnect() {
+    std::lock_guard<std::recursive_mutex> Lock(QueryMutex);
+    if (UseExternal || !Bridge.HasCachedDevice())
+      return false;
+    FGLatencyScope Timing(Stats.ReconnectLatency);
+    Link = LinkRecovering;
+    bool Success = Bridge.Reopen() && Bridge.ClearHalt(1);
+    if (Success && CommandedMask != 0) {
+      // Own buffer: the frame that failed may still be in TxFrame for retry
+      FGEncodeStatusCommand(ReplayFrame.Bytes, CommandedMask, CommandedDACA,
+                            CommandedDACB, CommandedRelay);
+      Success = QueryOnce(ReplayFrame);
     }
+    Link = Success ? LinkUp : LinkDown;
+    (Success ? Stats.Reconnects : Stats.ReconnectFailures)
+        .fetch_add(1, std::memory_order_relaxed);
+    if (Verbose)
+      std::cout << "Refactored AnalogPSU: reconnect "
+                << (Success ? "succeeded." : "failed.") << std::endl;
+    return Success;
+  }
 
-    // Apply command checksum logic (same as before)
-    CommandToSend.Checksum = 0;
-    CommandToSend.Checksum = CommandToSend.ComputeChecksum();
+  // One exchange of an arbitrary command; only its magic and checksum are
+  // (re)computed. Set() and Readout() encode in place instead.
+  bool Query(const Status_t &CommandToSend) {
+    std::lock_guard<std::recursive_mutex> Lock(QueryMutex);
+    memcpy(TxFrame.Bytes, &CommandToSend, FGStatusFrameSize);
+    uint32_t Magic = ExpectedMagic;
+    memcpy(TxFrame.Bytes, &Magic, sizeof(Magic));
+    FGStampStatusChecksum(TxFrame.Bytes);
+    return Exchange(TxFrame, CommandToSend.SetMask, CommandToSend.DACA,
+                    CommandToSend.DACB, CommandToSend.Relay);
+  }
 
-    if (Verbose) {
-      // Logging for Sending Command (same as before)
-      std::cout << "--- REFACTORED Sending Command to Analog Board ---"
-                << std::endl;
-      std::cout << "  Raw Bytes (as sent): "
-                << DestToHex((uint8_t *)&CommandToSend, sizeof(Status_t))
-                << std::endl;
-      // ... (print other fields: MagicNo, SetMask, Cmd values, Checksum) ...
-      std::cout << "  MagicNo  : 0x" << std::hex << CommandToSend.MagicNo
-                << std::dec << std::endl;
-      std::cout << "  SetMask  : 0b"
-                << ToBin(static_cast<uint16_t>(CommandToSend.SetMask)) << " (0x"
-                << std::hex << (int)CommandToSend.SetMask << std::dec << ")"
-                << std::endl;
-      if (CommandToSend.SetMask & 1)
-        std::cout << "  DACA Cmd : " << CommandToSend.DACA << std::endl;
-      if (CommandToSend.SetMask & 2)
-        std::cout << "  DACB Cmd : " << CommandToSend.DACB << std::endl;
-      if (CommandToSend.SetMask & 4)
-        std::cout << "  Relay Cmd: " << (int)CommandToSend.Relay << std::endl;
-      std::cout << "  Checksum (calculated and sent): 0x" << std::hex
-                << CommandToSend.Checksum << std::dec << std::endl;
-      std::cout << "------------------------------------" << std::endl;
+  // Sends an encoded frame carrying the given setpoints; after a link error
+  // the board is reconnected and the exchange repeated once (see
+  // AutoReconnect).
+  bool Exchange(FGStatusFrame &Tx, uint8_t Mask, uint16_t A, uint16_t B,
+                uint8_t Relay) {
+    std::lock_guard<std::recursive_mutex> Lock(QueryMutex);
+    bool Success = QueryOnce(Tx);
+    if (!Success && AutoReconnect && !UseExternal &&
+        IsLinkError(Bridge.GetLastError()) && Reconnect())
+      Success = QueryOnce(Tx);
+    if (Success) {
+      // Remember what the board was told, for replay after a reconnect
+      if (Mask & MaskDACA)
+        CommandedDACA = A;
+      if (Mask & MaskDACB)
+        CommandedDACB = B;
+      if (Mask & MaskRelay)
+        CommandedRelay = Relay;
+      CommandedMask |= Mask;
     }
+    return Success;
+  }
 
-    if (!Bridge.Bridge.Write(1, (uint8_t *)&CommandToSend, sizeof(Status_t))) {
-      Shout("Refactored AnalogPSU Query: Unable to write to USB interface.",
-            false);
+  // --- Query method with MODIFIED return logic ---
+  bool QueryOnce(FGStatusFrame &Tx) {
+    FGLatencyScope Timing(Stats.QueryLatency);
+    Stats.Queries.fetch_add(1, std::memory_order_relaxed);
+    std::lock_guard<std::recursive_mutex> Lock(QueryMutex);
+    if (!UseExternal && !Bridge && !Open()) {
+      Stats.CommFailures.fetch_add(1, std::memory_order_relaxed);
+      Shout("Refactored AnalogPSU Query: Unable to open USB interface.", false);
       return false; // Communication failed
     }
+    FrameValid = false;
+    const uint8_t SetMask = Tx.Bytes[FGStatusFrameSize - 1];
 
-    Status_t ResponseStatus;
-    memset(&ResponseStatus, 0, sizeof(ResponseStatus));
-    if (!Bridge.Bridge.Read(1, (uint8_t *)&ResponseStatus, sizeof(Status_t))) {
-      Shout("Refactored AnalogPSU Query: Unable to read from USB interface.",
+    // Diagnostics only record the raw frames; see DumpTrace()
+    if (Verbose)
+      Bridge.Trace.Record<FGTraceFrames>(FGTraceSent, SetMask, Tx.Bytes,
+                                         FGStatusFrameSize, 1);
+
+    // Write the command and read the response in one transaction; an
+    // asynchronous transport posts the read before the write goes out.
+    // Clearing the magic is enough to never mistake a stale response for a
+    // fresh one.
+    memset(RxFrame.Bytes, 0, sizeof(uint32_t));
+    FGBulkBridge &Link = UseExternal ? External : Bridge.Bridge;
+    Bridge.BeginCall(SetMask ? CommandPolicy : ReadoutPolicy);
+    bool Exchanged = Link.Transact(1, Tx.Bytes, FGStatusFrameSize,
+                                   RxFrame.Bytes, FGStatusFrameSize);
+    Bridge.EndCall();
+    if (!Exchanged) {
+      Stats.CommFailures.fetch_add(1, std::memory_order_relaxed);
+      Shout("Refactored AnalogPSU Query: Unable to exchange command and "
+            "response with USB interface.",
             false);
       return false; // Communication failed
     }
 
     if (Verbose) {
-      // Logging for Received Response (same as before)
-      std::cout << "--- REFACTORED Received Response from Analog Board ---"
-                << std::endl;
-      std::cout << "  Raw Bytes (received): "
-                << DestToHex((uint8_t *)&ResponseStatus, sizeof(Status_t))
-                << std::endl;
-      // ... (print other fields: MagicNo, Checksum, SequenceNo, Response, Relay
-      // etc.) ...
-      std::cout << "  MagicNo    (recv): 0x" << std::hex
-                << ResponseStatus.MagicNo << std::dec << std::endl;
-      std::cout << "  Checksum   (recv): 0x" << std::hex
-                << ResponseStatus.Checksum << std::dec << std::endl;
-      std::cout << "  SequenceNo (recv): " << ResponseStatus.SequenceNo
-                << std::endl;
-      std::cout << "  Response   (recv): 0x" << std::hex
-                << ResponseStatus.Response << std::dec << " (Error Word)"
-                << std::endl;
-      std::cout << "  Relay      (recv): " << (int)ResponseStatus.Relay
-                << std::endl;
-      std::cout << "---------------------------------------" << std::endl;
+      int16_t Response;
+      memcpy(&Response, RxFrame.Bytes + offsetof(Status_t, Response),
+             sizeof(Response));
+      Bridge.Trace.Record<FGTraceFrames>(FGTraceReceived, Response,
+                                         RxFrame.Bytes, FGStatusFrameSize, 1);
     }
 
-    // Check USB packet validity (MagicNo, Packet Checksum)
-    if (ResponseStatus.MagicNo != ExpectedMagic) {
+    // Check USB packet validity (MagicNo and packet checksum in one pass)
+    FGStatusVerdict Verdict = FGCheckStatusFrame(RxFrame.Bytes);
+    if (Verdict == FGStatusBadMagic) {
+      Stats.MagicFailures.fetch_add(1, std::memory_order_relaxed);
+      Bridge.Trace.Record<FGTraceFrames>(FGTraceBadFrame, 1, RxFrame.Bytes,
+                                         FGStatusFrameSize, 1);
       Shout("Refactored AnalogPSU Query: Magic number in response does not "
             "correspond.",
             false);
       return false; // Packet integrity failed
     }
-    if (ResponseStatus.ComputeChecksum() != 0) {
-      if (Verbose) {
-        std::cout
-            << "  Computed Checksum over received packet (should be 0): 0x"
-            << std::hex << ResponseStatus.ComputeChecksum() << std::dec
-            << std::endl;
-      }
+    if (Verdict == FGStatusBadChecksum) {
+      Stats.ChecksumFailures.fetch_add(1, std::memory_order_relaxed);
+      Bridge.Trace.Record<FGTraceFrames>(FGTraceBadFrame, 2, RxFrame.Bytes,
+                                         FGStatusFrameSize, 1);
       Shout("Refactored AnalogPSU Query: Checksum in response does not "
             "correspond.",
             false);
       return false; // Packet integrity failed
     }
 
-    // Communication and packet structure seem OK. Store results.
-    this->Errors =
-        ResponseStatus.Response; // Store the device's status/error code
-    // ... (copy other fields like ADCA, ADCB, DACA_val, etc. as before) ...
-    for (int i = 0; i < 4; ++i) {
-      this->ADCA[i] = ResponseStatus.ADCA[i];
-      this->ADCB[i] = ResponseStatus.ADCB[i];
-    }
-    this->DACA_val = ResponseStatus.DACA;
-    this->DACB_val = ResponseStatus.DACB;
-    this->Relay_val = ResponseStatus.Relay;
-    this->SequenceNo_val = ResponseStatus.SequenceNo;
+    // Communication and packet structure seem OK. Store results, error word
+    // included, with one copy.
+    FGDecodeStatusFields(RxFrame.Bytes, Readback);
+    FrameValid = true;
+    FGStartup().NoteExchange();
 
     // ---vvv--- MODIFIED LOGIC HERE ---vvv---
     // Check the device's reported error code, BUT only return 'false' for
     // critical errors. Based on colleague's advice, we treat 0xF00 as
     // non-critical for the return value.
-    if (this->Errors != 0) {
-      if (this->Errors == 0xF00) {
+    if (Readback.Response != 0) {
+      if (Readback.Response == 0xF00) {
+        Stats.StatusF00.fetch_add(1, std::memory_order_relaxed);
         // It's the specific code we decided to ignore for success/failure
         // reporting
-        if (Verbose) {
-          // Log it distinctly, perhaps using Warn or just cout
-          // Using Warn implies it's still noteworthy
-          Warn("Refactored AnalogPSU Query: Device reported status 0x" +
-                   ToHex(this->Errors) +
-                   " (Ignoring for success/fail return value).",
-               false);
-        }
+        if (Verbose)
+          Bridge.Trace.Record<FGTraceFrames>(FGTraceDeviceError,
+                                             Readback.Response);
         // *** Do NOT return false here - proceed to return true ***
       } else {
         // It's a *different* non-zero error code. Treat this as a failure.
-        if (Verbose) {
-          Shout("Refactored AnalogPSU Query: Device reported CRITICAL error "
-                "word: 0x" +
-                    ToHex(this->Errors),
-                false);
-        }
+        Stats.DeviceErrors.fetch_add(1, std::memory_order_relaxed);
+        Bridge.Trace.Record<FGTraceFrames>(FGTraceDeviceError,
+                                           Readback.Response);
         return false; // Return false for other errors
       }
     }
-    // Return true if Errors was 0 OR if it was specifically 0xF00 (and not
+    // Return true if the error word was 0 OR if it was specifically 0xF00 (and not
     // handled above)
+    LastGoodNs = FGMonotonicNs();
     return true;
     // ---^^^--- END OF MODIFIED LOGIC ---^^^---
 
   }; // End of Query method
 
+  // Prints the recorded frames and USB attempts, decoding board frames.
+  void DumpTrace(std::ostream &Str = std::cout) const {
+    Bridge.Trace.Dump(Str, [](std::ostream &S, const FGTraceRecord &R) {
+      if (R.Length != sizeof(Status_t) ||
+          (R.Kind != FGTraceSent && R.Kind != FGTraceReceived)) {
+        FGTraceRing::FormatRaw(S, R);
+        return;
+      }
+      Status_t F;
+      memcpy(&F, R.Payload, sizeof(F));
+      S << FGTraceRing::KindName(R.Kind) << " magic=0x" << std::hex
+        << F.MagicNo << " mask=0x" << (int)F.SetMask << std::dec
+        << " daca=" << F.DACA << " dacb=" << F.DACB
+        << " relay=" << (int)F.Relay << " seq=" << F.SequenceNo << " resp=0x"
+        << std::hex << (uint16_t)F.Response << " sum=0x" << F.Checksum << std::dec
+        << " adca=" << F.ADCA[0] << "," << F.ADCA[1] << "," << F.ADCA[2] << ","
+        << F.ADCA[3] << " adcb=" << F.ADCB[0] << "," << F.ADCB[1] << ","
+        << F.ADCB[2] << "," << F.ADCB[3];
+    });
+  }
+
   void Dump(std::ostream &Str = std::cout) { /* ... as before ... */
     Str << "ADC A: ";
-    for (auto &a : ADCA)
+    for (auto &a : Readback.ADCA)
       Str << '\t' << a;
     Str << '\n';
     Str << "ADC B: ";
-    for (auto &a : ADCB)
+    for (auto &a : Readback.ADCB)
       Str << '\t' << a;
     Str << '\n';
-    Str << "DAC A (readback): " << DACA_val << '\n';
-    Str << "DAC B (readback): " << DACB_val << '\n';
-    Str << "Relay (readback): " << int(Relay_val) << '\n';
-    Str << "Sequence no (readback): " << SequenceNo_val << '\n';
-    Str << "Last Device Error Word: 0x" << ToHex(Errors) << '\n';
+    Str << "DAC A (readback): " << Readback.DACA << '\n';
+    Str << "DAC B (readback): " << Readback.DACB << '\n';
+    Str << "Relay (readback): " << int(Readback.Relay) << '\n';
+    Str << "Sequence no (readback): " << Readback.SequenceNo << '\n';
+    Str << "Last Device Error Word: 0x" << ToHex(Readback.Response) << '\n';
   }
 };
 
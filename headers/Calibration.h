@@ -0,0 +1,178 @@
+/*
+ * Calibration.h
+ *
+ * DAC/ADC scaling of one Heinzinger PSU behind the analog interface board.
+ *
+ * The analog chain constants (DAC full scale, setpoint headroom, monitor ADC
+ * divider) are kept as parameters, and the per-call factors derived from them
+ * are computed once in Update(). An optional piecewise-linear table per
+ * channel corrects setpoints for the measured non-linearity of the supply;
+ * it is read from the "setpoint,measured" CSV written by the linearity
+ * measurement loop in Heinzinger.cpp's main().
+ */
+
+#ifndef SOURCE_CALIBRATION_H_
+#define SOURCE_CALIBRATION_H_
+
+#include <algorithm>
+#include <cstdlib>
+#include <fstream>
+#include <stddef.h>
+#include <stdint.h>
+#include <string>
+#include <utility>
+#include <vector>
+
+// Nominal analog chain of the interface board
+constexpr double FGBoardMaxVolt = 11.3;      // DAC output at full scale
+constexpr double FGSetpointHeadroom = 0.98;  // setpoints aim 2% high
+constexpr double FGMonitorFullScale = 10.0;  // PSU monitor output range
+constexpr double FGADCInputScale = 3.2 * 3.3 * 1.12; // volts at full count
+
+// Monotonic piecewise-linear map given by (X, Y) points sorted by X, with
+// linear extrapolation from the outermost segments.
+class FGPiecewiseLinear {
+  std::vector<double> X, Y;
+
+public:
+  bool Empty() const { return X.size() < 2; };
+  size_t Size() const { return X.size(); };
+  void Clear() {
+    X.clear();
+    Y.clear();
+  };
+
+  // Points need not be sorted; of several points with the same X only the
+  // first is kept.
+  void Assign(std::vector<std::pair<double, double>> Points) {
+    std::sort(Points.begin(), Points.end());
+    Clear();
+    for (const auto &P : Points) {
+      if (!X.empty() && P.first <= X.back())
+        continue;
+      X.push_back(P.first);
+      Y.push_back(P.second);
+    }
+  };
+
+  double operator()(double Value) const {
+    if (Empty())
+      return Value;
+    size_t Hi = std::upper_bound(X.begin(), X.end(), Value) - X.begin();
+    if (Hi == 0)
+      Hi = 1;
+    else if (Hi == X.size())
+      Hi = X.size() - 1;
+    size_t Lo = Hi - 1;
+    return Y[Lo] + (Y[Hi] - Y[Lo]) * (Value - X[Lo]) / (X[Hi] - X[Lo]);
+  };
+};
+
+class FGPSUCalibration {
+public:
+  // Analog chain parameters; call Update() after changing any of them
+  double MaxVolt;         // PSU output at full monitor/programming scale
+  double MaxCurr;
+  double MaxInputVolt;    // PSU programming input range actually used
+  double BoardMaxVolt;    // DAC output at full scale
+  double Headroom;        // setpoint headroom factor (0.98: aim 2% high)
+  double MonitorFullScale;
+  double ADCInputScale;
+
+  // Optional setpoint corrections: requested output -> value to program,
+  // i.e. the inverse of the measured setpoint -> output curve.
+  FGPiecewiseLinear VoltageCorrection;
+  FGPiecewiseLinear CurrentCorrection;
+
+private:
+  // Derived factors
+  double VoltToCounts, CurrToCounts, MaxCounts;
+  double CountsToVolt, CountsToCurr;
+
+  static uint16_t ToRegister(double Counts, double Max) {
+    if (!(Counts > 0)) // also catches NaN
+      return 0;
+    return static_cast<uint16_t>(Counts < Max ? Counts : Max);
+  };
+
+public:
+  FGPSUCalibration(double MaxVoltage = 30000.0, double MaxCurrent = 2.0,
+                   double MaxInputVoltage = 10.0)
+      : MaxVolt(MaxVoltage), MaxCurr(MaxCurrent),
+        MaxInputVolt(MaxInputVoltage), BoardMaxVolt(FGBoardMaxVolt),
+        Headroom(FGSetpointHeadroom), MonitorFullScale(FGMonitorFullScale),
+        ADCInputScale(FGADCInputScale) {
+    Update();
+  };
+
+  void Update() {
+    // reg = UINT16_MAX * (MaxInputVolt * x / Headroom / Max) / BoardMaxVolt,
+    // with the programming voltage capped at MaxInputVolt
+    double Full = UINT16_MAX * MaxInputVolt / BoardMaxVolt;
+    VoltToCounts = Full / Headroom / MaxVolt;
+    CurrToCounts = Full / Headroom / MaxCurr;
+    MaxCounts = Full;
+    // x = Max * (ADCInputScale * raw / UINT16_MAX) / MonitorFullScale
+    CountsToVolt = MaxVolt * ADCInputScale / UINT16_MAX / MonitorFullScale;
+    CountsToCurr = MaxCurr * ADCInputScale / UINT16_MAX / MonitorFullScale;
+  };
+
+  uint16_t VoltageRegister(double Volt) const {
+    return ToRegister(VoltageCorrection(Volt) * VoltToCounts, MaxCounts);
+  };
+  uint16_t CurrentRegister(double Curr) const {
+    return ToRegister(CurrentCorrection(Curr) * CurrToCounts, MaxCounts);
+  };
+  double Voltage(uint16_t Raw) const { return Raw * CountsToVolt; };
+  double Current(uint16_t Raw) const { return Raw * CountsToCurr; };
+  double VoltsPerCount() const { return CountsToVolt; };
+  double AmpsPerCount() const { return CountsToCurr; };
+
+  // Batch conversion of monitor readings spaced Stride elements apart (e.g.
+  // one channel of a capture buffer); plain multiply loops the compiler
+  // vectorizes.
+  void Voltages(const uint16_t *Raw, size_t Count, size_t Stride,
+                double *Out) const {
+    const double K = CountsToVolt;
+    for (size_t i = 0; i < Count; ++i)
+      Out[i] = Raw[i * Stride] * K;
+  };
+  void Currents(const uint16_t *Raw, size_t Count, size_t Stride,
+                double *Out) const {
+    const double K = CountsToCurr;
+    for (size_t i = 0; i < Count; ++i)
+      Out[i] = Raw[i * Stride] * K;
+  };
+
+  // Reads "setpoint,measured" lines (as written by the linearity loop) and
+  // stores their inverse as the correction table. Lines that do not parse,
+  // e.g. a header, are skipped. Returns false if fewer than two points.
+  static bool LoadCorrection(const std::string &Path,
+                             FGPiecewiseLinear &Table) {
+    std::ifstream File(Path.c_str());
+    if (!File)
+      return false;
+    std::vector<std::pair<double, double>> Points;
+    std::string Line;
+    while (std::getline(File, Line)) {
+      const char *Text = Line.c_str();
+      char *End;
+      double Setpoint = strtod(Text, &End);
+      if (End == Text || *End != ',')
+        continue;
+      const char *Next = End + 1;
+      double Measured = strtod(Next, &End);
+      if (End == Next)
+        continue;
+      Points.push_back(std::make_pair(Measured, Setpoint));
+    }
+    FGPiecewiseLinear Parsed;
+    Parsed.Assign(Points);
+    if (Parsed.Empty())
+      return false;
+    Table = Parsed;
+    return true;
+  };
+};
+
+#endif /* SOURCE_CALIBRATION_H_ */
@@ -0,0 +1,71 @@
+/*
+ * CaptureRing.h
+ *
+ * Fixed-size, preallocated ring of raw readout samples for high-rate
+ * streaming capture. Push() never allocates; the storage is shared through
+ * a shared_ptr so that exported views (e.g. NumPy arrays) stay valid even
+ * after the ring is replaced by a new capture. That shared_ptr is only
+ * accessed through std::atomic_load/atomic_store, since readers run on other
+ * threads than Allocate().
+ */
+
+#ifndef SOURCE_CAPTURERING_H_
+#define SOURCE_CAPTURERING_H_
+
+#include <atomic>
+#include <memory>
+#include <stdint.h>
+#include <vector>
+
+// One raw readout, 32 bytes, laid out without padding so that it maps 1:1
+// onto a NumPy structured dtype.
+struct FGCaptureSample {
+  uint64_t timestamp_ns; // FGMonotonicNs() of the readout
+  uint16_t sequence_no;  // board sequence number
+  uint16_t errors;       // device error word
+  uint16_t daca;         // DAC A readback
+  uint16_t dacb;         // DAC B readback
+  int16_t adca[4];
+  uint16_t adcb[4];
+};
+
+class FGCaptureRing {
+public:
+  typedef std::vector<FGCaptureSample> Storage;
+
+private:
+  std::shared_ptr<Storage> Data;
+  std::atomic<uint64_t> WriteCount;
+
+public:
+  FGCaptureRing(size_t Capacity = 0) : WriteCount(0) { Allocate(Capacity); };
+  FGCaptureRing(const FGCaptureRing &) = delete;
+
+  // Replaces the storage. Views of the previous storage remain valid.
+  void Allocate(size_t Capacity) {
+    std::atomic_store(&Data, std::make_shared<Storage>(Capacity));
+    WriteCount.store(0);
+  };
+
+  // Single producer only, and not concurrent with Allocate().
+  void Push(const FGCaptureSample &Sample) {
+    Storage &S = *Data; // the owner serializes Push() and Allocate()
+    if (S.empty())
+      return;
+    uint64_t N = WriteCount.load(std::memory_order_relaxed);
+    S[N % S.size()] = Sample;
+    WriteCount.store(N + 1, std::memory_order_release);
+  };
+
+  size_t Capacity() const { return Buffer()->size(); };
+  // Total samples pushed since Allocate(); may exceed Capacity().
+  uint64_t Count() const { return WriteCount.load(std::memory_order_acquire); };
+  // Slot the next sample will be written to (oldest sample once wrapped).
+  size_t Head() const {
+    size_t Size = Buffer()->size();
+    return Size == 0 ? 0 : Count() % Size;
+  };
+  std::shared_ptr<Storage> Buffer() const { return std::atomic_load(&Data); };
+};
+
+#endif /* SOURCE_CAPTURERING_H_ */
@@ -0,0 +1,166 @@
+/*
+ * ChangeFeed.h
+ *
+ * Delivers change events from one producer (the acquisition thread) to any
+ * number of blocking waiters and registered callbacks.
+ *
+ * The producer only stores the event and notifies; callbacks run on a
+ * dispatcher thread of their own, so a slow callback (e.g. one that first
+ * has to take the Python GIL) never delays acquisition.
+ *
+ * Waiters walk the events one by one: the last HistorySize events are kept,
+ * so a waiter that passes the sequence of the event it got last misses
+ * nothing unless it falls more than HistorySize events behind. Callbacks
+ * are coalesced instead: a callback that is still busy sees only the latest
+ * change afterwards, never a backlog.
+ */
+
+#ifndef SOURCE_CHANGEFEED_H_
+#define SOURCE_CHANGEFEED_H_
+
+#include <chrono>
+#include <condition_variable>
+#include <functional>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <stdint.h>
+#include <thread>
+#include <vector>
+
+template <class Event> class FGChangeFeed {
+public:
+  typedef std::function<void(const Event &)> Callback;
+  static const size_t HistorySize = 64;
+
+private:
+  // Shared with the dispatcher thread, which may outlive the feed by the
+  // duration of a callback in progress.
+  struct State {
+    std::mutex Lock;
+    std::condition_variable Changed;
+    uint64_t Sequence = 0;   // number of events published
+    uint64_t Dispatched = 0; // Sequence at the last callback round
+    Event History[HistorySize]; // event N at (N - 1) % HistorySize
+    bool Closing = false;
+    bool DispatcherStarted = false;
+    struct Subscriber {
+      Callback Fn;
+      uint64_t After; // Sequence when subscribed: only newer events
+    };
+    std::map<int, Subscriber> Callbacks;
+    int NextId = 1;
+
+    const Event &Latest() const {
+      return History[(Sequence - 1) % HistorySize];
+    };
+  };
+  std::shared_ptr<State> S;
+
+  static void Dispatch(std::shared_ptr<State> St) {
+    std::unique_lock<std::mutex> L(St->Lock);
+    std::vector<Callback> Targets;
+    for (;;) {
+      St->Changed.wait(L, [&St]() {
+        return St->Closing ||
+               (St->Dispatched < St->Sequence && !St->Callbacks.empty());
+      });
+      if (St->Closing)
+        return;
+      Event E = St->Latest();
+      St->Dispatched = St->Sequence;
+      for (const auto &C : St->Callbacks)
+        if (C.second.After < St->Sequence)
+          Targets.push_back(C.second.Fn);
+      L.unlock();
+      for (const Callback &Fn : Targets)
+        Fn(E);
+      Targets.clear(); // release the copies before taking the lock again
+      L.lock();
+    }
+  };
+
+public:
+  FGChangeFeed() : S(std::make_shared<State>()) {};
+  FGChangeFeed(const FGChangeFeed &) = delete;
+  ~FGChangeFeed() {
+    std::map<int, typename State::Subscriber> Removed; // destroyed unlocked
+    {
+      std::lock_guard<std::mutex> L(S->Lock);
+      S->Closing = true;
+      Removed.swap(S->Callbacks);
+    }
+    S->Changed.notify_all();
+    // Not joined: the dispatcher may be inside a callback that waits for a
+    // lock held by whoever destroys the feed. It exits on its own.
+  };
+
+  // Publishes an event and returns its sequence number (1 for the first).
+  uint64_t Publish(const Event &E) {
+    uint64_t Seq;
+    {
+      std::lock_guard<std::mutex> L(S->Lock);
+      S->History[S->Sequence % HistorySize] = E;
+      Seq = ++S->Sequence;
+    }
+    S->Changed.notify_all();
+    return Seq;
+  };
+
+  uint64_t GetSequence() const {
+    std::lock_guard<std::mutex> L(S->Lock);
+    return S->Sequence;
+  };
+
+  // Waits until an event newer than sequence After exists (TimeoutS < 0:
+  // indefinitely). On success stores the oldest such event still kept, i.e.
+  // event After + 1 unless that one has already dropped out of the history,
+  // and its sequence.
+  bool Wait(uint64_t After, double TimeoutS, Event &Out, uint64_t &Seq) const {
+    std::unique_lock<std::mutex> L(S->Lock);
+    auto Ready = [this, After]() {
+      return S->Sequence > After || S->Closing;
+    };
+    if (TimeoutS < 0)
+      S->Changed.wait(L, Ready);
+    else if (!S->Changed.wait_for(
+                 L, std::chrono::duration<double>(TimeoutS), Ready))
+      return false;
+    if (S->Sequence <= After)
+      return false; // closing
+    Seq = After + 1;
+    if (S->Sequence - After > HistorySize)
+      Seq = S->Sequence - HistorySize + 1; // the older ones are gone
+    Out = S->History[(Seq - 1) % HistorySize];
+    return true;
+  };
+
+  // Registers a callback for future events; returns its id. A callback may
+  // still run once after Unsubscribe() if its round had already started.
+  int Subscribe(const Callback &Fn) {
+    std::lock_guard<std::mutex> L(S->Lock);
+    int Id = S->NextId++;
+    // Only changes from now on; a round already pending for the other
+    // callbacks is left alone.
+    typename State::Subscriber Sub = {Fn, S->Sequence};
+    S->Callbacks[Id] = Sub;
+    if (!S->DispatcherStarted) {
+      S->DispatcherStarted = true;
+      std::thread(&FGChangeFeed::Dispatch, S).detach();
+    }
+    return Id;
+  };
+
+  bool Unsubscribe(int Id) {
+    Callback Removed; // destroyed after the lock is released
+    std::lock_guard<std::mutex> L(S->Lock);
+    auto It = S->Callbacks.find(Id);
+    if (It == S->Callbacks.end())
+      return false;
+    Removed = It->second.Fn;
+    S->Callbacks.erase(It);
+    return true;
+  };
+};
+
+#endif /* SOURCE_CHANGEFEED_H_ */
@@ -0,0 +1,158 @@
+/*
+ * CommandQueue.h
+ *
+ * Last-writer-wins coalescing of setpoint commands. Everything submitted
+ * while the previous command is still on the bus is merged into a single
+ * pending command: the masks are or'ed and each channel keeps the value of
+ * its last submission. The consumer takes the whole pending command at once,
+ * sends it as one exchange and completes every submission merged into it
+ * with the same result, either through a future or by calling a callback on
+ * the consumer's thread.
+ *
+ * A submission thus waits for at most the exchange in flight plus its own,
+ * however many others arrive in the meantime.
+ */
+
+#ifndef SOURCE_COMMANDQUEUE_H_
+#define SOURCE_COMMANDQUEUE_H_
+
+#include "AnalogPSU.h" // For the Mask* channel bits
+#include <atomic>
+#include <condition_variable>
+#include <functional>
+#include <future>
+#include <mutex>
+#include <stdint.h>
+#include <vector>
+
+// Setpoints of the channels selected by Mask (FGAnalogPSUInterface::Mask*)
+struct FGSetpointCommand {
+  uint8_t Mask;
+  double Volt; // MaskDACA
+  double Curr; // MaskDACB
+  bool Relay;  // MaskRelay
+
+  FGSetpointCommand() : Mask(0), Volt(0), Curr(0), Relay(false) {};
+
+  // Takes over the channels set in Other, which is the later submission.
+  void Merge(const FGSetpointCommand &Other) {
+    if (Other.Mask & FGAnalogPSUInterface::MaskDACA)
+      Volt = Other.Volt;
+    if (Other.Mask & FGAnalogPSUInterface::MaskDACB)
+      Curr = Other.Curr;
+    if (Other.Mask & FGAnalogPSUInterface::MaskRelay)
+      Relay = Other.Relay;
+    Mask |= Other.Mask;
+  };
+};
+
+template <typename Result> class FGCoalescingQueue {
+public:
+  typedef std::function<void(const Result &)> Callback;
+
+  struct Batch {
+    FGSetpointCommand Command;
+    std::vector<std::promise<Result>> Waiters;
+    std::vector<Callback> Callbacks;
+
+    size_t Size() const { return Waiters.size() + Callbacks.size(); };
+    // Hands the result to every submission merged into the command
+    void Complete(const Result &R) {
+      for (std::promise<Result> &W : Waiters)
+        W.set_value(R);
+      for (Callback &Fn : Callbacks)
+        Fn(R);
+    };
+  };
+
+  struct Counters {
+    std::atomic<uint64_t> Submitted;
+    std::atomic<uint64_t> Batches;  // commands taken by the consumer
+    std::atomic<uint64_t> Largest;  // most submissions merged into one
+    Counters() : Submitted(0), Batches(0), Largest(0) {};
+  };
+
+private:
+  mutable std::mutex Lock;
+  std::condition_variable Ready;
+  Batch Pending;
+  bool Closed;
+  Counters Count;
+
+public:
+  FGCoalescingQueue() : Closed(false) {};
+  FGCoalescingQueue(const FGCoalescingQueue &) = delete;
+
+  // Merges C into the pending command; false once closed, Out untouched.
+  bool Submit(const FGSetpointCommand &C, std::future<Result> &Out) {
+    {
+      std::lock_guard<std::mutex> Guard(Lock);
+      if (Closed)
+        return false;
+      Pending.Command.Merge(C);
+      Pending.Waiters.emplace_back();
+      Out = Pending.Waiters.back().get_future();
+    }
+    Count.Submitted.fetch_add(1, std::memory_order_relaxed);
+    Ready.notify_one();
+    return true;
+  };
+  // Same, but Done is called with the result on the consumer's thread.
+  bool Submit(const FGSetpointCommand &C, const Callback &Done) {
+    {
+      std::lock_guard<std::mutex> Guard(Lock);
+      if (Closed)
+        return false;
+      Pending.Command.Merge(C);
+      Pending.Callbacks.push_back(Done);
+    }
+    Count.Submitted.fetch_add(1, std::memory_order_relaxed);
+    Ready.notify_one();
+    return true;
+  };
+
+  // Blocks until something is pending and moves it into Out. Returns false
+  // only once closed and drained.
+  bool Take(Batch &Out) {
+    std::unique_lock<std::mutex> Guard(Lock);
+    Ready.wait(Guard, [this]() { return Closed || Pending.Size() != 0; });
+    if (Pending.Size() == 0)
+      return false;
+    Out.Command = Pending.Command;
+    Out.Waiters.clear();
+    Out.Waiters.swap(Pending.Waiters);
+    Out.Callbacks.clear();
+    Out.Callbacks.swap(Pending.Callbacks);
+    Pending.Command = FGSetpointCommand();
+    Guard.unlock();
+
+    Count.Batches.fetch_add(1, std::memory_order_relaxed);
+    uint64_t N = Out.Size();
+    uint64_t Max = Count.Largest.load(std::memory_order_relaxed);
+    while (N > Max && !Count.Largest.compare_exchange_weak(Max, N))
+      ;
+    return true;
+  };
+
+  // Refuses further submissions and wakes the consumer; whatever is
+  // pending is still handed out by Take().
+  void Close() {
+    {
+      std::lock_guard<std::mutex> Guard(Lock);
+      Closed = true;
+    }
+    Ready.notify_all();
+  };
+  void Open() {
+    std::lock_guard<std::mutex> Guard(Lock);
+    Closed = false;
+  };
+
+  size_t PendingCount() const {
+    std::lock_guard<std::mutex> Guard(Lock);
+    return Pending.Size();
+  };
+  const Counters &GetCounters() const { return Count; };
+};
+
+#endif /* SOURCE_COMMANDQUEUE_H_ */
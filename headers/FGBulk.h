@@ -9,6 +9,9 @@
 #define FGBULK_H_
 
 typedef bool (* BulkBridgeCallback)(void *, unsigned char, unsigned char *, unsigned int);
+// Write followed by read on the same endpoint, with separate buffers, so that
+// a transport may post the read before issuing the write.
+typedef bool (* BulkBridgeTransactCallback)(void *, unsigned char, unsigned char *, unsigned int, unsigned char *, unsigned int);
 
 class FGBulkBridge
 {
@@ -16,13 +19,14 @@ private:
 	void *            Parameters;
 	BulkBridgeCallback WriteCallback;
 	BulkBridgeCallback ReadCallback;
+	BulkBridgeTransactCallback TransactCallback;
 
 public:
 	FGBulkBridge() :
-		Parameters(nullptr), WriteCallback(nullptr), ReadCallback(nullptr) {};
+		Parameters(nullptr), WriteCallback(nullptr), ReadCallback(nullptr), TransactCallback(nullptr) {};
 
-	FGBulkBridge(void *P, BulkBridgeCallback WC, BulkBridgeCallback RC) :
-		Parameters(P), WriteCallback(WC), ReadCallback(RC) {};
+	FGBulkBridge(void *P, BulkBridgeCallback WC, BulkBridgeCallback RC, BulkBridgeTransactCallback TC = nullptr) :
+		Parameters(P), WriteCallback(WC), ReadCallback(RC), TransactCallback(TC) {};
 
 	bool Write(unsigned char Endpoint, unsigned char *Buffer, unsigned int Length)
 	{
@@ -52,6 +56,16 @@ public:
 		if(!Write(Endpoint, Buffer, wLength)) return false;
 		return Read(Endpoint, Buffer, rLength);
 	};
+
+	// Like Query() but with distinct command and response buffers. Falls back
+	// to a plain Write() + Read() when the transport has no native transact.
+	bool Transact(unsigned char Endpoint, unsigned char *WBuffer, unsigned int WLength, unsigned char *RBuffer, unsigned int RLength)
+	{
+		if(TransactCallback != nullptr)
+			return TransactCallback(Parameters, Endpoint, WBuffer, WLength, RBuffer, RLength);
+		if(!Write(Endpoint, WBuffer, WLength)) return false;
+		return Read(Endpoint, RBuffer, RLength);
+	};
 };
 
 
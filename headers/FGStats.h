@@ -0,0 +1,171 @@
+/*
+ * FGStats.h
+ *
+ * Lock-free counters and latency histograms for the USB hot path.
+ *
+ * FGLatencyHistogram buckets values HDR-style: every power of two is split
+ * into four sub-buckets, which bounds the relative error of the reported
+ * percentiles to 25% over the whole range from nanoseconds to minutes,
+ * with a fixed array of atomic counters and no allocation when recording.
+ */
+
+#ifndef SOURCE_FGSTATS_H_
+#define SOURCE_FGSTATS_H_
+
+#include <atomic>
+#include <stdint.h>
+
+#include "PeriodicTask.h" // FGMonotonicNs
+
+class FGLatencyHistogram {
+public:
+  static const int SubBits = 2;
+  static const int SubBuckets = 1 << SubBits;
+  static const int Buckets = SubBuckets * 40; // up to ~2^41 ns, about 36 min
+
+private:
+  std::atomic<uint64_t> Counts[Buckets];
+  std::atomic<uint64_t> Total;
+  std::atomic<uint64_t> SumNs;
+  std::atomic<uint64_t> MaxNs;
+
+  static int BucketOf(uint64_t Ns) {
+    if (Ns < (uint64_t)SubBuckets)
+      return (int)Ns;
+    int Exponent = 63 - __builtin_clzll(Ns); // >= SubBits
+    int Sub = (int)(Ns >> (Exponent - SubBits)) & (SubBuckets - 1);
+    int Index = SubBuckets * (Exponent - SubBits + 1) + Sub;
+    return Index < Buckets ? Index : Buckets - 1;
+  };
+
+  // Largest value falling into the bucket.
+  static uint64_t UpperBound(int Index) {
+    if (Index < SubBuckets)
+      return Index;
+    int Exponent = Index / SubBuckets + SubBits - 1;
+    uint64_t Sub = Index % SubBuckets;
+    return ((SubBuckets + Sub + 1) << (Exponent - SubBits)) - 1;
+  };
+
+public:
+  FGLatencyHistogram() { Reset(); };
+  FGLatencyHistogram(const FGLatencyHistogram &) = delete;
+
+  void Record(uint64_t Ns) {
+    Counts[BucketOf(Ns)].fetch_add(1, std::memory_order_relaxed);
+    Total.fetch_add(1, std::memory_order_relaxed);
+    SumNs.fetch_add(Ns, std::memory_order_relaxed);
+    uint64_t Seen = MaxNs.load(std::memory_order_relaxed);
+    while (Ns > Seen &&
+           !MaxNs.compare_exchange_weak(Seen, Ns, std::memory_order_relaxed))
+      ;
+  };
+
+  void Reset() {
+    for (auto &C : Counts)
+      C.store(0, std::memory_order_relaxed);
+    Total.store(0);
+    SumNs.store(0);
+    MaxNs.store(0);
+  };
+
+  uint64_t Count() const { return Total.load(std::memory_order_relaxed); };
+  uint64_t Max() const { return MaxNs.load(std::memory_order_relaxed); };
+  double Mean() const {
+    uint64_t N = Count();
+    return N ? (double)SumNs.load(std::memory_order_relaxed) / N : 0.0;
+  };
+
+  // Upper bound of the bucket holding the Q-quantile (0 < Q <= 1), capped at
+  // the largest value seen. Concurrent recording may skew it slightly.
+  uint64_t Percentile(double Q) const {
+    uint64_t N = 0;
+    uint64_t Snapshot[Buckets];
+    for (int i = 0; i < Buckets; ++i)
+      N += Snapshot[i] = Counts[i].load(std::memory_order_relaxed);
+    if (N == 0)
+      return 0;
+    uint64_t Rank = (uint64_t)(Q * N + 0.5);
+    if (Rank < 1)
+      Rank = 1;
+    uint64_t Seen = 0;
+    for (int i = 0; i < Buckets; ++i) {
+      Seen += Snapshot[i];
+      if (Seen >= Rank) {
+        uint64_t Bound = UpperBound(i);
+        return Bound < Max() ? Bound : Max();
+      }
+    }
+    return Max();
+  };
+};
+
+// Records the lifetime of the scope into a histogram, whichever way it exits.
+class FGLatencyScope {
+  FGLatencyHistogram &Histogram;
+  uint64_t StartNs;
+
+public:
+  explicit FGLatencyScope(FGLatencyHistogram &H)
+      : Histogram(H), StartNs(FGMonotonicNs()) {};
+  FGLatencyScope(const FGLatencyScope &) = delete;
+  ~FGLatencyScope() { Histogram.Record(FGMonotonicNs() - StartNs); };
+};
+
+// Per-device USB transfer statistics, kept by FGUSBBulk.
+struct FGUSBStats {
+  FGLatencyHistogram WriteLatency;    // one complete write, retries included
+  FGLatencyHistogram ReadLatency;     // one complete read, retries included
+  FGLatencyHistogram TransactLatency; // pipelined write+read (async only)
+  FGLatencyHistogram Retries;         // extra attempts per transfer
+  std::atomic<uint64_t> Transfers;
+  std::atomic<uint64_t> TransferFailures;
+  std::atomic<uint64_t> Reopens;
+
+  FGUSBStats() : Transfers(0), TransferFailures(0), Reopens(0) {};
+  FGUSBStats(const FGUSBStats &) = delete;
+
+  void Reset() {
+    WriteLatency.Reset();
+    ReadLatency.Reset();
+    TransactLatency.Reset();
+    Retries.Reset();
+    Transfers.store(0);
+    TransferFailures.store(0);
+    Reopens.store(0);
+  };
+};
+
+// Per-board query statistics, kept by FGAnalogPSUInterface.
+struct FGQueryStats {
+  FGLatencyHistogram QueryLatency; // lock wait + exchange + validation
+  std::atomic<uint64_t> Queries;
+  std::atomic<uint64_t> CommFailures;     // open or USB exchange failed
+  std::atomic<uint64_t> MagicFailures;    // response magic number mismatch
+  std::atomic<uint64_t> ChecksumFailures; // response checksum mismatch
+  std::atomic<uint64_t> StatusF00;        // the tolerated 0xF00 status word
+  std::atomic<uint64_t> DeviceErrors;     // any other non-zero status word
+  FGLatencyHistogram ReconnectLatency;    // reopen + clear halt + replay
+  std::atomic<uint64_t> Reconnects;
+  std::atomic<uint64_t> ReconnectFailures;
+
+  FGQueryStats()
+      : Queries(0), CommFailures(0), MagicFailures(0), ChecksumFailures(0),
+        StatusF00(0), DeviceErrors(0), Reconnects(0), ReconnectFailures(0) {};
+  FGQueryStats(const FGQueryStats &) = delete;
+
+  void Reset() {
+    QueryLatency.Reset();
+    Queries.store(0);
+    CommFailures.store(0);
+    MagicFailures.store(0);
+    ChecksumFailures.store(0);
+    StatusF00.store(0);
+    DeviceErrors.store(0);
+    ReconnectLatency.Reset();
+    Reconnects.store(0);
+    ReconnectFailures.store(0);
+  };
+};
+
+#endif /* SOURCE_FGSTATS_H_ */
@@ -0,0 +1,157 @@
+/*
+ * FGTrace.h
+ *
+ * Allocation-free binary trace of USB traffic and board frames.
+ *
+ * Records are copied raw into a fixed ring of seqlock slots; nothing is
+ * formatted until Dump() is called, so tracing costs a few word stores per
+ * event. Each call site names a level as a template argument and is compiled
+ * out entirely when that level exceeds FG_TRACE_LEVEL.
+ */
+
+#ifndef SOURCE_FGTRACE_H_
+#define SOURCE_FGTRACE_H_
+
+#include <atomic>
+#include <cstring>
+#include <functional>
+#include <iomanip>
+#include <ostream>
+#include <stdint.h>
+
+#include "PeriodicTask.h" // FGMonotonicNs
+#include "SeqLock.h"
+
+// 0: no tracing, 1: board frames and errors, 2: also every USB attempt
+#ifndef FG_TRACE_LEVEL
+#define FG_TRACE_LEVEL 2
+#endif
+
+enum FGTraceLevel { FGTraceFrames = 1, FGTraceUSB = 2 };
+
+template <int Level> struct FGTraceGate {
+  static constexpr bool On = Level <= FG_TRACE_LEVEL;
+};
+
+enum FGTraceKind : uint8_t {
+  FGTraceSent = 1,     // command frame as sent
+  FGTraceReceived,     // response frame as received
+  FGTraceBadFrame,     // response failing magic or checksum; Code: reason
+  FGTraceDeviceError,  // response with a non-zero error word in Code
+  FGTraceUSBWrite,     // one libusb write attempt; Code: libusb result
+  FGTraceUSBRead,      // one libusb read attempt; Code: libusb result
+};
+
+struct FGTraceRecord {
+  uint64_t TimestampNs;
+  uint32_t Index; // position in the trace, 1-based; 0 marks an empty slot
+  int32_t Code;
+  uint8_t Kind;
+  uint8_t Endpoint;
+  uint8_t Length; // valid bytes in Payload
+  uint8_t Reserved;
+  uint32_t Extra; // bytes transferred for USB attempts
+  uint8_t Payload[32];
+};
+
+class FGTraceRing {
+public:
+  static const uint32_t Slots = 256;
+  typedef std::function<void(std::ostream &, const FGTraceRecord &)> Formatter;
+
+private:
+  FGSeqLock<FGTraceRecord> Ring[Slots];
+  std::atomic<uint32_t> Written;
+  std::atomic<uint32_t> Cleared; // Written at the last Clear()
+
+public:
+  FGTraceRing() : Written(0), Cleared(0) {};
+  FGTraceRing(const FGTraceRing &) = delete;
+
+  template <int Level>
+  void Record(FGTraceKind Kind, int32_t Code, const void *Data = nullptr,
+              size_t Length = 0, uint8_t Endpoint = 0, uint32_t Extra = 0) {
+    if (!FGTraceGate<Level>::On)
+      return;
+    FGTraceRecord R;
+    R.TimestampNs = FGMonotonicNs();
+    R.Index = Written.fetch_add(1, std::memory_order_relaxed) + 1;
+    R.Code = Code;
+    R.Kind = Kind;
+    R.Endpoint = Endpoint;
+    R.Length = Length < sizeof(R.Payload) ? Length : sizeof(R.Payload);
+    R.Reserved = 0;
+    R.Extra = Extra;
+    memset(R.Payload, 0, sizeof(R.Payload));
+    if (Data != nullptr)
+      memcpy(R.Payload, Data, R.Length);
+    Ring[(R.Index - 1) % Slots].Store(R);
+  };
+
+  // Records written since the last Clear()
+  uint32_t Count() const {
+    return Written.load(std::memory_order_relaxed) - Cleared.load();
+  };
+  // Hides everything recorded so far. The slots are left alone: only the
+  // recording thread may store into them (see FGSeqLock).
+  void Clear() { Cleared.store(Written.load()); };
+
+  static const char *KindName(uint8_t Kind) {
+    switch (Kind) {
+    case FGTraceSent:
+      return "sent";
+    case FGTraceReceived:
+      return "recv";
+    case FGTraceBadFrame:
+      return "bad-frame";
+    case FGTraceDeviceError:
+      return "dev-error";
+    case FGTraceUSBWrite:
+      return "usb-write";
+    case FGTraceUSBRead:
+      return "usb-read";
+    default:
+      return "?";
+    }
+  };
+
+  // Generic text form of one record: kind, code and raw payload bytes.
+  static void FormatRaw(std::ostream &Str, const FGTraceRecord &R) {
+    Str << KindName(R.Kind) << " ep=0x" << std::hex << (int)R.Endpoint
+        << std::dec << " code=" << R.Code << " n=" << R.Extra;
+    if (R.Length > 0) {
+      Str << " data=" << std::hex << std::setfill('0');
+      for (int i = 0; i < R.Length; ++i)
+        Str << std::setw(2) << (int)R.Payload[i];
+      Str << std::dec << std::setfill(' ');
+    }
+  };
+
+  // Prints the retained records oldest first, one per line, with timestamps
+  // relative to the oldest one. Format overrides the payload decoding.
+  void Dump(std::ostream &Str, Formatter Format = nullptr) const {
+    uint32_t First = Cleared.load();
+    uint32_t End = Written.load(std::memory_order_relaxed);
+    uint32_t Begin = End - First > Slots ? End - Slots : First;
+    uint64_t Origin = 0;
+    std::streamsize Precision = Str.precision();
+    for (uint32_t i = Begin; i < End; ++i) {
+      FGTraceRecord R = Ring[i % Slots].Load();
+      if (R.Index != i + 1)
+        continue; // overwritten meanwhile, or not yet completed
+      if (Origin == 0)
+        Origin = R.TimestampNs;
+      Str << "#" << R.Index << " +" << std::fixed << std::setprecision(6)
+          << (R.TimestampNs - Origin) * 1e-9 << "s ";
+      Str.unsetf(std::ios_base::floatfield);
+      if (Format)
+        Format(Str, R);
+      else
+        FormatRaw(Str, R);
+      Str << "\n";
+    }
+    Str.precision(Precision);
+  };
+};
+
+#endif /* SOURCE_FGTRACE_H_ */
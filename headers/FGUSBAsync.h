@@ -0,0 +1,231 @@
+/*
+ * FGUSBAsync.h
+ *
+ * Asynchronous bulk transfers on top of libusb_submit_transfer.
+ *
+ * FGUSBEventLoop runs libusb event handling for one context on a dedicated
+ * thread and can be shared by every device opened on that context.
+ * FGUSBAsyncTransport submits transfers for one device handle and hands back
+ * futures or invokes callbacks on completion. Its Begin/WaitTransact pair
+ * posts the IN transfer before the OUT one, so the response buffer is
+ * already waiting when the device answers.
+ */
+
+#ifndef SOURCE_FGUSBASYNC_H_
+#define SOURCE_FGUSBASYNC_H_
+
+#include <atomic>
+#include <functional>
+#include <future>
+#include <libusb-1.0/libusb.h>
+#include <memory>
+#include <mutex>
+#include <sys/time.h>
+#include <thread>
+
+// Maps a completed transfer onto the synchronous libusb error codes, so that
+// callers can treat both transports alike. Returns the number of bytes
+// transferred on success.
+inline int FGUSBTransferResult(const libusb_transfer *Transfer) {
+  switch (Transfer->status) {
+  case LIBUSB_TRANSFER_COMPLETED:
+    return Transfer->actual_length;
+  case LIBUSB_TRANSFER_TIMED_OUT:
+    return LIBUSB_ERROR_TIMEOUT;
+  case LIBUSB_TRANSFER_STALL:
+    return LIBUSB_ERROR_PIPE;
+  case LIBUSB_TRANSFER_NO_DEVICE:
+    return LIBUSB_ERROR_NO_DEVICE;
+  case LIBUSB_TRANSFER_OVERFLOW:
+    return LIBUSB_ERROR_OVERFLOW;
+  case LIBUSB_TRANSFER_CANCELLED:
+    return LIBUSB_ERROR_INTERRUPTED;
+  default:
+    return LIBUSB_ERROR_IO;
+  }
+}
+
+class FGUSBEventLoop {
+private:
+  libusb_context *Context;
+  std::thread Worker;
+  std::atomic<int> StopFlag;
+  std::mutex UsersLock;
+  int Users;
+
+  void Loop() {
+    while (!StopFlag.load()) {
+      timeval Tv;
+      Tv.tv_sec = 0;
+      Tv.tv_usec = 50 * 1000; // wake up regularly to notice Stop()
+      int Completed = 0;
+      libusb_handle_events_timeout_completed(Context, &Tv, &Completed);
+    }
+  };
+
+public:
+  FGUSBEventLoop(libusb_context *Ctx)
+      : Context(Ctx), StopFlag(0), Users(0) {};
+  FGUSBEventLoop(const FGUSBEventLoop &) = delete;
+  ~FGUSBEventLoop() { Stop(); };
+
+  // Reference counted: the thread runs while at least one user is attached.
+  void Attach() {
+    std::lock_guard<std::mutex> Lock(UsersLock);
+    if (Users++ == 0) {
+      StopFlag.store(0);
+      Worker = std::thread(&FGUSBEventLoop::Loop, this);
+    }
+  };
+
+  // Joins under the lock: an Attach() racing with the last Detach() must not
+  // start a new worker while the old one is still joinable.
+  void Detach() {
+    std::lock_guard<std::mutex> Lock(UsersLock);
+    if (Users > 0 && --Users == 0)
+      Stop();
+  };
+
+  void Stop() {
+    StopFlag.store(1);
+#if defined(LIBUSB_API_VERSION) && (LIBUSB_API_VERSION >= 0x01000105)
+    if (Context != nullptr)
+      libusb_interrupt_event_handler(Context);
+#endif
+    if (Worker.joinable())
+      Worker.join();
+  };
+
+  libusb_context *GetContext() { return Context; };
+  bool IsRunning() const { return !StopFlag.load(); };
+};
+
+class FGUSBAsyncTransport {
+public:
+  typedef std::function<void(int)> Callback; // bytes transferred or error
+
+private:
+  libusb_device_handle *Handle;
+  std::shared_ptr<FGUSBEventLoop> Loop;
+
+  struct Submission {
+    Callback Done;
+    bool FreeOnDone; // false: the submitter frees the transfer itself
+  };
+
+  static void OnTransferDone(libusb_transfer *Transfer) {
+    Submission *S = static_cast<Submission *>(Transfer->user_data);
+    int Result = FGUSBTransferResult(Transfer);
+    if (S->FreeOnDone)
+      libusb_free_transfer(Transfer);
+    S->Done(Result);
+    delete S;
+  };
+
+public:
+  // Completion state of a pipelined write+read pair.
+  struct PendingTransact {
+    std::shared_ptr<std::promise<int>> WriteDone, ReadDone;
+    std::future<int> WriteResult, ReadResult;
+    libusb_transfer *ReadTransfer = nullptr; // owned until WaitTransact()
+  };
+
+  FGUSBAsyncTransport(libusb_device_handle *H,
+                      std::shared_ptr<FGUSBEventLoop> L)
+      : Handle(H), Loop(L) {
+    Loop->Attach();
+  };
+  FGUSBAsyncTransport(const FGUSBAsyncTransport &) = delete;
+  ~FGUSBAsyncTransport() { Loop->Detach(); };
+
+  std::shared_ptr<FGUSBEventLoop> GetLoop() { return Loop; };
+
+  // Submits one bulk transfer; Done runs on the event thread. Returns a
+  // libusb error code if the submission itself failed (Done is not called).
+  // If TransferOut is given the transfer is handed to the caller, who may
+  // cancel it and must libusb_free_transfer() it once Done has run.
+  int Submit(unsigned char EndpointAddress, unsigned char *Buffer, int Length,
+             unsigned int TimeoutMs, Callback Done,
+             libusb_transfer **TransferOut = nullptr) {
+    libusb_transfer *Transfer = libusb_alloc_transfer(0);
+    if (Transfer == nullptr)
+      return LIBUSB_ERROR_NO_MEM;
+    Submission *S = new Submission{Done, TransferOut == nullptr};
+    libusb_fill_bulk_transfer(Transfer, Handle, EndpointAddress, Buffer,
+                              Length, &FGUSBAsyncTransport::OnTransferDone, S,
+                              TimeoutMs);
+    if (TransferOut != nullptr)
+      *TransferOut = Transfer;
+    int Response = libusb_submit_transfer(Transfer);
+    if (Response < 0) {
+      libusb_free_transfer(Transfer);
+      delete S;
+      if (TransferOut != nullptr)
+        *TransferOut = nullptr;
+    }
+    return Response;
+  };
+
+  // Future flavour of Submit(): resolves to bytes transferred or an error.
+  std::future<int> Submit(unsigned char EndpointAddress, unsigned char *Buffer,
+                          int Length, unsigned int TimeoutMs) {
+    std::shared_ptr<std::promise<int>> Promise =
+        std::make_shared<std::promise<int>>();
+    std::future<int> Result = Promise->get_future();
+    int Response = Submit(EndpointAddress, Buffer, Length, TimeoutMs,
+                          [Promise](int R) { Promise->set_value(R); });
+    if (Response < 0)
+      Promise->set_value(Response);
+    return Result;
+  };
+
+  // Posts the IN transfer first and the OUT transfer right after it. Both
+  // buffers must stay valid until WaitTransact() returns.
+  PendingTransact BeginTransact(unsigned char Endpoint,
+                                unsigned char *WBuffer, int WLength,
+                                unsigned char *RBuffer, int RLength,
+                                unsigned int TimeoutMs) {
+    PendingTransact P;
+    P.WriteDone = std::make_shared<std::promise<int>>();
+    P.ReadDone = std::make_shared<std::promise<int>>();
+    P.WriteResult = P.WriteDone->get_future();
+    P.ReadResult = P.ReadDone->get_future();
+
+    std::shared_ptr<std::promise<int>> RD = P.ReadDone, WD = P.WriteDone;
+    Endpoint &= 0x0F;
+    int Response =
+        Submit(Endpoint | LIBUSB_ENDPOINT_IN, RBuffer, RLength, TimeoutMs,
+               [RD](int R) { RD->set_value(R); }, &P.ReadTransfer);
+    if (Response < 0) {
+      RD->set_value(Response);
+      WD->set_value(Response);
+      return P;
+    }
+    Response = Submit(Endpoint | LIBUSB_ENDPOINT_OUT, WBuffer, WLength,
+                      TimeoutMs, [WD](int R) { WD->set_value(R); });
+    if (Response < 0)
+      WD->set_value(Response);
+    return P;
+  };
+
+  // Waits for both halves. Returns the read result (bytes read) or the first
+  // error; an IN transfer orphaned by a failed write is cancelled and reaped
+  // before returning so that its buffer can be reused.
+  int WaitTransact(PendingTransact &P, int *WriteResultOut = nullptr) {
+    int W = P.WriteResult.get();
+    if (WriteResultOut != nullptr)
+      *WriteResultOut = W;
+    // The IN transfer is only freed below, so cancelling it is always safe
+    // (libusb ignores cancellation of an already completed transfer).
+    if (W < 0 && P.ReadTransfer != nullptr)
+      libusb_cancel_transfer(P.ReadTransfer);
+    int R = P.ReadResult.get();
+    if (P.ReadTransfer != nullptr) {
+      libusb_free_transfer(P.ReadTransfer);
+      P.ReadTransfer = nullptr;
+    }
+    return W < 0 ? W : R;
+  };
+};
+
+#endif /* SOURCE_FGUSBASYNC_H_ */
@@ -11,6 +11,7 @@
 #include <iomanip>  // For std::setw, std::setfill
 #include <iostream> // For std::cout, std::endl, std::hex, std::dec
 #include <libusb-1.0/libusb.h>
+#include <memory>
 #include <string>
 #include <unistd.h> // For usleep
 #include <vector>
@@ -18,6 +19,10 @@
 #include "CommonIncludes.h"
 #include "Error.h" // For Shout, Utter, and global Verbosity
 #include "FGBulk.h"
+#include "FGUSBAsync.h"
+#include "FGUSBContext.h"
+#include "FGStats.h"
+#include "FGTrace.h"
 #include "Hex.h" // For DestToHex
 #include "StringUtils.h"
 
@@ -27,9 +32,64 @@ bool FGUSBBulk_PrototypeWrite(FGUSBBulk *Params, unsigned char Endpoint,
                               unsigned char *Buffer, unsigned int Length);
 bool FGUSBBulk_PrototypeRead(FGUSBBulk *Params, unsigned char Endpoint,
                              unsigned char *Buffer, unsigned int Length);
+bool FGUSBAsync_PrototypeWrite(FGUSBBulk *Params, unsigned char Endpoint,
+                               unsigned char *Buffer, unsigned int Length);
+bool FGUSBAsync_PrototypeRead(FGUSBBulk *Params, unsigned char Endpoint,
+                              unsigned char *Buffer, unsigned int Length);
+bool FGUSBAsync_PrototypeTransact(FGUSBBulk *Params, unsigned char Endpoint,
+                                  unsigned char *WBuffer, unsigned int WLength,
+                                  unsigned char *RBuffer, unsigned int RLength);
 
 const int MaxUSBAttempts = 10;
 
+#ifdef USBTIMEOUTMS
+const int USBTransferTimeout = USBTIMEOUTMS;
+#else
+const int USBTransferTimeout = 100; // Milliseconds
+#endif
+
+// How hard one call of the transfer prototypes tries. The defaults keep the
+// historic behaviour: MaxUSBAttempts attempts of USBTransferTimeout ms each,
+// 10 ms apart, with no overall deadline.
+struct FGUSBTransferPolicy {
+  int Attempts;         // attempts per transfer, at least one
+  unsigned TimeoutMs;   // libusb timeout of each attempt
+  double BackoffMs;     // pause before the first retry
+  double BackoffFactor; // growth of the pause with every further retry
+  double MaxBackoffMs;  // cap on the pause
+  double DeadlineMs;    // budget for a whole Query() exchange, 0: none
+
+  FGUSBTransferPolicy()
+      : Attempts(MaxUSBAttempts), TimeoutMs(USBTransferTimeout),
+        BackoffMs(10.0), BackoffFactor(1.0), MaxBackoffMs(10.0),
+        DeadlineMs(0.0) {};
+
+  // Pause before attempt number Attempt (1 = first retry).
+  double BackoffBeforeMs(int Attempt) const {
+    double Pause = BackoffMs;
+    for (int i = 1; i < Attempt && Pause < MaxBackoffMs; ++i)
+      Pause *= BackoffFactor;
+    return Pause < MaxBackoffMs ? Pause : MaxBackoffMs;
+  };
+};
+
+// Stand-in for libusb_bulk_transfer() on one device, e.g. a simulated board
+// (see SimulatedBoard.h). It sits below the transfer prototypes, so their
+// retries, backoff, deadlines, statistics and trace apply unchanged; it
+// follows the libusb contract (bytes moved in Actual, a libusb error code
+// or 0 returned).
+struct FGUSBTransferHook {
+  typedef int (*Function)(void *User, unsigned char Endpoint,
+                          unsigned char *Data, int Length, int *Actual,
+                          unsigned int TimeoutMs);
+  void *User;
+  Function Fn;
+
+  FGUSBTransferHook() : User(nullptr), Fn(nullptr) {};
+  FGUSBTransferHook(void *U, Function F) : User(U), Fn(F) {};
+  explicit operator bool() const { return Fn != nullptr; };
+};
+
 class FGUSBDevice : public libusb_device_descriptor {
 public:
   void Dump() {
@@ -84,26 +144,137 @@ inline std::string LibusbErrorName(int ErrorCode) {
   return "Uknown error.";
 }
 
+// Where a device sits on the bus, and its serial number if it has one. The
+// port path ("bus-port.port...") stays the same across replugs into the
+// same socket; the serial follows the board wherever it is plugged in.
+struct FGUSBLocation {
+  uint8_t Bus = 0;
+  std::vector<uint8_t> Ports;
+  std::string Serial;
+
+  std::string Path() const {
+    std::string TempRes = itos(Bus) + "-";
+    for (size_t i = 0; i < Ports.size(); ++i)
+      TempRes += (i ? "." : "") + itos(Ports[i]);
+    return TempRes;
+  };
+};
+
+// Bus location of a device; the serial is only read if a handle is given.
+inline FGUSBLocation FGUSBDescribe(libusb_device *Device,
+                                   libusb_device_handle *Handle = nullptr) {
+  FGUSBLocation TempRes;
+  TempRes.Bus = libusb_get_bus_number(Device);
+  uint8_t Ports[8];
+  int PortCount = libusb_get_port_numbers(Device, Ports, sizeof(Ports));
+  if (PortCount > 0)
+    TempRes.Ports.assign(Ports, Ports + PortCount);
+
+  libusb_device_descriptor Desc;
+  if (Handle != nullptr && libusb_get_device_descriptor(Device, &Desc) == 0 &&
+      Desc.iSerialNumber != 0) {
+    unsigned char Buffer[256];
+    int Length = libusb_get_string_descriptor_ascii(Handle, Desc.iSerialNumber,
+                                                    Buffer, sizeof(Buffer));
+    if (Length > 0)
+      TempRes.Serial.assign((char *)Buffer, Length);
+  }
+  return TempRes;
+}
+
+inline std::vector<libusb_device *>
+FGUSBFindDevices(libusb_context *Context, uint16_t VID, uint16_t PID);
+inline void FGUSBReleaseDevices(std::vector<libusb_device *> &Devices);
+
 class FGUSBBulk {
   // ... (FGUSBBulk class members and methods as before) ...
 private:
   libusb_context *Context;
+  bool OwnsContext; // false when the context is shared with other devices
   libusb_device_handle *Handle;
   bool InterfaceClaimed;
   int InterfaceNo;
 
+  // Identity of the last device opened successfully, reused by Reopen()
+  libusb_device *CachedDevice;
+  uint16_t CachedVID, CachedPID;
+  FGUSBLocation Location;
+
+  void RememberDevice(libusb_device *Device) {
+    if (CachedDevice != Device) {
+      if (CachedDevice != nullptr)
+        libusb_unref_device(CachedDevice);
+      CachedDevice = libusb_ref_device(Device);
+    }
+    libusb_device_descriptor Desc;
+    if (libusb_get_device_descriptor(Device, &Desc) == 0) {
+      CachedVID = Desc.idVendor;
+      CachedPID = Desc.idProduct;
+    }
+    Location = FGUSBDescribe(Device, Handle);
+  };
+
+  void ForgetDevice() {
+    if (CachedDevice != nullptr)
+      libusb_unref_device(CachedDevice);
+    CachedDevice = nullptr;
+    Location = FGUSBLocation();
+  };
+
+  // Devices not handed a context use the process-wide one
+  bool EnsureContext() {
+    if (Context == nullptr) {
+      Context = FGUSBSharedContext::Get().GetContext();
+      OwnsContext = false;
+    }
+    return Context != nullptr;
+  };
+
+  FGUSBTransferHook Hook; // replaces the device while set, see UseHook()
+
+  // Asynchronous transport, (re)created on every open while AsyncWanted
+  bool AsyncWanted;
+  uint64_t DeadlineNs = 0; // of the current exchange, see BeginCall()
+  int LastError = 0;       // last libusb error of the current exchange
+  std::shared_ptr<FGUSBEventLoop> AsyncLoop;
+  std::unique_ptr<FGUSBAsyncTransport> Async;
+
+  void StartAsync() {
+    if (!AsyncLoop)
+      AsyncLoop = FGUSBSharedContext::Get().IsShared(Context)
+                      ? FGUSBSharedContext::Get().GetEventLoop()
+                      : std::make_shared<FGUSBEventLoop>(Context);
+    Async.reset(new FGUSBAsyncTransport(Handle, AsyncLoop));
+    Bridge = FGBulkBridge(this, (BulkBridgeCallback)FGUSBAsync_PrototypeWrite,
+                          (BulkBridgeCallback)FGUSBAsync_PrototypeRead,
+                          (BulkBridgeTransactCallback)FGUSBAsync_PrototypeTransact);
+  };
+
+  void StopAsync() {
+    Async.reset(); // no transfers are pending: every call waits for its own
+    Bridge = FGBulkBridge(this, (BulkBridgeCallback)FGUSBBulk_PrototypeWrite,
+                          (BulkBridgeCallback)FGUSBBulk_PrototypeRead);
+  };
+
 public:
   FGBulkBridge Bridge;
+  FGTraceRing Trace; // raw USB attempts and board frames, see Dump()
+  FGUSBStats Stats;  // latency and retry statistics of this device
+  FGUSBTransferPolicy Policy; // governs the retries of the prototypes
 
   FGUSBBulk()
-      : Context(nullptr), Handle(nullptr), InterfaceClaimed(false),
-        InterfaceNo(0),
+      : Context(nullptr), OwnsContext(true), Handle(nullptr),
+        InterfaceClaimed(false),
+        InterfaceNo(0), CachedDevice(nullptr), CachedVID(0), CachedPID(0),
+        AsyncWanted(false),
         Bridge(this, (BulkBridgeCallback)FGUSBBulk_PrototypeWrite,
                (BulkBridgeCallback)FGUSBBulk_PrototypeRead) {};
 
   FGUSBBulk(FGUSBDevice Device, int Interface)
-      : Context(nullptr), Handle(nullptr), InterfaceClaimed(false),
-        InterfaceNo(0),
+      : Context(nullptr), OwnsContext(true), Handle(nullptr),
+        InterfaceClaimed(false),
+        InterfaceNo(0), CachedDevice(nullptr), CachedVID(0), CachedPID(0),
+        AsyncWanted(false),
         Bridge(this, (BulkBridgeCallback)FGUSBBulk_PrototypeWrite,
                (BulkBridgeCallback)FGUSBBulk_PrototypeRead) {
     InterfaceNo = Interface;
@@ -112,22 +283,44 @@ public:
   };
 
   FGUSBBulk(uint16_t VID, uint16_t PID, int Interface)
-      : Context(nullptr), Handle(nullptr), InterfaceClaimed(false),
-        InterfaceNo(Interface),
+      : Context(nullptr), OwnsContext(true), Handle(nullptr),
+        InterfaceClaimed(false),
+        InterfaceNo(Interface), CachedDevice(nullptr), CachedVID(0),
+        CachedPID(0), AsyncWanted(false),
         Bridge(this, (BulkBridgeCallback)FGUSBBulk_PrototypeWrite,
                (BulkBridgeCallback)FGUSBBulk_PrototypeRead) {
     OpenDevice(VID, PID, Interface);
   };
 
   ~FGUSBBulk() {
+    // The event thread must be gone before the handle and context are
+    Async.reset();
+    AsyncLoop.reset();
+
     if (Handle != nullptr && Context != nullptr && InterfaceClaimed)
       if (libusb_release_interface(Handle, InterfaceNo) < 0)
         Shout("Unable to release USB interface");
 
     if (Handle != nullptr && Context != nullptr)
       libusb_close(Handle);
-    if (Context != nullptr)
+    ForgetDevice();
+    if (Context != nullptr && OwnsContext)
+      libusb_exit(Context);
+  };
+
+  // Makes this device use a context owned by someone else (who must keep it
+  // alive longer than this object). Closes any open device first.
+  bool UseContext(libusb_context *Shared) {
+    if (Shared == Context)
+      return true;
+    CloseDevice();
+    ForgetDevice();    // device objects belong to the previous context
+    AsyncLoop.reset(); // bound to the previous context
+    if (Context != nullptr && OwnsContext)
       libusb_exit(Context);
+    Context = Shared;
+    OwnsContext = (Shared == nullptr);
+    return true;
   };
 
   bool OpenDevice(FGUSBDevice Device, int Interface) // Keep this overload
@@ -138,41 +331,16 @@ public:
 
   bool OpenDevice(uint16_t VID, uint16_t PID, int Interface, int Skip = 0) {
     this->InterfaceNo = Interface;
-    if (Context == nullptr && libusb_init(&Context) < 0) {
-      Shout("Unable to initialize USB context.");
+    if (!EnsureContext())
       return false;
-    };
 
     if (Handle != nullptr)
       CloseDevice();
 
-    libusb_device **DevList;
-    ssize_t DeviceCount = libusb_get_device_list(Context, &DevList);
-    if (DeviceCount < 0)
-      return Shout("Unable to get USB device list", 0);
-
-    int FoundId = -1;
-    int current_skip = Skip; // Use a local copy for the skip counter
-
-    for (ssize_t i = 0; i < DeviceCount; ++i) {
-      libusb_device_descriptor TempDesc; // Use base descriptor
-      int ret = libusb_get_device_descriptor(DevList[i], &TempDesc);
-      if (ret < 0) {
-        Shout("Failed to get device descriptor for a device.");
-        continue; // Skip this device
-      }
-      if (TempDesc.idVendor == VID && TempDesc.idProduct == PID) {
-        if (current_skip > 0) {
-          current_skip--;
-        } else {
-          FoundId = (int)i;
-          break;
-        }
-      }
-    };
-
-    if (FoundId == -1) {
-      libusb_free_device_list(DevList, 1);
+    // Served from the enumeration cache on the shared context
+    std::vector<libusb_device *> Devices = FGUSBFindDevices(Context, VID, PID);
+    if (Skip < 0 || (size_t)Skip >= Devices.size()) {
+      FGUSBReleaseDevices(Devices);
       std::string msg = "Unable to locate requested device VID:0x" +
                         ToHex(VID) + " PID:0x" + ToHex(PID);
       if (Skip > 0)
@@ -180,14 +348,32 @@ public:
       return Shout(msg, 0);
     }
 
-    int open_ret = libusb_open(DevList[FoundId], &Handle);
+    bool Opened = OpenDevice(Devices[Skip], Interface);
+    FGUSBReleaseDevices(Devices);
+    return Opened;
+  };
+
+  // Opens and claims an already located device (e.g. from FGUSBFindDevices)
+  // without scanning the bus again. The device must belong to Context.
+  bool OpenDevice(libusb_device *Device, int Interface) {
+    this->InterfaceNo = Interface;
+    if (!EnsureContext())
+      return false;
+
+    if (Handle != nullptr)
+      CloseDevice();
+
+    uint64_t OpenStart = FGMonotonicNs();
+    int open_ret = libusb_open(Device, &Handle);
     if (open_ret < 0) {
       Handle = nullptr;
+      if (open_ret == LIBUSB_ERROR_NO_DEVICE &&
+          FGUSBSharedContext::Get().IsShared(Context))
+        FGUSBSharedContext::Get().Invalidate(); // the cache missed a removal
       Shout("Unable to open USB device. Libusb error: " +
             LibusbErrorName(open_ret) + " (" + itos(open_ret) + ")");
     };
 
-    libusb_free_device_list(DevList, 1);
     if (Handle == nullptr)
       return false; // Could not open
 
@@ -218,12 +404,166 @@ public:
       if (Verbosity > 0)
         std::cout << "Successfully claimed USB interface " << this->InterfaceNo
                   << std::endl;
+      RememberDevice(Device);
+      if (AsyncWanted)
+        StartAsync();
+      FGStartup().Opens.fetch_add(1, std::memory_order_relaxed);
+      FGStartup().OpenNs.fetch_add(FGMonotonicNs() - OpenStart,
+                                   std::memory_order_relaxed);
     }
     return InterfaceClaimed;
   };
 
+  // Opens the VID:PID device whose serial number string matches.
+  bool OpenBySerial(uint16_t VID, uint16_t PID, const std::string &Serial,
+                    int Interface) {
+    if (!EnsureContext())
+      return false;
+    if (Handle != nullptr)
+      CloseDevice();
+
+    std::vector<libusb_device *> Devices = FGUSBFindDevices(Context, VID, PID);
+    libusb_device *Match = nullptr;
+    for (auto *D : Devices) {
+      libusb_device_handle *Probe = nullptr;
+      if (libusb_open(D, &Probe) < 0)
+        continue;
+      bool Same = FGUSBDescribe(D, Probe).Serial == Serial;
+      libusb_close(Probe);
+      if (Same) {
+        Match = D;
+        break;
+      }
+    }
+    bool Opened = Match != nullptr && OpenDevice(Match, Interface);
+    FGUSBReleaseDevices(Devices);
+    if (Match == nullptr)
+      return Shout("Unable to locate USB device with serial \"" + Serial +
+                       "\"",
+                   0);
+    return Opened;
+  };
+
+  // Opens the VID:PID device at a port path such as "1-2.3".
+  bool OpenByPath(uint16_t VID, uint16_t PID, const std::string &Path,
+                  int Interface) {
+    if (!EnsureContext())
+      return false;
+    if (Handle != nullptr)
+      CloseDevice();
+
+    std::vector<libusb_device *> Devices = FGUSBFindDevices(Context, VID, PID);
+    libusb_device *Match = nullptr;
+    for (auto *D : Devices)
+      if (FGUSBDescribe(D).Path() == Path) {
+        Match = D;
+        break;
+      }
+    bool Opened = Match != nullptr && OpenDevice(Match, Interface);
+    FGUSBReleaseDevices(Devices);
+    if (Match == nullptr)
+      return Shout("Unable to locate USB device at port path " + Path, 0);
+    return Opened;
+  };
+
+  // Reopens the device opened last. The cached device object makes this a
+  // constant-time open while the board stays plugged in; after a replug it
+  // is located again by serial number (or, lacking one, by port path), so
+  // the same physical board is always picked regardless of bus order.
+  bool Reopen() {
+    if (CachedDevice == nullptr)
+      return false;
+    Stats.Reopens.fetch_add(1, std::memory_order_relaxed);
+    CloseDevice();
+    if (OpenDevice(CachedDevice, InterfaceNo))
+      return true;
+
+    FGUSBLocation Last = Location;
+    if (!Last.Serial.empty())
+      return OpenBySerial(CachedVID, CachedPID, Last.Serial, InterfaceNo);
+    return OpenByPath(CachedVID, CachedPID, Last.Path(), InterfaceNo);
+  };
+
+  bool HasCachedDevice() const { return CachedDevice != nullptr; };
+  const FGUSBLocation &GetLocation() const { return Location; };
+
+  // Brackets one exchange (e.g. a command and its response) that shares the
+  // Policy deadline. Outside of it transfers have no deadline.
+  void BeginCall(const FGUSBTransferPolicy &P) {
+    Policy = P;
+    LastError = 0;
+    DeadlineNs = P.DeadlineMs > 0
+                     ? FGMonotonicNs() + (uint64_t)(P.DeadlineMs * 1e6)
+                     : 0;
+  };
+  void EndCall() { DeadlineNs = 0; };
+  // Most recent libusb error code seen by the prototypes since BeginCall()
+  int GetLastError() const { return LastError; };
+  void NoteError(int Code) {
+    if (Code < 0)
+      LastError = Code;
+  };
+
+  // Clears a stall on both directions of the given endpoint.
+  bool ClearHalt(unsigned char Endpoint) {
+    if (Handle == nullptr)
+      return false;
+    Endpoint &= 0x0F;
+    int Out = libusb_clear_halt(Handle, Endpoint | LIBUSB_ENDPOINT_OUT);
+    int In = libusb_clear_halt(Handle, Endpoint | LIBUSB_ENDPOINT_IN);
+    if (Out < 0 || In < 0)
+      return Shout("Unable to clear halt on endpoint " + itos(Endpoint) +
+                       ": " + LibusbErrorName(Out < 0 ? Out : In),
+                   0);
+    return true;
+  };
+
+  // Called before attempt number Attempt (0 = first) of a transfer: waits
+  // out the backoff and yields the timeout to use. Returns false once the
+  // attempts or the deadline are used up.
+  bool NextAttempt(int Attempt, unsigned int &TimeoutMs) {
+    if (Attempt >= (Policy.Attempts > 0 ? Policy.Attempts : 1))
+      return false;
+    if (Attempt > 0) {
+      uint64_t Wake =
+          FGMonotonicNs() + (uint64_t)(Policy.BackoffBeforeMs(Attempt) * 1e6);
+      if (DeadlineNs != 0 && Wake >= DeadlineNs)
+        return false;
+      FGSleepUntilNs(Wake);
+    }
+    TimeoutMs = Policy.TimeoutMs;
+    if (DeadlineNs != 0) {
+      uint64_t Now = FGMonotonicNs();
+      if (Now >= DeadlineNs)
+        return false;
+      uint64_t LeftMs = (DeadlineNs - Now + 999999) / 1000000;
+      if (TimeoutMs == 0 || LeftMs < TimeoutMs)
+        TimeoutMs = (unsigned int)LeftMs; // >= 1: 0 would mean no timeout
+    }
+    return true;
+  };
+
+  // Routes every transfer through H instead of a USB device (closed first);
+  // an empty hook goes back to USB. Asynchronous transfers stay off meanwhile.
+  void UseHook(const FGUSBTransferHook &H) {
+    CloseDevice();
+    Hook = H;
+  };
+  bool HasHook() const { return (bool)Hook; };
+
+  // One attempt of a transfer, on the device or through the hook
+  int BulkTransfer(unsigned char Endpoint, unsigned char *Data, int Length,
+                   int *Actual, unsigned int TimeoutMs) {
+    if (Hook)
+      return Hook.Fn(Hook.User, Endpoint, Data, Length, Actual, TimeoutMs);
+    return libusb_bulk_transfer(Handle, Endpoint, Data, Length, Actual,
+                                TimeoutMs);
+  };
+
   bool CloseDevice() {
     bool TempRes = true;
+    if (Async)
+      StopAsync();
     if (Handle != nullptr) {
       if (InterfaceClaimed) {
         int release_ret = libusb_release_interface(Handle, InterfaceNo);
@@ -248,70 +588,98 @@ public:
   }
 
   operator bool() {
-    return (Context != nullptr) && (Handle != nullptr) && InterfaceClaimed;
+    return Hook ||
+           ((Context != nullptr) && (Handle != nullptr) && InterfaceClaimed);
   };
   libusb_context *GetContext() { return Context; };
   libusb_device_handle *GetHandle() { return Handle; };
   operator FGBulkBridge *() { return &Bridge; };
+
+  // Switches Bridge to the asynchronous transport. Devices on the shared
+  // context use its event loop; on a private context a loop is created,
+  // unless one is passed to share between several devices on it. The
+  // setting survives a close/reopen.
+  bool EnableAsync(std::shared_ptr<FGUSBEventLoop> SharedLoop = nullptr) {
+    if (SharedLoop) {
+      if (SharedLoop->GetContext() != Context)
+        return Shout("Shared USB event loop belongs to another context.", 0);
+      if (Async)
+        StopAsync();
+      AsyncLoop = SharedLoop;
+    }
+    AsyncWanted = true;
+    if (*this && !Hook && !Async)
+      StartAsync();
+    return true;
+  };
+
+  void DisableAsync() {
+    AsyncWanted = false;
+    if (Async)
+      StopAsync();
+  };
+
+  bool IsAsync() const { return Async != nullptr; };
+  FGUSBAsyncTransport *GetAsync() { return Async.get(); };
 };
 
-#ifdef USBTIMEOUTMS
-const int USBTransferTimeout = USBTIMEOUTMS;
-#else
-const int USBTransferTimeout = 100; // Milliseconds
-#endif
+
+// Books one finished transfer (all its attempts) into the device statistics.
+inline bool FGUSBRecordTransfer(FGUSBBulk *Params, FGLatencyHistogram &Latency,
+                                uint64_t StartNs, int Attempts, bool Success) {
+  Latency.Record(FGMonotonicNs() - StartNs);
+  Params->Stats.Retries.Record(Attempts > 1 ? Attempts - 1 : 0);
+  Params->Stats.Transfers.fetch_add(1, std::memory_order_relaxed);
+  if (!Success)
+    Params->Stats.TransferFailures.fetch_add(1, std::memory_order_relaxed);
+  return Success;
+}
 
 inline bool FGUSBBulk_PrototypeWrite(FGUSBBulk *Params, unsigned char Endpoint,
                                      unsigned char *Buffer,
                                      unsigned int Length) {
-  if (!Params || !*Params ||
-      !Params->GetHandle()) { // Added check for GetHandle()
+  if (!Params || !*Params) { // a hook needs no handle
     if (Verbosity > 0)
       std::cerr << "FGUSBBulk_PrototypeWrite: Invalid Params or USB Handle."
                 << std::endl;
     return false;
   }
 
-  if (Verbosity > 1) { // Use global Verbosity from Error.h
-    std::cout << "USB Write (Endpoint: 0x" << std::hex << (int)Endpoint
-              << std::dec << ", Length: " << Length << "): ";
-    // DestToHex is from Hex.h, which is included by FGUSBBulk.h
-    std::cout << DestToHex(Buffer, Length) << std::endl;
-  }
-
   Endpoint &= 0x0F; // Keep lower 4 bits for endpoint number, OUT is implicit by
                     // direction flag
   int Response = 0;
   int Transferred = 0;
-  int Iterations = MaxUSBAttempts;
-
-  while (Transferred < (int)Length && Iterations--) {
-    if (Iterations != MaxUSBAttempts - 1)
-      usleep(1000 * 10); // 10ms delay on retries
-
+  int Attempts = 0;
+  unsigned int TimeoutMs = USBTransferTimeout;
+  uint64_t StartNs = FGMonotonicNs();
+
+  // Retries, backoff and deadline follow Params->Policy
+  while (Transferred < (int)Length &&
+         Params->NextAttempt(Attempts, TimeoutMs)) {
+    Attempts++;
     int Actual = 0;
-    Response = libusb_bulk_transfer(
-        Params->GetHandle(),
+    Response = Params->BulkTransfer(
         (Endpoint | LIBUSB_ENDPOINT_OUT), // Endpoint direction explicitly OUT
-        Buffer + Transferred, Length - Transferred, &Actual,
-        USBTransferTimeout);
-
-    if (Verbosity > 2) { // More detailed logging for each attempt
-      std::cout << "  Attempt Write: Ep=0x" << std::hex
-                << (Endpoint | LIBUSB_ENDPOINT_OUT)
-                << ", Sent=" << (Length - Transferred) << ", Actual=" << Actual
-                << ", Resp=" << LibusbErrorName(Response) << " (" << std::dec
-                << Response << ")" << std::endl;
-    }
+        Buffer + Transferred, Length - Transferred, &Actual, TimeoutMs);
+
+    if (Verbosity > 1)
+      Params->Trace.Record<FGTraceUSB>(
+          FGTraceUSBWrite, Response, Buffer + Transferred, Length - Transferred,
+          Endpoint | LIBUSB_ENDPOINT_OUT, Actual);
 
     if (Response < 0) {
+      Params->NoteError(Response);
       // Error already logged by Shout below if total transfer fails
     } else {
       Transferred += Actual;
     };
   };
 
-  if (Transferred != (int)Length) {
+  bool Success = Transferred == (int)Length;
+  FGUSBRecordTransfer(Params, Params->Stats.WriteLatency, StartNs,
+                      Attempts, Success);
+
+  if (!Success) {
     Shout("Unable to write bulk transfer! Wrote " + itos(Transferred) + "/" +
               itos(Length) + " bytes. Last Error: [" + itos(Response) + " " +
               LibusbErrorName(Response) + "]",
@@ -324,8 +692,7 @@ inline bool FGUSBBulk_PrototypeWrite(FGUSBBulk *Params, unsigned char Endpoint,
 inline bool FGUSBBulk_PrototypeRead(FGUSBBulk *Params, unsigned char Endpoint,
                                     unsigned char *Buffer,
                                     unsigned int Length) {
-  if (!Params || !*Params ||
-      !Params->GetHandle()) { // Added check for GetHandle()
+  if (!Params || !*Params) { // a hook needs no handle
     if (Verbosity > 0)
       std::cerr << "FGUSBBulk_PrototypeRead: Invalid Params or USB Handle."
                 << std::endl;
@@ -335,45 +702,38 @@ inline bool FGUSBBulk_PrototypeRead(FGUSBBulk *Params, unsigned char Endpoint,
   Endpoint &= 0x0F; // Keep lower 4 bits, IN is implicit
   int Response = 0;
   int Transferred = 0;
-  int Iterations = MaxUSBAttempts;
-
-  while (Transferred < (int)Length && Iterations--) {
-    if (Iterations != MaxUSBAttempts - 1)
-      usleep(1000 * 10); // 10ms delay
+  int Attempts = 0;
+  unsigned int TimeoutMs = USBTransferTimeout;
+  uint64_t StartNs = FGMonotonicNs();
 
+  while (Transferred < (int)Length &&
+         Params->NextAttempt(Attempts, TimeoutMs)) {
+    Attempts++;
     int Actual = 0;
-    Response = libusb_bulk_transfer(
-        Params->GetHandle(),
+    Response = Params->BulkTransfer(
         (Endpoint | LIBUSB_ENDPOINT_IN), // Endpoint direction explicitly IN
         Buffer + Transferred,            // Read into this part of the buffer
         Length - Transferred,            // How much more to read
-        &Actual, USBTransferTimeout);
-
-    if (Verbosity > 2) {
-      std::cout << "  Attempt Read: Ep=0x" << std::hex
-                << (Endpoint | LIBUSB_ENDPOINT_IN)
-                << ", ToRead=" << (Length - Transferred)
-                << ", Actual=" << Actual
-                << ", Resp=" << LibusbErrorName(Response) << " (" << std::dec
-                << Response << ")" << std::endl;
-    }
+        &Actual, TimeoutMs);
+
+    if (Verbosity > 1)
+      Params->Trace.Record<FGTraceUSB>(FGTraceUSBRead, Response,
+                                       Buffer + Transferred, Actual,
+                                       Endpoint | LIBUSB_ENDPOINT_IN, Actual);
 
     if (Response < 0) {
+      Params->NoteError(Response);
       // Error logged by Shout below if total transfer fails
     } else {
       Transferred += Actual;
     };
   };
 
-  if (Verbosity > 1 &&
-      Transferred > 0) { // Log data if any was read, even if not full length
-    std::cout << "USB Read (Endpoint: 0x" << std::hex << (int)Endpoint
-              << std::dec << ", Expected: " << Length
-              << ", Actual Read: " << Transferred << "): ";
-    std::cout << DestToHex(Buffer, Transferred) << std::endl;
-  }
+  bool Success = Transferred == (int)Length;
+  FGUSBRecordTransfer(Params, Params->Stats.ReadLatency, StartNs,
+                      Attempts, Success);
 
-  if (Transferred != (int)Length) {
+  if (!Success) {
     Shout("Unable to read bulk transfer! Read " + itos(Transferred) + "/" +
               itos(Length) + " bytes. Last Error: [" + itos(Response) + " " +
               LibusbErrorName(Response) + "]",
@@ -383,36 +743,184 @@ inline bool FGUSBBulk_PrototypeRead(FGUSBBulk *Params, unsigned char Endpoint,
   return true; // Indicate success
 }
 
-inline std::vector<FGUSBDevice> EnumerateUSBDevices() {
-  libusb_context *MyContext;
-  if (libusb_init(&MyContext) < 0) {
-    Utter("Unable to initialize USB context for enumeration.");
-    return {}; // Return empty vector on failure
+// Asynchronous counterparts of the prototypes above. Transfers are completed
+// on the event thread; a failed attempt is resubmitted after NextAttempt()
+// has slept the policy's backoff, and never past the deadline.
+inline bool FGUSBAsync_PrototypeWrite(FGUSBBulk *Params, unsigned char Endpoint,
+                                      unsigned char *Buffer,
+                                      unsigned int Length) {
+  if (!Params || !*Params || !Params->GetAsync())
+    return FGUSBBulk_PrototypeWrite(Params, Endpoint, Buffer, Length);
+
+  Endpoint &= 0x0F;
+  int Response = 0;
+  int Transferred = 0;
+  int Attempt = 0;
+  unsigned int TimeoutMs = USBTransferTimeout;
+  uint64_t StartNs = FGMonotonicNs();
+  for (; Transferred < (int)Length && Params->NextAttempt(Attempt, TimeoutMs);
+       ++Attempt) {
+    Response = Params->GetAsync()
+                   ->Submit(Endpoint | LIBUSB_ENDPOINT_OUT, Buffer + Transferred,
+                            Length - Transferred, TimeoutMs)
+                   .get();
+    Params->NoteError(Response);
+    if (Response > 0)
+      Transferred += Response;
   }
 
-  libusb_device **MyDevList;
-  ssize_t DeviceCount = libusb_get_device_list(MyContext, &MyDevList);
+  bool Success = Transferred == (int)Length;
+  FGUSBRecordTransfer(Params, Params->Stats.WriteLatency, StartNs, Attempt,
+                      Success);
 
-  if (DeviceCount < 0) {
-    Utter("Unable to get USB device list for enumeration.");
-    libusb_exit(MyContext);
-    return {};
+  if (!Success) {
+    Shout("Unable to write async bulk transfer! Wrote " + itos(Transferred) +
+              "/" + itos(Length) + " bytes. Last Error: [" + itos(Response) +
+              " " + LibusbErrorName(Response) + "]",
+          0);
+    return false;
+  }
+  return true;
+}
+
+inline bool FGUSBAsync_PrototypeRead(FGUSBBulk *Params, unsigned char Endpoint,
+                                     unsigned char *Buffer,
+                                     unsigned int Length) {
+  if (!Params || !*Params || !Params->GetAsync())
+    return FGUSBBulk_PrototypeRead(Params, Endpoint, Buffer, Length);
+
+  Endpoint &= 0x0F;
+  int Response = 0;
+  int Transferred = 0;
+  int Attempt = 0;
+  unsigned int TimeoutMs = USBTransferTimeout;
+  uint64_t StartNs = FGMonotonicNs();
+  for (; Transferred < (int)Length && Params->NextAttempt(Attempt, TimeoutMs);
+       ++Attempt) {
+    Response = Params->GetAsync()
+                   ->Submit(Endpoint | LIBUSB_ENDPOINT_IN, Buffer + Transferred,
+                            Length - Transferred, TimeoutMs)
+                   .get();
+    Params->NoteError(Response);
+    if (Response > 0)
+      Transferred += Response;
+  }
+
+  bool Success = Transferred == (int)Length;
+  FGUSBRecordTransfer(Params, Params->Stats.ReadLatency, StartNs, Attempt,
+                      Success);
+
+  if (!Success) {
+    Shout("Unable to read async bulk transfer! Read " + itos(Transferred) +
+              "/" + itos(Length) + " bytes. Last Error: [" + itos(Response) +
+              " " + LibusbErrorName(Response) + "]",
+          0);
+    return false;
+  }
+  return true;
+}
+
+// Posts the response read ahead of the command write. If the write goes
+// through but the response is short or late, only the read is retried.
+inline bool FGUSBAsync_PrototypeTransact(FGUSBBulk *Params,
+                                         unsigned char Endpoint,
+                                         unsigned char *WBuffer,
+                                         unsigned int WLength,
+                                         unsigned char *RBuffer,
+                                         unsigned int RLength) {
+  if (!Params || !*Params || !Params->GetAsync())
+    return FGUSBBulk_PrototypeWrite(Params, Endpoint, WBuffer, WLength) &&
+           FGUSBBulk_PrototypeRead(Params, Endpoint, RBuffer, RLength);
+
+  unsigned int TimeoutMs = USBTransferTimeout;
+  if (!Params->NextAttempt(0, TimeoutMs))
+    return false;
+  uint64_t StartNs = FGMonotonicNs();
+  FGUSBAsyncTransport::PendingTransact P = Params->GetAsync()->BeginTransact(
+      Endpoint, WBuffer, WLength, RBuffer, RLength, TimeoutMs);
+  int Written = 0;
+  int Read = Params->GetAsync()->WaitTransact(P, &Written);
+  Params->NoteError(Written);
+  Params->NoteError(Read);
+  FGUSBRecordTransfer(Params, Params->Stats.TransactLatency, StartNs, 1,
+                      Written == (int)WLength && Read == (int)RLength);
+
+  if (Written != (int)WLength) {
+    // The command did not go out in one piece: send what is missing (all of
+    // it after an error) through the plain path, which carries its own
+    // retries, then read the response, like the synchronous transport.
+    int Sent = Written > 0 ? Written : 0;
+    return FGUSBAsync_PrototypeWrite(Params, Endpoint, WBuffer + Sent,
+                                     WLength - Sent) &&
+           FGUSBAsync_PrototypeRead(Params, Endpoint, RBuffer, RLength);
   }
+  if (Read == (int)RLength)
+    return true;
+  if (Read > 0 && Read < (int)RLength)
+    return FGUSBAsync_PrototypeRead(Params, Endpoint, RBuffer + Read,
+                                    RLength - Read);
+  return FGUSBAsync_PrototypeRead(Params, Endpoint, RBuffer, RLength);
+}
 
-  std::vector<FGUSBDevice> TempRes;
-  TempRes.reserve(DeviceCount); // Reserve space
+// Every device on Context matching VID:PID, in enumeration order, with a
+// reference held on each. Release them with FGUSBReleaseDevices(). On the
+// shared context the cached enumeration is used.
+inline std::vector<libusb_device *>
+FGUSBFindDevices(libusb_context *Context, uint16_t VID, uint16_t PID) {
+  if (FGUSBSharedContext::Get().IsShared(Context))
+    return FGUSBSharedContext::Get().Find(VID, PID);
+
+  std::vector<libusb_device *> TempRes;
+  libusb_device **DevList;
+  ssize_t DeviceCount = libusb_get_device_list(Context, &DevList);
+  if (DeviceCount < 0) {
+    Shout("Unable to get USB device list");
+    return TempRes;
+  }
 
   for (ssize_t i = 0; i < DeviceCount; ++i) {
-    FGUSBDevice current_device_info; // Use your derived class
-    int ret = libusb_get_device_descriptor(
-        MyDevList[i], (libusb_device_descriptor *)&current_device_info);
-    if (ret == 0) {
-      TempRes.push_back(current_device_info);
-    }
+    libusb_device_descriptor TempDesc;
+    if (libusb_get_device_descriptor(DevList[i], &TempDesc) < 0)
+      continue;
+    if (TempDesc.idVendor == VID && TempDesc.idProduct == PID)
+      TempRes.push_back(libusb_ref_device(DevList[i]));
   }
+  libusb_free_device_list(DevList, 1);
+  return TempRes;
+}
 
-  libusb_free_device_list(MyDevList, 1);
-  libusb_exit(MyContext);
+inline void FGUSBReleaseDevices(std::vector<libusb_device *> &Devices) {
+  for (auto *D : Devices)
+    libusb_unref_device(D);
+  Devices.clear();
+}
+
+// Locations (with serial numbers) of every VID:PID device, in enumeration
+// order. Devices are opened briefly to read their serial string.
+inline std::vector<FGUSBLocation> FGUSBListLocations(uint16_t VID,
+                                                     uint16_t PID) {
+  std::vector<FGUSBLocation> TempRes;
+  std::vector<libusb_device *> Devices =
+      FGUSBSharedContext::Get().Find(VID, PID);
+  for (auto *D : Devices) {
+    libusb_device_handle *Probe = nullptr;
+    if (libusb_open(D, &Probe) < 0)
+      Probe = nullptr;
+    TempRes.push_back(FGUSBDescribe(D, Probe));
+    if (Probe != nullptr)
+      libusb_close(Probe);
+  }
+  FGUSBReleaseDevices(Devices);
+  return TempRes;
+}
+
+// Descriptors of every device on the bus, from the enumeration cache
+inline std::vector<FGUSBDevice> EnumerateUSBDevices() {
+  std::vector<libusb_device_descriptor> Descs =
+      FGUSBSharedContext::Get().Descriptors();
+  std::vector<FGUSBDevice> TempRes(Descs.size());
+  for (size_t i = 0; i < Descs.size(); ++i)
+    (libusb_device_descriptor &)TempRes[i] = Descs[i];
   return TempRes;
 }
 
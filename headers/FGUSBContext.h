@@ -0,0 +1,229 @@
+/*
+ * FGUSBContext.h
+ *
+ * The process-wide libusb context, created on first use and shared by every
+ * device that is not handed one explicitly, with a cached enumeration of the
+ * bus. Where libusb supports hotplug, arrivals and departures mark the cache
+ * stale, so that opening several boards, reopening after an error or listing
+ * them costs one bus scan between changes instead of one each; without
+ * hotplug every lookup scans again.
+ *
+ * The context also owns the single event loop that asynchronous devices on
+ * it attach to, so that N boards run one event thread instead of N.
+ *
+ * Hotplug notifications are delivered while events are handled on the
+ * context, by that event loop if it runs and otherwise by the non-blocking
+ * poll done before every lookup.
+ *
+ * FGStartup() collects what the first command has to wait for (context
+ * setup, bus scans, device opens) for the startup report.
+ */
+
+#ifndef SOURCE_FGUSBCONTEXT_H_
+#define SOURCE_FGUSBCONTEXT_H_
+
+#include <atomic>
+#include <libusb-1.0/libusb.h>
+#include <memory>
+#include <mutex>
+#include <stdint.h>
+#include <sys/time.h>
+#include <vector>
+
+#include "Error.h"        // For Shout
+#include "FGUSBAsync.h"   // FGUSBEventLoop
+#include "PeriodicTask.h" // FGMonotonicNs
+
+struct FGStartupTimes {
+  std::atomic<uint64_t> OriginNs;        // FGMonotonicNs() at MarkOrigin()
+  std::atomic<uint64_t> ContextInitNs;   // spent in libusb_init
+  std::atomic<uint64_t> Enumerations;    // bus scans
+  std::atomic<uint64_t> EnumerationNs;   // spent scanning, all scans
+  std::atomic<uint64_t> CachedLookups;   // lookups answered without a scan
+  std::atomic<uint64_t> Opens;           // devices opened and claimed
+  std::atomic<uint64_t> OpenNs;          // spent opening, all devices
+  std::atomic<uint64_t> FirstExchangeNs; // FGMonotonicNs() of the first one
+  std::atomic<uint64_t> HotplugEvents;
+
+  FGStartupTimes()
+      : OriginNs(0), ContextInitNs(0), Enumerations(0), EnumerationNs(0),
+        CachedLookups(0), Opens(0), OpenNs(0), FirstExchangeNs(0),
+        HotplugEvents(0) {};
+
+  // Start of the clock (e.g. the module load); only the first call counts.
+  void MarkOrigin() {
+    uint64_t Unset = 0;
+    OriginNs.compare_exchange_strong(Unset, FGMonotonicNs());
+  };
+  // Called after every successful exchange; a single load once noted.
+  void NoteExchange() {
+    if (FirstExchangeNs.load(std::memory_order_relaxed) != 0)
+      return;
+    uint64_t Unset = 0;
+    FirstExchangeNs.compare_exchange_strong(Unset, FGMonotonicNs());
+  };
+};
+
+// Never destroyed, like the context: devices may still close during exit.
+inline FGStartupTimes &FGStartup() {
+  static FGStartupTimes *Times = new FGStartupTimes();
+  return *Times;
+}
+
+class FGUSBSharedContext {
+private:
+  struct Entry {
+    libusb_device *Device; // referenced while cached
+    libusb_device_descriptor Desc;
+  };
+
+  std::mutex Lock;
+  std::atomic<libusb_context *> Context;
+  bool Hotplug;
+  libusb_hotplug_callback_handle HotplugHandle;
+  std::atomic<bool> Stale;
+  bool Scanned;
+  std::vector<Entry> Cache;
+  std::shared_ptr<FGUSBEventLoop> Loop; // created on first use
+
+  FGUSBSharedContext()
+      : Context(nullptr), Hotplug(false), HotplugHandle(),
+        Stale(true), Scanned(false) {};
+
+  // Runs on whichever thread handles events; libusb forbids enumerating
+  // from here, so it only flags the cache.
+  static int LIBUSB_CALL OnHotplug(libusb_context *, libusb_device *,
+                                   libusb_hotplug_event, void *Self) {
+    static_cast<FGUSBSharedContext *>(Self)->Stale.store(true);
+    FGStartup().HotplugEvents.fetch_add(1, std::memory_order_relaxed);
+    return 0; // stay registered
+  };
+
+  // Lock held. Delivers pending hotplug events, then rescans if needed.
+  void Refresh(libusb_context *C) {
+    if (Hotplug) {
+      timeval Zero = {0, 0};
+      libusb_handle_events_timeout_completed(C, &Zero, nullptr);
+      if (Scanned && !Stale.load()) {
+        FGStartup().CachedLookups.fetch_add(1, std::memory_order_relaxed);
+        return;
+      }
+    }
+    Stale.store(false); // before the scan: later events must rescan again
+
+    uint64_t Start = FGMonotonicNs();
+    libusb_device **DevList;
+    ssize_t DeviceCount = libusb_get_device_list(C, &DevList);
+    if (DeviceCount < 0) {
+      Stale.store(true);
+      Shout("Unable to get USB device list");
+      return;
+    }
+    for (Entry &E : Cache)
+      libusb_unref_device(E.Device);
+    Cache.clear();
+    for (ssize_t i = 0; i < DeviceCount; ++i) {
+      Entry E;
+      if (libusb_get_device_descriptor(DevList[i], &E.Desc) < 0)
+        continue;
+      E.Device = libusb_ref_device(DevList[i]);
+      Cache.push_back(E);
+    }
+    libusb_free_device_list(DevList, 1);
+    Scanned = true;
+    FGStartup().Enumerations.fetch_add(1, std::memory_order_relaxed);
+    FGStartup().EnumerationNs.fetch_add(FGMonotonicNs() - Start,
+                                        std::memory_order_relaxed);
+  };
+
+public:
+  FGUSBSharedContext(const FGUSBSharedContext &) = delete;
+
+  // Never destroyed: devices outliving static destruction (e.g. ones owned
+  // by the interpreter at exit) may still close their handles on it.
+  static FGUSBSharedContext &Get() {
+    static FGUSBSharedContext *Instance = new FGUSBSharedContext();
+    return *Instance;
+  };
+
+  // Initializes libusb on first use; nullptr if that fails (retried on the
+  // next call).
+  libusb_context *GetContext() {
+    libusb_context *C = Context.load();
+    if (C != nullptr)
+      return C;
+    std::lock_guard<std::mutex> Guard(Lock);
+    if ((C = Context.load()) != nullptr)
+      return C;
+
+    uint64_t Start = FGMonotonicNs();
+    if (libusb_init(&C) < 0) {
+      Shout("Unable to initialize USB context.");
+      return nullptr;
+    }
+    Hotplug = libusb_has_capability(LIBUSB_CAP_HAS_HOTPLUG) != 0 &&
+              libusb_hotplug_register_callback(
+                  C,
+                  (libusb_hotplug_event)(LIBUSB_HOTPLUG_EVENT_DEVICE_ARRIVED |
+                                         LIBUSB_HOTPLUG_EVENT_DEVICE_LEFT),
+                  (libusb_hotplug_flag)0, LIBUSB_HOTPLUG_MATCH_ANY,
+                  LIBUSB_HOTPLUG_MATCH_ANY, LIBUSB_HOTPLUG_MATCH_ANY,
+                  OnHotplug, this, &HotplugHandle) == LIBUSB_SUCCESS;
+    FGStartup().ContextInitNs.store(FGMonotonicNs() - Start);
+    Context.store(C);
+    return C;
+  };
+
+  bool IsShared(libusb_context *C) const {
+    return C != nullptr && C == Context.load();
+  };
+  bool HasHotplug() {
+    std::lock_guard<std::mutex> Guard(Lock);
+    return Hotplug;
+  };
+
+  // The one event loop of the shared context; its thread runs while any
+  // device is attached. nullptr if libusb cannot be initialized.
+  std::shared_ptr<FGUSBEventLoop> GetEventLoop() {
+    libusb_context *C = GetContext();
+    if (C == nullptr)
+      return nullptr;
+    std::lock_guard<std::mutex> Guard(Lock);
+    if (!Loop)
+      Loop = std::make_shared<FGUSBEventLoop>(C);
+    return Loop;
+  };
+
+  // Every VID:PID device in enumeration order, with a reference held on
+  // each (release with FGUSBReleaseDevices()).
+  std::vector<libusb_device *> Find(uint16_t VID, uint16_t PID) {
+    std::vector<libusb_device *> TempRes;
+    libusb_context *C = GetContext();
+    if (C == nullptr)
+      return TempRes;
+    std::lock_guard<std::mutex> Guard(Lock);
+    Refresh(C);
+    for (const Entry &E : Cache)
+      if (E.Desc.idVendor == VID && E.Desc.idProduct == PID)
+        TempRes.push_back(libusb_ref_device(E.Device));
+    return TempRes;
+  };
+
+  // Descriptors of every device on the bus, in enumeration order
+  std::vector<libusb_device_descriptor> Descriptors() {
+    std::vector<libusb_device_descriptor> TempRes;
+    libusb_context *C = GetContext();
+    if (C == nullptr)
+      return TempRes;
+    std::lock_guard<std::mutex> Guard(Lock);
+    Refresh(C);
+    for (const Entry &E : Cache)
+      TempRes.push_back(E.Desc);
+    return TempRes;
+  };
+
+  // Forces the next lookup to scan the bus (e.g. after a failed open).
+  void Invalidate() { Stale.store(true); };
+};
+
+#endif /* SOURCE_FGUSBCONTEXT_H_ */
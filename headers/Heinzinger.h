@@ -2,8 +2,139 @@
 #define HEINZINGER_H
 
 #include "AnalogPSU.h" // For the FGAnalogPSUInterface member
+#include "Calibration.h"  // For the DAC/ADC scaling
+#include "CaptureRing.h"  // For streaming capture of raw samples
+#include "ChangeFeed.h"   // For change subscriptions
+#include "CommandQueue.h" // For coalesced setpoint submissions
+#include "Interlock.h"    // For limit rules on the acquisition thread
+#include "PeriodicTask.h" // For the background acquisition thread
+#include "Ramp.h"         // For timed setpoint ramps
+#include "Recording.h"    // For binary recordings of long runs
+#include "Regulator.h"    // For closed-loop regulation
+#include "SeqLock.h"      // For publishing the latest snapshot lock-free
+#include "SharedTelemetry.h" // For telemetry in POSIX shared memory
+#include "Sweep.h"        // For set-settle-measure sweeps
+#include <array>
+#include <atomic>
+#include <condition_variable>
+#include <future>
+#include <map>
+#include <mutex>
 #include <stdint.h>    // For uint16_t etc.
 
+// One consistent set of values decoded from a single Status_t response, so
+// that voltage, current and relay state always belong to the same readout.
+struct HeinzingerSnapshot {
+  bool ok;              // false if the query failed; the other fields are then
+                        // whatever the interface held from the last good readout
+  double voltage;       // converted output voltage (same units as max_volt)
+  double current;       // converted output current (same units as max_curr)
+  bool relay;           // output relay state as reported by the board
+  uint16_t daca;        // DAC A readback (voltage setpoint register)
+  uint16_t dacb;        // DAC B readback (current setpoint register)
+  uint16_t sequence_no; // board sequence number of the response
+  uint16_t errors;      // device error word (0xF00 is treated as non-critical)
+  uint64_t timestamp_ns; // FGMonotonicNs() when the response was decoded
+  std::array<int16_t, 4> adca;  // raw ADC A channels
+  std::array<uint16_t, 4> adcb; // raw ADC B channels ([2] = V, [3] = I monitor)
+};
+
+// What moved between two change events (HeinzingerChange::reasons)
+enum HeinzingerChangeReason {
+  change_voltage = 1 << 0, // beyond the voltage threshold
+  change_current = 1 << 1, // beyond the current threshold
+  change_relay = 1 << 2,
+  change_errors = 1 << 3, // device error word, including 0xF00
+  change_interlock = 1 << 4, // an interlock rule tripped
+};
+
+// Snapshot published by the acquisition thread when something changed
+struct HeinzingerChange {
+  uint64_t sequence; // increases by one per event
+  unsigned reasons;  // HeinzingerChangeReason bits
+  HeinzingerSnapshot snapshot;
+};
+
+// Progress of the ramp engine, as returned by ramp_status()
+enum HeinzingerRampState {
+  ramp_state_idle,      // no ramp started yet
+  ramp_state_running,
+  ramp_state_done,      // the last point was applied
+  ramp_state_cancelled, // stopped by cancel_ramp(); setpoints stay put
+  ramp_state_failed,    // applying the last point failed
+};
+
+struct HeinzingerRampStatus {
+  HeinzingerRampState state;
+  uint64_t steps;        // setpoint updates sent so far
+  uint64_t failed_steps; // updates that were not acknowledged
+  uint64_t overruns;     // update slots missed because the bus was slower
+  double elapsed_s;      // time since the start of the ramp
+  double duration_s;     // time of the last point
+  double voltage;        // last voltage setpoint sent (NaN: none yet)
+  double current;        // last current setpoint sent (NaN: none yet)
+};
+
+// Latched interlock trip, as returned by interlock_status()
+struct HeinzingerInterlockStatus {
+  bool tripped;          // latched until reset_interlock()
+  int rule;              // index of the rule that tripped, -1: none
+  std::string rule_name;
+  double value;          // what the rule tested (a rate for rate rules)
+  uint64_t trip_ns;      // timestamp_ns of the sample that tripped
+  uint64_t shutdown_ns;  // FGMonotonicNs() when relay-off + DAC-zero was
+                         // acknowledged, 0 while still being retried
+  uint64_t trips;        // since construction
+  HeinzingerSnapshot snapshot; // the sample that tripped
+};
+
+// Progress of a sweep, as returned by sweep_status()
+enum HeinzingerSweepState {
+  sweep_state_idle,      // no sweep started yet
+  sweep_state_running,
+  sweep_state_done,      // every point was measured
+  sweep_state_cancelled, // stopped by cancel_sweep()
+  sweep_state_failed,    // a step or the readouts of a point failed
+};
+
+struct HeinzingerSweepStatus {
+  HeinzingerSweepState state;
+  size_t points_done;       // points measured so far
+  size_t points_total;
+  uint64_t failed_readouts; // readouts that were not answered
+  uint64_t settle_timeouts; // points that did not settle in settle time
+  double elapsed_s;         // since the start of the sweep
+};
+
+// Result of one sweep point
+struct HeinzingerSweepPoint {
+  double setpoint;
+  double voltage; // mean or median of the samples
+  double voltage_std;
+  double current;
+  double current_std;
+  unsigned samples;
+  double settle_s; // time from the step to the first sample
+  bool settled;    // the readback settled (false: settle time ran out or
+                   // settle detection was off)
+};
+
+// State of the closed-loop regulation, as returned by regulation_status()
+struct HeinzingerRegulationStatus {
+  bool running;
+  uint64_t cycles;
+  uint64_t failed_cycles; // cycles whose command/readout failed
+  uint64_t held_cycles;   // cycles without fresh readback: loops held
+  uint64_t overruns;      // loop periods missed because the bus was slower
+  double voltage_error;   // setpoint - measured at the last cycle
+  double current_error;
+  double voltage_command; // value programmed instead of the setpoint
+  double current_command;
+};
+
+// Read-only view of another process's shared telemetry
+typedef FGTelemetryReader<HeinzingerSnapshot> HeinzingerTelemetryReader;
+
 // Declaration of the HeinzingerVia16BitDAC class
 class HeinzingerVia16BitDAC {
 private:
@@ -13,26 +144,175 @@ private:
   double max_analog_in_volt;
   uint16_t max_analog_in_volt_bin;
 
-  // These seem to be for storing current state, but are not read from in the
-  // provided .cpp You might want to ensure they are updated if they are meant
-  // to reflect PSU state.
-  double
+  // Last accepted setpoints and last relay readback. Atomic because the
+  // acquisition thread and Python threads touch them concurrently.
+  std::atomic<double>
       set_volt_cache; // Renamed from set_volt to avoid confusion with parameter
-  double set_curr_cache; // Renamed from set_curr
-  bool relay_cache;      // Renamed from relay
+  std::atomic<double> set_curr_cache; // Renamed from set_curr
+  std::atomic<bool> relay_cache;      // Renamed from relay
 
   double max_volt;
   double max_curr;
+  FGPSUCalibration calibration; // guarded by Interface.QueryMutex
 
   bool verbose;
   int _usbIndex;   // store which identical device to open
 
   bool update(); // This is a private helper
+  void configure(); // post-open checks shared by the constructors
+
+  // Setters trust the response to their own command. With verify_setpoints
+  // set they additionally read back and compare the commanded channels.
+  std::atomic<bool> verify_setpoints;
+  bool confirm(bool sent, uint8_t mask, uint16_t daca, uint16_t dacb,
+               bool relay);
+
+  // Conversions from setpoints to DAC register values
+  uint16_t voltage_register(double volt) const;
+  uint16_t current_register(double curr) const;
+
+  // Conversions from raw ADC B monitor readings to engineering units
+  double convert_voltage(uint16_t raw) const;
+  double convert_current(uint16_t raw) const;
+  // Builds a snapshot from whatever the interface decoded last; with
+  // Interface.QueryMutex held
+  HeinzingerSnapshot decode_snapshot(bool ok);
+  // The same, failed, taking the lock itself (for requests refused early)
+  HeinzingerSnapshot failed_snapshot();
+
+  // Optional background acquisition: one thread owns the polling and
+  // publishes every decoded readout through a seqlock, so that readers
+  // never touch USB.
+  FGPeriodicTask acquisition;
+  std::mutex acquisition_start_mutex; // serializes starting and stopping
+  FGSeqLock<HeinzingerSnapshot> latest_snapshot;
+  std::atomic<uint64_t> acquisition_errors;
+  bool acquire_once(); // body of the acquisition loop
+
+  // Change events derived from the acquired snapshots; each one is compared
+  // with the snapshot of the last event, so slow drifts add up.
+  FGChangeFeed<HeinzingerChange> changes;
+  HeinzingerSnapshot change_reference; // acquisition thread only
+  std::atomic<double> change_volt_threshold;
+  std::atomic<double> change_curr_threshold;
+  void detect_change(const HeinzingerSnapshot &snap);
+
+  // Interlock rules, evaluated on every valid frame (error words included).
+  // A trip switches the relay off and zeroes both DACs with one command
+  // from the acquisition thread and latches; rules and status are guarded
+  // by Interface.QueryMutex.
+  FGInterlock interlock;
+  HeinzingerInterlockStatus interlock_state;
+  std::atomic<bool> interlock_latched;
+  std::atomic<uint64_t> interlock_trips; // mirrors interlock_state.trips
+  void check_interlock(const HeinzingerSnapshot &snap);
+  bool interlock_shutdown(); // relay off, DACs zero; with the lock held
+  bool interlock_blocks() const; // refuses output commands while latched
+
+  // Optional publication of every acquired snapshot and sample into shared
+  // memory for other processes; guarded by Interface.QueryMutex.
+  std::unique_ptr<FGTelemetryPublisher<HeinzingerSnapshot>> shared_telemetry;
+
+  // Optional binary recording of every acquired readout; guarded by its
+  // own mutex so stats() never waits on the bus (the file itself is written
+  // by the recorder's thread).
+  mutable std::mutex recorder_mutex;
+  std::unique_ptr<FGRecorder> recorder;
+
+  // Streaming capture rides on the acquisition thread: while active, every
+  // readout is also pushed into the preallocated ring.
+  FGCaptureRing capture_ring;
+  std::atomic<bool> capture_active;
+  bool capture_owns_acquisition; // acquisition was started by start_capture()
+  uint64_t capture_saved_period_ns; // acquisition period to restore on stop
+
+  // Ramp engine: its own thread steps through the profile on absolute
+  // deadlines and records the readback of every update.
+  FGPeriodicTask ramp_task;
+  mutable std::mutex ramp_mutex; // guards the members below
+  FGRampProfile ramp_profile;
+  HeinzingerRampStatus ramp_state;
+  uint64_t ramp_start_ns;
+  std::vector<HeinzingerSnapshot> ramp_log;
+  bool ramp_once(); // body of the ramp loop
+
+  // Closed-loop regulation: its own thread trims DACA/DACB every cycle from
+  // the monitor readback, with one combined command per cycle. Controllers
+  // and status are guarded by Interface.QueryMutex.
+  FGPeriodicTask regulation;
+  FGPIController volt_loop, curr_loop;
+  HeinzingerRegulationStatus regulation_state;
+  uint64_t regulation_last_ns;
+  uint64_t regulation_sample_ns; // Interface.LastGoodNs last integrated
+  bool regulate_once(); // body of the regulation loop
+
+  // Coalescing command queue: submissions merge into one pending command,
+  // which its own thread sends with apply() as soon as the previous one is
+  // answered, at whatever rate the bus sustains.
+  FGCoalescingQueue<HeinzingerSnapshot> command_queue;
+  FGPeriodicTask command_task;
+  std::mutex command_start_mutex; // serializes starting and stopping
+  bool command_once(); // body of the command loop
+  // Validates and builds a submission; false (with a message) if invalid
+  bool queued_command(double volt, double curr, int relay,
+                      FGSetpointCommand &cmd) const;
+  void send_batch(FGCoalescingQueue<HeinzingerSnapshot>::Batch &batch);
+
+  // Sweep engine: its own thread steps through the points and, at
+  // SampleHz, waits for the readback to settle and then oversamples it.
+  // Points, config and the per-point buffers belong to the sweep thread
+  // while it runs; status and results are guarded by sweep_mutex.
+  enum SweepPhase { sweep_step, sweep_settle, sweep_measure };
+  FGPeriodicTask sweep_task;
+  std::vector<double> sweep_points;
+  FGSweepConfig sweep_config;
+  size_t sweep_index;
+  SweepPhase sweep_phase;
+  uint64_t sweep_step_ns;
+  unsigned sweep_attempts;
+  bool sweep_settled;
+  double sweep_settle_s;
+  FGSettleDetector sweep_detector;
+  std::vector<double> sweep_volts, sweep_currs;
+  mutable std::mutex sweep_mutex;
+  std::condition_variable sweep_finished;
+  HeinzingerSweepStatus sweep_state;
+  uint64_t sweep_start_ns, sweep_end_ns;
+  std::vector<HeinzingerSweepPoint> sweep_log;
+  std::vector<std::function<void(const std::vector<HeinzingerSweepPoint> &)>>
+      sweep_waiters; // on_sweep_done() callbacks of the running sweep
+  bool sweep_once(); // body of the sweep loop
+  bool finish_sweep(HeinzingerSweepState state);
 
 public:
   // Constructor
   HeinzingerVia16BitDAC(int    device_index = 0, double max_voltage = 30000.0, double max_current = 2.0,
                         bool verbose = false, double max_input_voltage = 10.0);
+  // Opens the board with the given USB serial number, or (if serial is
+  // empty) the one at the given port path such as "1-2.3". Unlike the device
+  // index, both stay tied to the same physical board across replugs.
+  HeinzingerVia16BitDAC(const std::string &serial, const std::string &usb_path,
+                        double max_voltage, double max_current, bool verbose,
+                        double max_input_voltage);
+  // Talks to the board through an arbitrary bulk bridge instead of USB,
+  // e.g. FGReplayBoard::MakeBridge(). The bridge's target must outlive
+  // this object.
+  HeinzingerVia16BitDAC(const FGBulkBridge &link, double max_voltage,
+                        double max_current, bool verbose,
+                        double max_input_voltage);
+  // Keeps the USB transfer layer but has the hook stand in for the device,
+  // e.g. FGSimulatedBoard::MakeTransfers(). The hook's target must outlive
+  // this object.
+  HeinzingerVia16BitDAC(const FGUSBTransferHook &transfers, double max_voltage,
+                        double max_current, bool verbose,
+                        double max_input_voltage);
+  // Uses a board already located on a context shared with other boards
+  // (e.g. by PSUArray); the caller keeps the context alive.
+  HeinzingerVia16BitDAC(libusb_context *shared_context, libusb_device *device,
+                        int device_index, double max_voltage,
+                        double max_current, bool verbose,
+                        double max_input_voltage);
+  ~HeinzingerVia16BitDAC();
 
   // Public interface methods
   bool switch_on();
@@ -41,14 +321,223 @@ public:
   bool set_current(double set_val);
   bool is_relay_on() const               // true => output enabled
   {
-    return Interface.Relay_val != 0;   // Relay_val comes from the board
+    if (acquisition.IsRunning())
+      return relay_cache.load();
+    std::lock_guard<std::recursive_mutex> lock(Interface.QueryMutex);
+    return Interface.Readback.Relay != 0; // decoded from the board
   }
 
   double read_voltage();
   double read_current();
+  // Single Readout() returning every monitored value from the same packet
+  HeinzingerSnapshot read_snapshot();
+  // Applies voltage, current and relay in one combined Query() and returns
+  // the readback from its response. Pass NAN (volt/curr) or a negative relay
+  // to leave that channel unchanged; on validation failure nothing is sent.
+  HeinzingerSnapshot apply(double volt, double curr, int relay = -1);
   bool set_max_volt();
   bool set_max_curr();
   void readADC();
+
+  // Identity of the opened board
+  std::string usb_serial() const {
+    return Interface.Bridge.GetLocation().Serial;
+  }
+  std::string usb_path() const { return Interface.Bridge.GetLocation().Path(); }
+
+  // Extra readout after every setter to verify the DAC/relay readback
+  void set_verify(bool verify) { verify_setpoints = verify; }
+  bool get_verify() const { return verify_setpoints.load(); }
+
+  // Selects the libusb asynchronous transport (submitted transfers completed
+  // on an event thread) instead of blocking bulk transfers. Boards on the
+  // shared context all use its single event thread; shared_loop does the
+  // same for boards on a private context.
+  bool set_async_usb(bool enable,
+                     std::shared_ptr<FGUSBEventLoop> shared_loop = nullptr);
+  bool is_async_usb() const { return Interface.Bridge.IsAsync(); }
+
+  // Last setpoints accepted by set_voltage()/set_current()
+  double get_set_voltage() const { return set_volt_cache.load(); }
+  double get_set_current() const { return set_curr_cache.load(); }
+
+  // While verbose, every exchange is recorded raw into a trace ring; text is
+  // only produced by dump_trace(), oldest record first.
+  void set_verbose(bool on);
+  bool get_verbose() const { return verbose; }
+  std::string dump_trace() const;
+  void clear_trace() { Interface.Bridge.Trace.Clear(); }
+
+  // DAC/ADC scaling. Corrections are "setpoint,measured" CSV files as
+  // written by the linearity measurement; setpoints are then programmed so
+  // that the measured output matches the request. A new calibration must
+  // keep the ranges given to the constructor; false otherwise.
+  FGPSUCalibration get_calibration() const;
+  bool set_calibration(const FGPSUCalibration &cal);
+  bool load_voltage_correction(const std::string &csv);
+  bool load_current_correction(const std::string &csv);
+  void clear_corrections();
+
+  // After NO_DEVICE/PIPE/IO errors the board is reopened from its cached
+  // identity and the last commanded DAC/relay state replayed (automatically
+  // unless disabled, or on demand with reconnect()).
+  bool reconnect();
+  void set_auto_reconnect(bool enable);
+  bool get_auto_reconnect() const;
+
+  // Retry/backoff/deadline policy of plain readouts and of commands
+  FGUSBTransferPolicy get_readout_policy() const;
+  void set_readout_policy(const FGUSBTransferPolicy &policy);
+  FGUSBTransferPolicy get_command_policy() const;
+  void set_command_policy(const FGUSBTransferPolicy &policy);
+
+  // Query/USB counters and latency percentiles (in microseconds) as a flat
+  // name -> value map, e.g. "query_p99_us" or "checksum_failures".
+  std::map<std::string, double> stats() const;
+  void reset_stats();
+
+  // Background acquisition. While running, read_voltage(), read_current(),
+  // read_snapshot() and is_relay_on() are served from the cache.
+  bool start_acquisition(double rate_hz = 100.0);
+  void stop_acquisition();
+  bool acquisition_running() const { return acquisition.IsRunning(); }
+  uint64_t get_acquisition_errors() const { return acquisition_errors.load(); }
+  // Most recent published snapshot; never blocks and never touches USB.
+  // ok is false until the first successful acquisition and whenever the
+  // last cycle failed (the fields then hold the last decoded frame).
+  HeinzingerSnapshot latest() const { return latest_snapshot.Load(); }
+
+  // Change subscriptions, fed by the acquisition thread (start it first).
+  // An event fires when voltage or current move beyond their threshold
+  // from the last event, the relay flips or the error word changes.
+  void set_change_thresholds(double volt, double curr);
+  double get_voltage_threshold() const { return change_volt_threshold; }
+  double get_current_threshold() const { return change_curr_threshold; }
+  uint64_t change_sequence() const { return changes.GetSequence(); }
+  // Blocks until an event newer than `after` exists (timeout_s < 0:
+  // forever) and yields the next one still kept (see FGChangeFeed); false
+  // on timeout.
+  bool wait_for_change(uint64_t after, double timeout_s,
+                       HeinzingerChange &out) const;
+  // Callbacks run on a dispatcher thread, never on the acquisition thread,
+  // and see the latest change only when they fall behind
+  int subscribe(const std::function<void(const HeinzingerChange &)> &fn);
+  bool unsubscribe(int id);
+
+  // Interlock rules run on the acquisition thread (start it first), so a
+  // trip reacts within one sample period. While tripped, switch_on() and
+  // the setters refuse to command the output; switch_off() still works.
+  bool add_interlock_rule(const FGInterlockRule &rule);
+  void clear_interlock_rules();
+  std::vector<FGInterlockRule> interlock_rules() const;
+  HeinzingerInterlockStatus interlock_status() const;
+  bool interlock_tripped() const { return interlock_latched.load(); }
+  // Clears the latch; false while the shutdown is not yet acknowledged.
+  bool reset_interlock();
+
+  // Publishes the latest snapshot and a ring of `capacity` raw samples in
+  // the POSIX shared-memory segment `name` (e.g. "/heinzinger0"), updated
+  // by the acquisition thread, for HeinzingerTelemetryReader clients.
+  bool start_shared_telemetry(const std::string &name,
+                              size_t capacity = 65536);
+  void stop_shared_telemetry();
+  std::string shared_telemetry_name() const;
+
+  // Records every acquired readout (raw ADC, DAC readback, relay, error
+  // word) into a binary file; read it back with FGRecordingReader or
+  // heinzinger_control.Recording. Needs the acquisition thread.
+  bool start_recording(const std::string &path,
+                       const std::string &comment = "");
+  bool stop_recording(); // false if not everything reached the disk
+  bool recording() const;
+
+  // Streaming capture of raw samples into a ring of `capacity` entries,
+  // polling at rate_hz (<= 0: as fast as the bus allows). Starts the
+  // acquisition thread if needed. The ring is reallocated on every start.
+  bool start_capture(size_t capacity = 65536, double rate_hz = 0);
+  void stop_capture();
+  bool capture_running() const { return capture_active.load(); }
+  uint64_t capture_count() const { return capture_ring.Count(); }
+  size_t capture_head() const { return capture_ring.Head(); }
+  size_t capture_capacity() const { return capture_ring.Capacity(); }
+  std::shared_ptr<FGCaptureRing::Storage> capture_storage() const {
+    return capture_ring.Buffer();
+  }
+
+  // Timed ramps run on a dedicated thread which, update_hz times a second,
+  // programs the setpoints interpolated from the points and records the
+  // readback. Every point must lie within max_volt/max_curr. Other setters
+  // stay usable while a ramp runs, but the next step overrides them.
+  bool start_ramp(const std::vector<FGRampPoint> &points,
+                  double update_hz = 100.0);
+  // Ramps from the last accepted setpoints to volt/curr (NaN: unchanged) at
+  // no more than the given slew rates per second (<= 0: step at once).
+  bool ramp_to(double volt, double volt_slew, double curr = NAN,
+               double curr_slew = 0, double update_hz = 100.0);
+  void cancel_ramp();
+  bool ramp_running() const { return ramp_task.IsRunning(); }
+  HeinzingerRampStatus ramp_status() const;
+  // Readback of every step of the current (or last) ramp
+  std::vector<HeinzingerSnapshot> ramp_readback() const;
+
+  // Sweeps through voltage (or, with config.SweepCurrent, current)
+  // setpoints on a dedicated thread: steps each point, waits up to
+  // SettleTime (ending early once the readback settles, if enabled) and
+  // reduces SamplesPerPoint combined readouts. Returns immediately.
+  bool start_sweep(const std::vector<double> &points,
+                   const FGSweepConfig &config);
+  // Waits until the sweep is no longer running; false on timeout
+  // (timeout_s < 0: forever).
+  bool wait_sweep(double timeout_s = -1);
+  void cancel_sweep();
+  bool sweep_running() const { return sweep_task.IsRunning(); }
+  HeinzingerSweepStatus sweep_status() const;
+  // Results of the points measured so far
+  std::vector<HeinzingerSweepPoint> sweep_results() const;
+  // Calls done with the results once the running sweep ends (at once if
+  // none is running)
+  void on_sweep_done(
+      const std::function<void(const std::vector<HeinzingerSweepPoint> &)>
+          &done);
+  // start_sweep() and wait_sweep() in one; returns the results (see
+  // sweep_status() for whether every point was measured)
+  std::vector<HeinzingerSweepPoint> sweep(const std::vector<double> &points,
+                                          const FGSweepConfig &config);
+
+  // Queued setpoints for bursty callers (e.g. a UI slider): validates the
+  // given channels (NaN / negative relay: unchanged) and merges them into
+  // the pending command, each channel keeping its last submitted value. The
+  // future yields the readback of the combined command the submission went
+  // out with (ok false if it was invalid or failed). The queue thread is
+  // started on first use.
+  std::future<HeinzingerSnapshot> submit(double volt, double curr,
+                                         int relay = -1);
+  bool start_command_queue();
+  void stop_command_queue(); // sends what is still pending first
+  bool command_queue_running() const { return command_task.IsRunning(); }
+
+  // Completion callbacks for event-driven callers such as asyncio: done is
+  // called exactly once, from the queue or sweep thread, or right away on
+  // the calling thread if there is nothing to wait for. It must not block.
+  void submit(double volt, double curr, int relay,
+              const std::function<void(const HeinzingerSnapshot &)> &done);
+  // The latest acquired snapshot while acquisition runs, otherwise a
+  // readout queued like submit() and shared with whatever is pending.
+  void read_snapshot_async(
+      const std::function<void(const HeinzingerSnapshot &)> &done);
+
+  // Closed-loop regulation at rate_hz. Each enabled channel programs the
+  // PI-corrected command for its last accepted setpoint, so set_voltage(),
+  // apply() and ramps keep working and now define the target. Only active
+  // while the relay is on; otherwise the loop just reads out.
+  bool start_regulation(double rate_hz = 200.0);
+  void stop_regulation();
+  bool regulation_running() const { return regulation.IsRunning(); }
+  HeinzingerRegulationStatus regulation_status() const;
+  FGPIConfig get_voltage_loop() const;
+  void set_voltage_loop(const FGPIConfig &config);
+  FGPIConfig get_current_loop() const;
+  void set_current_loop(const FGPIConfig &config);
 };
 
 #endif // HEINZINGER_H
\ No newline at end of file
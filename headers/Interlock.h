@@ -0,0 +1,143 @@
+/*
+ * Interlock.h
+ *
+ * Limit rules evaluated on every acquired sample. A rule watches the
+ * converted voltage or current monitor (ADCB[2]/ADCB[3]) or the device
+ * error word, and trips when its condition has held for HoldS seconds
+ * (0: on the first sample). Conditions are a threshold exceeded from above
+ * or below, a rate of change between consecutive samples above a limit, or
+ * a critical error word (anything but 0 and the non-critical 0xF00).
+ *
+ * FGInterlock only decides; acting on a trip is up to the caller.
+ */
+
+#ifndef SOURCE_INTERLOCK_H_
+#define SOURCE_INTERLOCK_H_
+
+#include <cmath>
+#include <stdint.h>
+#include <string>
+#include <vector>
+
+enum class FGInterlockChannel { Voltage, Current, Errors };
+enum class FGInterlockKind {
+  Above,     // value > Limit
+  Below,     // value < Limit
+  RateAbove, // |d value / dt| > Limit per second
+  ErrorWord, // (errors & Mask) != 0, 0xF00 excepted
+};
+
+struct FGInterlockRule {
+  std::string Name;
+  FGInterlockChannel Channel;
+  FGInterlockKind Kind;
+  double Limit;
+  double HoldS;       // time the condition must persist before tripping
+  uint16_t Mask;      // ErrorWord: bits that count
+  bool RequireRelay;  // only evaluated while the output relay is on
+
+  FGInterlockRule()
+      : Channel(FGInterlockChannel::Voltage), Kind(FGInterlockKind::Above),
+        Limit(0), HoldS(0), Mask(0xFFFF), RequireRelay(false) {};
+};
+
+class FGInterlock {
+  struct RuleState {
+    double Previous;     // last value, for rates
+    uint64_t PreviousNs; // 0: none yet
+    uint64_t SinceNs;    // start of the violation, 0: not violated
+  };
+  std::vector<FGInterlockRule> Rules;
+  std::vector<RuleState> States;
+
+  static double ValueOf(const FGInterlockRule &R, double Volt, double Curr,
+                        uint16_t Errors) {
+    switch (R.Channel) {
+    case FGInterlockChannel::Voltage:
+      return Volt;
+    case FGInterlockChannel::Current:
+      return Curr;
+    case FGInterlockChannel::Errors:
+      return Errors;
+    }
+    return NAN;
+  };
+
+public:
+  // False if the rule cannot be evaluated (e.g. a rate on the error word).
+  static bool Valid(const FGInterlockRule &R) {
+    if (!(R.HoldS >= 0) || std::isinf(R.HoldS))
+      return false;
+    if (R.Kind == FGInterlockKind::ErrorWord)
+      return R.Channel == FGInterlockChannel::Errors;
+    return R.Channel != FGInterlockChannel::Errors && std::isfinite(R.Limit);
+  };
+
+  bool Add(const FGInterlockRule &R) {
+    if (!Valid(R))
+      return false;
+    Rules.push_back(R);
+    RuleState S = {0.0, 0, 0};
+    States.push_back(S);
+    return true;
+  };
+  void Clear() {
+    Rules.clear();
+    States.clear();
+  };
+  // Forgets rates and running hold times, e.g. after a trip was cleared.
+  void Reset() {
+    for (RuleState &S : States)
+      S.PreviousNs = S.SinceNs = 0;
+  };
+  const std::vector<FGInterlockRule> &GetRules() const { return Rules; };
+  bool Empty() const { return Rules.empty(); };
+
+  // Feeds one sample; returns the index of the first rule that trips, or
+  // -1. Value receives the quantity that rule tested (a rate for RateAbove).
+  int Evaluate(uint64_t Ns, double Volt, double Curr, uint16_t Errors,
+               bool Relay, double &Value) {
+    int Tripped = -1;
+    for (size_t i = 0; i < Rules.size(); ++i) {
+      const FGInterlockRule &R = Rules[i];
+      RuleState &S = States[i];
+      double V = ValueOf(R, Volt, Curr, Errors);
+      bool Violated = false;
+      double Tested = V;
+      switch (R.Kind) {
+      case FGInterlockKind::Above:
+        Violated = V > R.Limit;
+        break;
+      case FGInterlockKind::Below:
+        Violated = V < R.Limit;
+        break;
+      case FGInterlockKind::RateAbove:
+        if (S.PreviousNs != 0 && Ns > S.PreviousNs) {
+          Tested = (V - S.Previous) / ((Ns - S.PreviousNs) * 1e-9);
+          Violated = std::fabs(Tested) > R.Limit;
+        }
+        S.Previous = V;
+        S.PreviousNs = Ns;
+        break;
+      case FGInterlockKind::ErrorWord:
+        Violated = Errors != 0 && Errors != 0xF00 && (Errors & R.Mask) != 0;
+        break;
+      }
+      if (R.RequireRelay && !Relay)
+        Violated = false;
+      if (!Violated) {
+        S.SinceNs = 0;
+        continue;
+      }
+      if (S.SinceNs == 0)
+        S.SinceNs = Ns;
+      if (Tripped < 0 && (Ns - S.SinceNs) * 1e-9 >= R.HoldS) {
+        Tripped = (int)i;
+        Value = Tested;
+      }
+    }
+    return Tripped;
+  };
+};
+
+#endif /* SOURCE_INTERLOCK_H_ */
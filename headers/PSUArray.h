@@ -0,0 +1,48 @@
+#ifndef PSUARRAY_H
+#define PSUARRAY_H
+
+#include "Heinzinger.h"
+#include <memory>
+#include <mutex>
+#include <vector>
+
+// All Heinzinger supplies attached through analog interface boards
+// (VID 0xA0A0 / PID 0x000C). The bus is enumerated once, every board is
+// opened on the process-wide libusb context with one shared event thread,
+// and the *_all() calls talk to every board in parallel, so that N supplies
+// cost roughly one round trip of wall time. The calling thread serves board
+// 0 and one persistent worker thread each of the others. A board that fails
+// to open throws std::runtime_error naming it.
+class PSUArray {
+private:
+  struct worker; // defined in PSUArray.cpp
+
+  libusb_context *context;
+  std::shared_ptr<FGUSBEventLoop> event_loop;
+  std::vector<std::unique_ptr<HeinzingerVia16BitDAC>> devices;
+  std::vector<std::unique_ptr<worker>> workers; // for boards 1..N-1
+  std::mutex fan_out_lock; // one *_all() call at a time uses the workers
+
+  template <class F> std::vector<HeinzingerSnapshot> fan_out(F fn);
+
+public:
+  PSUArray(double max_voltage = 30000.0, double max_current = 2.0,
+           bool verbose = false, double max_input_voltage = 10.0,
+           bool async_usb = true);
+  PSUArray(const PSUArray &) = delete;
+  ~PSUArray();
+
+  size_t size() const { return devices.size(); }
+  HeinzingerVia16BitDAC &at(size_t index);
+
+  // One fresh snapshot per board, in enumeration order
+  std::vector<HeinzingerSnapshot> read_all();
+  // Per-board apply(); the vectors must be empty (leave all unchanged) or
+  // hold one entry per board, NAN / negative relay meaning unchanged
+  std::vector<HeinzingerSnapshot> apply_all(const std::vector<double> &volts,
+                                            const std::vector<double> &currs,
+                                            const std::vector<int> &relays);
+  std::vector<HeinzingerSnapshot> switch_all(bool on);
+};
+
+#endif // PSUARRAY_H
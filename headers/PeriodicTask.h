@@ -0,0 +1,115 @@
+/*
+ * PeriodicTask.h
+ *
+ * A worker thread that runs a callback on absolute monotonic deadlines, so
+ * that the loop period does not drift with the time spent in the callback.
+ */
+
+#ifndef SOURCE_PERIODICTASK_H_
+#define SOURCE_PERIODICTASK_H_
+
+#include <atomic>
+#include <chrono>
+#include <functional>
+#include <stdint.h>
+#include <thread>
+#include <time.h>
+
+// Monotonic clock in nanoseconds, used for all sample timestamps.
+inline uint64_t FGMonotonicNs() {
+  return std::chrono::duration_cast<std::chrono::nanoseconds>(
+             std::chrono::steady_clock::now().time_since_epoch())
+      .count();
+}
+
+// Sleeps until the given FGMonotonicNs() deadline.
+inline void FGSleepUntilNs(uint64_t Deadline) {
+#if defined(__linux__)
+  // libstdc++'s steady_clock is CLOCK_MONOTONIC, so the two are comparable.
+  timespec Ts;
+  Ts.tv_sec = Deadline / 1000000000ull;
+  Ts.tv_nsec = Deadline % 1000000000ull;
+  while (clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, &Ts, nullptr) != 0)
+    ; // EINTR: simply go back to sleep until the absolute deadline
+#else
+  std::this_thread::sleep_until(std::chrono::steady_clock::time_point(
+      std::chrono::nanoseconds(Deadline)));
+#endif
+}
+
+class FGPeriodicTask {
+public:
+  // Return false from the body to end the task from inside the loop.
+  typedef std::function<bool()> Body;
+
+private:
+  std::thread Worker;
+  std::atomic<bool> StopRequested;
+  std::atomic<bool> Running;
+  std::atomic<uint64_t> PeriodNs;
+  std::atomic<uint64_t> Overruns;
+
+  void Loop(Body Fn) {
+    uint64_t Deadline = FGMonotonicNs();
+    while (!StopRequested.load(std::memory_order_relaxed)) {
+      if (!Fn())
+        break;
+
+      uint64_t Period = PeriodNs.load(std::memory_order_relaxed);
+      if (Period == 0)
+        continue; // free-running
+
+      Deadline += Period;
+      uint64_t Now = FGMonotonicNs();
+      if (Deadline < Now) {
+        // Missed one or more slots: skip them rather than bursting to catch up
+        Overruns.fetch_add(1, std::memory_order_relaxed);
+        Deadline = Now;
+        continue;
+      }
+      FGSleepUntilNs(Deadline);
+    }
+    Running.store(false);
+  };
+
+public:
+  FGPeriodicTask()
+      : StopRequested(false), Running(false), PeriodNs(0), Overruns(0) {};
+  FGPeriodicTask(const FGPeriodicTask &) = delete;
+  ~FGPeriodicTask() { Stop(); };
+
+  // RateHz <= 0 runs the body back to back.
+  bool Start(double RateHz, Body Fn) {
+    if (Running.load())
+      return false;
+    if (Worker.joinable())
+      Worker.join(); // finished on its own, reap it before restarting
+
+    SetRate(RateHz);
+    Overruns.store(0);
+    StopRequested.store(false);
+    Running.store(true);
+    Worker = std::thread(&FGPeriodicTask::Loop, this, Fn);
+    return true;
+  };
+
+  void Stop() {
+    StopRequested.store(true);
+    if (Worker.joinable() && Worker.get_id() != std::this_thread::get_id())
+      Worker.join();
+  };
+
+  void SetRate(double RateHz) {
+    PeriodNs.store(RateHz > 0 ? (uint64_t)(1e9 / RateHz) : 0);
+  };
+  void SetPeriodNs(uint64_t Period) { PeriodNs.store(Period); };
+
+  bool IsRunning() const { return Running.load(); };
+  bool IsWorkerThread() const {
+    return Worker.get_id() == std::this_thread::get_id();
+  };
+  uint64_t GetPeriodNs() const { return PeriodNs.load(); };
+  uint64_t GetOverruns() const { return Overruns.load(); };
+};
+
+#endif /* SOURCE_PERIODICTASK_H_ */
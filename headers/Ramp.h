@@ -0,0 +1,74 @@
+/*
+ * Ramp.h
+ *
+ * Setpoint profile for timed voltage/current ramps: a list of (time,
+ * voltage, current) points, interpolated linearly between neighbours. A NaN
+ * channel value leaves that channel untouched over the segments adjoining
+ * the point.
+ */
+
+#ifndef SOURCE_RAMP_H_
+#define SOURCE_RAMP_H_
+
+#include <algorithm>
+#include <cmath>
+#include <vector>
+
+struct FGRampPoint {
+  double TimeS;   // seconds from the start of the ramp
+  double Voltage; // NaN: leave the voltage as it is
+  double Current; // NaN: leave the current as it is
+};
+
+class FGRampProfile {
+  std::vector<FGRampPoint> Points;
+
+  static double Interpolate(double A, double B, double F) {
+    if (std::isnan(A) || std::isnan(B))
+      return NAN;
+    return A + (B - A) * F;
+  };
+
+public:
+  // Times must be finite and non-decreasing; false otherwise.
+  bool Assign(const std::vector<FGRampPoint> &P) {
+    for (size_t i = 0; i < P.size(); ++i) {
+      if (!std::isfinite(P[i].TimeS) || P[i].TimeS < 0)
+        return false;
+      if (i > 0 && P[i].TimeS < P[i - 1].TimeS)
+        return false;
+    }
+    Points = P;
+    return true;
+  };
+
+  bool Empty() const { return Points.empty(); };
+  size_t Size() const { return Points.size(); };
+  const std::vector<FGRampPoint> &GetPoints() const { return Points; };
+  double Duration() const { return Points.empty() ? 0 : Points.back().TimeS; };
+
+  // Setpoints at T seconds; before the first point they are NaN (nothing to
+  // program yet), after the last they hold the last point.
+  FGRampPoint At(double T) const {
+    FGRampPoint Out = {T, NAN, NAN};
+    if (Points.empty() || T < Points.front().TimeS)
+      return Out;
+    if (T >= Points.back().TimeS) {
+      Out.Voltage = Points.back().Voltage;
+      Out.Current = Points.back().Current;
+      return Out;
+    }
+    auto Hi = std::upper_bound(
+        Points.begin(), Points.end(), T,
+        [](double V, const FGRampPoint &P) { return V < P.TimeS; });
+    const FGRampPoint &B = *Hi;
+    const FGRampPoint &A = *(Hi - 1);
+    double Span = B.TimeS - A.TimeS;
+    double F = Span > 0 ? (T - A.TimeS) / Span : 1.0;
+    Out.Voltage = Interpolate(A.Voltage, B.Voltage, F);
+    Out.Current = Interpolate(A.Current, B.Current, F);
+    return Out;
+  };
+};
+
+#endif /* SOURCE_RAMP_H_ */
@@ -0,0 +1,360 @@
+/*
+ * Recording.h
+ *
+ * Compact binary recording of raw readouts for long runs.
+ *
+ * A file is one page-sized header followed by fixed-size FGRecordSample
+ * records. The header names the layout of a record, so files can be read
+ * without this code (e.g. with numpy.memmap), and carries the nominal
+ * scale factors to convert the monitor counts.
+ *
+ * FGRecorder never writes from the caller's thread. Push() copies into
+ * page-aligned chunks, and a writer thread writes each filled chunk with a
+ * single write(). Partial chunks are handed over at least once per flush
+ * interval, by Push() or, when no records arrive, by the writer, so a crash
+ * loses at most that much data; the record count is then derived from the
+ * file size.
+ *
+ * FGRecordingReader maps a file read-only for zero-copy access.
+ */
+
+#ifndef SOURCE_RECORDING_H_
+#define SOURCE_RECORDING_H_
+
+#include <atomic>
+#include <cerrno>
+#include <chrono>
+#include <condition_variable>
+#include <cstdlib>
+#include <cstring>
+#include <deque>
+#include <fcntl.h>
+#include <mutex>
+#include <stddef.h>
+#include <stdint.h>
+#include <string>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <thread>
+#include <unistd.h>
+#include <vector>
+
+#include "PeriodicTask.h" // FGMonotonicNs
+
+// One readout, 40 bytes
+struct FGRecordSample {
+  uint64_t timestamp_ns; // FGMonotonicNs() of the readout
+  uint16_t sequence_no;
+  uint16_t errors;
+  uint16_t daca; // DAC readback
+  uint16_t dacb;
+  int16_t adca[4];
+  uint16_t adcb[4];
+  uint8_t relay;
+  uint8_t flags; // reserved, 0
+  uint16_t reserved16;
+  uint32_t reserved32;
+};
+static_assert(sizeof(FGRecordSample) == 40, "record layout changed");
+
+const char FGRecordingMagic[8] = {'H', 'Z', 'R', 'E', 'C', 0, 0, 0};
+const uint32_t FGRecordingVersion = 1;
+const uint32_t FGRecordingHeaderSize = 4096;
+
+// "name@offset:type[xcount]" of each record field, NumPy type codes
+const char FGRecordingLayout[] =
+    "timestamp_ns@0:u8 sequence_no@8:u2 errors@10:u2 daca@12:u2 dacb@14:u2 "
+    "adca@16:i2x4 adcb@24:u2x4 relay@32:u1 flags@33:u1";
+
+struct FGRecordingHeader {
+  char Magic[8];
+  uint32_t Version;
+  uint32_t HeaderSize; // offset of the first record
+  uint32_t RecordSize;
+  uint32_t Reserved;
+  uint64_t RecordCount;  // written on close; 0 if the file was not closed
+  uint64_t StartNs;      // FGMonotonicNs() when recording started
+  int64_t StartUnixNs;   // wall clock at the same moment
+  double MaxVoltage;     // PSU full scale
+  double MaxCurrent;
+  double VoltsPerCount;  // ADCB[2] monitor scale
+  double AmpsPerCount;   // ADCB[3] monitor scale
+  char Layout[256];      // FGRecordingLayout
+  char Comment[256];     // free text given when recording started
+};
+static_assert(sizeof(FGRecordingHeader) <= FGRecordingHeaderSize,
+              "recording header does not fit its page");
+
+class FGRecorder {
+public:
+  static const size_t ChunkSize = 1 << 20; // multiple of the page size
+  static const size_t MaxChunks = 64;      // 64 MiB in flight at most
+
+private:
+  int Fd;
+  std::string Path;
+  uint64_t FlushNs;
+
+  std::mutex Lock;
+  std::condition_variable Wake;
+  std::vector<char *> Free;
+  std::deque<std::pair<char *, size_t>> Full;
+  size_t Allocated;
+  char *Active;
+  size_t Fill;
+  uint64_t ActiveSinceNs;
+  bool Closing;
+  std::thread Writer;
+
+  std::atomic<uint64_t> Records, Dropped, BytesWritten, WriteErrors;
+
+  char *TakeChunk() { // with Lock held
+    if (!Free.empty()) {
+      char *C = Free.back();
+      Free.pop_back();
+      return C;
+    }
+    if (Allocated >= MaxChunks)
+      return nullptr;
+    void *Mem = nullptr;
+    if (posix_memalign(&Mem, 4096, ChunkSize) != 0)
+      return nullptr;
+    Allocated++;
+    return static_cast<char *>(Mem);
+  };
+
+  void HandOver() { // with Lock held
+    if (Active == nullptr || Fill == 0)
+      return;
+    Full.push_back(std::make_pair(Active, Fill));
+    Active = nullptr;
+    Fill = 0;
+    Wake.notify_one();
+  };
+
+  bool WriteAll(const char *Data, size_t Size) {
+    while (Size > 0) {
+      ssize_t N = write(Fd, Data, Size);
+      if (N < 0) {
+        if (errno == EINTR)
+          continue;
+        return false;
+      }
+      Data += N;
+      Size -= (size_t)N;
+      BytesWritten.fetch_add((uint64_t)N, std::memory_order_relaxed);
+    }
+    return true;
+  };
+
+  void WriterLoop() {
+    // Wakes at least once per flush interval (at most 1 s), so a partial
+    // chunk goes out also when Push() is no longer called
+    std::chrono::nanoseconds Poll(FlushNs < 1000000000ull ? FlushNs
+                                                          : 1000000000ull);
+    if (Poll.count() <= 0)
+      Poll = std::chrono::milliseconds(1);
+    std::unique_lock<std::mutex> L(Lock);
+    for (;;) {
+      Wake.wait_for(L, Poll, [this]() { return Closing || !Full.empty(); });
+      if (Full.empty() && Closing)
+        return;
+      if (Full.empty()) {
+        if (Active != nullptr && FGMonotonicNs() - ActiveSinceNs >= FlushNs)
+          HandOver();
+        if (Full.empty())
+          continue;
+      }
+      std::pair<char *, size_t> Chunk = Full.front();
+      Full.pop_front();
+      L.unlock();
+      if (!WriteAll(Chunk.first, Chunk.second))
+        WriteErrors.fetch_add(1, std::memory_order_relaxed);
+      L.lock();
+      Free.push_back(Chunk.first);
+    }
+  };
+
+public:
+  FGRecorder()
+      : Fd(-1), FlushNs(0), Allocated(0), Active(nullptr), Fill(0),
+        ActiveSinceNs(0), Closing(false), Records(0), Dropped(0),
+        BytesWritten(0), WriteErrors(0) {};
+  FGRecorder(const FGRecorder &) = delete;
+  ~FGRecorder() { Close(); };
+
+  // Creates (truncates) the file and writes the header; the caller fills
+  // in the scale factors, StartNs and Comment of Header.
+  bool Open(const std::string &FilePath, FGRecordingHeader Header,
+            double FlushSeconds = 1.0) {
+    Close();
+    Fd = open(FilePath.c_str(), O_CREAT | O_TRUNC | O_WRONLY, 0644);
+    if (Fd < 0)
+      return false;
+    memcpy(Header.Magic, FGRecordingMagic, sizeof(Header.Magic));
+    Header.Version = FGRecordingVersion;
+    Header.HeaderSize = FGRecordingHeaderSize;
+    Header.RecordSize = sizeof(FGRecordSample);
+    Header.RecordCount = 0;
+    strncpy(Header.Layout, FGRecordingLayout, sizeof(Header.Layout) - 1);
+    Header.Layout[sizeof(Header.Layout) - 1] = 0;
+    Header.Comment[sizeof(Header.Comment) - 1] = 0;
+    std::vector<char> Page(FGRecordingHeaderSize, 0);
+    memcpy(Page.data(), &Header, sizeof(Header));
+    if (!WriteAll(Page.data(), Page.size())) {
+      close(Fd);
+      Fd = -1;
+      return false;
+    }
+    Path = FilePath;
+    FlushNs = (uint64_t)(FlushSeconds * 1e9);
+    Records = 0;
+    Dropped = 0;
+    WriteErrors = 0;
+    Closing = false;
+    Writer = std::thread(&FGRecorder::WriterLoop, this);
+    return true;
+  };
+
+  bool IsOpen() const { return Fd >= 0; };
+  const std::string &GetPath() const { return Path; };
+
+  // Never blocks on the disk; drops (and counts) the record if every chunk
+  // is still waiting to be written.
+  void Push(const FGRecordSample &R) {
+    std::lock_guard<std::mutex> L(Lock);
+    if (Fd < 0)
+      return;
+    const char *Src = reinterpret_cast<const char *>(&R);
+    size_t Left = sizeof(R);
+    if (Active == nullptr) {
+      Active = TakeChunk();
+      if (Active == nullptr) {
+        Dropped.fetch_add(1, std::memory_order_relaxed);
+        return;
+      }
+      ActiveSinceNs = R.timestamp_ns;
+    }
+    size_t Room = ChunkSize - Fill;
+    if (Room < Left) {
+      // The record straddles two chunks; make sure the second one exists
+      char *Next = TakeChunk();
+      if (Next == nullptr) {
+        Dropped.fetch_add(1, std::memory_order_relaxed);
+        return;
+      }
+      memcpy(Active + Fill, Src, Room);
+      Fill += Room;
+      HandOver();
+      Active = Next;
+      ActiveSinceNs = R.timestamp_ns;
+      Src += Room;
+      Left -= Room;
+    }
+    memcpy(Active + Fill, Src, Left);
+    Fill += Left;
+    Records.fetch_add(1, std::memory_order_relaxed);
+    if (Fill == ChunkSize || R.timestamp_ns - ActiveSinceNs >= FlushNs)
+      HandOver();
+  };
+
+  // Writes what is left, records the final count in the header and closes.
+  bool Close() {
+    if (Fd < 0)
+      return true;
+    {
+      std::lock_guard<std::mutex> L(Lock);
+      HandOver();
+      Closing = true;
+    }
+    Wake.notify_one();
+    if (Writer.joinable())
+      Writer.join();
+    bool Ok = WriteErrors.load() == 0;
+    // Bytes on disk decide the count, also if some writes failed
+    uint64_t Complete = BytesWritten.load() > FGRecordingHeaderSize
+                            ? (BytesWritten.load() - FGRecordingHeaderSize) /
+                                  sizeof(FGRecordSample)
+                            : 0;
+    Ok = pwrite(Fd, &Complete, sizeof(Complete),
+                offsetof(FGRecordingHeader, RecordCount)) ==
+             (ssize_t)sizeof(Complete) &&
+         Ok;
+    Ok = close(Fd) == 0 && Ok;
+    Fd = -1;
+    std::lock_guard<std::mutex> L(Lock);
+    for (char *C : Free)
+      free(C);
+    Free.clear();
+    Allocated = 0;
+    return Ok;
+  };
+
+  uint64_t GetRecords() const { return Records.load(); };
+  uint64_t GetDropped() const { return Dropped.load(); };
+  uint64_t GetBytesWritten() const { return BytesWritten.load(); };
+  uint64_t GetWriteErrors() const { return WriteErrors.load(); };
+};
+
+// Read-only mapping of a recording
+class FGRecordingReader {
+  void *Base;
+  size_t Size;
+  uint64_t Count;
+
+public:
+  FGRecordingReader() : Base(nullptr), Size(0), Count(0) {};
+  FGRecordingReader(const FGRecordingReader &) = delete;
+  ~FGRecordingReader() { Close(); };
+
+  // False if the file cannot be mapped or is not a recording of this layout.
+  bool Open(const std::string &Path) {
+    Close();
+    int Fd = open(Path.c_str(), O_RDONLY);
+    if (Fd < 0)
+      return false;
+    struct stat St;
+    void *Mem = MAP_FAILED;
+    if (fstat(Fd, &St) == 0 && (size_t)St.st_size >= FGRecordingHeaderSize)
+      Mem = mmap(nullptr, (size_t)St.st_size, PROT_READ, MAP_SHARED, Fd, 0);
+    close(Fd);
+    if (Mem == MAP_FAILED)
+      return false;
+    Base = Mem;
+    Size = (size_t)St.st_size;
+    const FGRecordingHeader &H = GetHeader();
+    if (memcmp(H.Magic, FGRecordingMagic, sizeof(H.Magic)) != 0 ||
+        H.Version != FGRecordingVersion ||
+        H.RecordSize != sizeof(FGRecordSample) ||
+        H.HeaderSize != FGRecordingHeaderSize) {
+      Close();
+      return false;
+    }
+    // A file that was not closed cleanly ends with whatever reached the disk
+    Count = (Size - H.HeaderSize) / H.RecordSize;
+    if (H.RecordCount != 0 && H.RecordCount < Count)
+      Count = H.RecordCount;
+    madvise(Base, Size, MADV_SEQUENTIAL);
+    return true;
+  };
+
+  void Close() {
+    if (Base != nullptr)
+      munmap(Base, Size);
+    Base = nullptr;
+    Size = 0;
+    Count = 0;
+  };
+
+  bool IsOpen() const { return Base != nullptr; };
+  const FGRecordingHeader &GetHeader() const {
+    return *static_cast<const FGRecordingHeader *>(Base);
+  };
+  uint64_t GetCount() const { return Count; };
+  const FGRecordSample *GetRecords() const {
+    return reinterpret_cast<const FGRecordSample *>(
+        static_cast<const char *>(Base) + FGRecordingHeaderSize);
+  };
+};
+
+#endif /* SOURCE_RECORDING_H_ */
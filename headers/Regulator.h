@@ -0,0 +1,79 @@
+/*
+ * Regulator.h
+ *
+ * PI controller for closed-loop regulation of a PSU output from its monitor
+ * readback. The open-loop setpoint is used as feed-forward, so with zero
+ * gains the command equals the setpoint and regulation only trims the
+ * remaining error. The integrator stops while the command is clipped by the
+ * output range, the trim bound around the setpoint or the rate limit
+ * (anti-windup).
+ */
+
+#ifndef SOURCE_REGULATOR_H_
+#define SOURCE_REGULATOR_H_
+
+#include <cmath>
+
+struct FGPIConfig {
+  bool Enabled;
+  double Kp;       // command change per unit of error
+  double Ki;       // command change per unit of error and second
+  double Deadband; // errors up to this size are treated as zero
+  double MaxRate;  // largest command change per second, <= 0: unlimited
+  double MaxTrim;  // largest |command - setpoint|, as a fraction of full
+                   // scale; <= 0: the whole output range
+
+  FGPIConfig()
+      : Enabled(false), Kp(0.2), Ki(20.0), Deadband(0.0), MaxRate(0.0),
+        MaxTrim(0.05) {};
+};
+
+class FGPIController {
+  double Integral; // accumulated error * seconds
+  double Output;
+
+public:
+  FGPIConfig Config;
+
+  FGPIController() : Integral(0), Output(0) {};
+
+  // Restarts from the given command with an empty integrator.
+  void Reset(double Command) {
+    Integral = 0;
+    Output = Command;
+  };
+  double GetOutput() const { return Output; };
+
+  // Next command for Target given the Measured output, Dt seconds after the
+  // previous update, clipped to [Min, Max] and to MaxTrim * Max around
+  // Target.
+  double Update(double Target, double Measured, double Dt, double Min,
+                double Max) {
+    if (Config.MaxTrim > 0) {
+      double Trim = Config.MaxTrim * Max;
+      if (Target - Trim > Min)
+        Min = Target - Trim;
+      if (Target + Trim < Max)
+        Max = Target + Trim;
+    }
+    double Error = Target - Measured;
+    if (std::fabs(Error) <= Config.Deadband)
+      Error = 0;
+    double Candidate =
+        Target + Config.Kp * Error + Config.Ki * (Integral + Error * Dt);
+    double Limited = Candidate < Min ? Min : (Candidate > Max ? Max : Candidate);
+    if (Config.MaxRate > 0) {
+      double Step = Config.MaxRate * Dt;
+      if (Limited > Output + Step)
+        Limited = Output + Step;
+      else if (Limited < Output - Step)
+        Limited = Output - Step;
+    }
+    if (Limited == Candidate)
+      Integral += Error * Dt;
+    Output = Limited;
+    return Output;
+  };
+};
+
+#endif /* SOURCE_REGULATOR_H_ */
@@ -0,0 +1,239 @@
+/*
+ * ReplayBoard.h
+ *
+ * Stand-in for the analog interface board that answers every command with
+ * the readouts of a recording (see Recording.h) instead of live hardware.
+ * Attached through FGAnalogPSUInterface::AttachBridge() like
+ * FGSimulatedBoard, so the whole decode, acquisition and control path runs
+ * unchanged on recorded data.
+ *
+ * With Speed > 0 the recording plays on a timeline that starts with the
+ * first response: a query gets the latest record due by then (records in
+ * between are skipped), and waits for the next one if it is faster than the
+ * recording. Speed 2 plays at twice the original rate. With Speed 0 every
+ * query gets the next record without waiting, as fast as the stack can go.
+ *
+ * Commands are validated and counted but not applied; the DAC and relay
+ * fields of the responses are the recorded ones. At the end of the
+ * recording the board either starts over or keeps answering with the last
+ * record.
+ */
+
+#ifndef SOURCE_REPLAYBOARD_H_
+#define SOURCE_REPLAYBOARD_H_
+
+#include "AnalogPSU.h"
+#include "PeriodicTask.h" // FGMonotonicNs, FGSleepUntilNs
+#include "Recording.h"
+#include <algorithm>
+#include <atomic>
+#include <cstring>
+#include <mutex>
+#include <stdint.h>
+#include <string>
+
+class FGReplayBoard {
+public:
+  typedef FGAnalogPSUInterface::Status_t Status_t;
+
+  struct Config {
+    double Speed; // playback rate relative to the recording, 0: unthrottled
+    bool Loop;    // start over at the end instead of holding the last record
+    Config() : Speed(1.0), Loop(false) {};
+  };
+
+  struct Counters {
+    std::atomic<uint64_t> Commands;
+    std::atomic<uint64_t> Setpoints; // commands with a SetMask, not applied
+    std::atomic<uint64_t> Rejected;  // commands failing magic or checksum
+    std::atomic<uint64_t> Replayed;  // responses sent
+    std::atomic<uint64_t> Skipped;   // records no query was fast enough for
+    std::atomic<uint64_t> Wraps;     // times the recording started over
+    Counters()
+        : Commands(0), Setpoints(0), Rejected(0), Replayed(0), Skipped(0),
+          Wraps(0) {};
+  };
+
+private:
+  FGRecordingReader Recording;
+  Config Cfg;
+  Counters Count;
+  std::mutex Lock;
+  uint64_t Next;      // index of the first record not yet answered
+  uint64_t Base;      // record the timeline started from
+  uint64_t OriginNs;  // FGMonotonicNs() at which record Base was due
+  bool Started;       // the timeline is running
+  bool Pending;       // a command is waiting for its response
+  bool Finished;      // reached the end without Loop
+
+  // FGMonotonicNs() at which record I is due on the current timeline
+  uint64_t DueNs(uint64_t I) const {
+    const FGRecordSample *R = Recording.GetRecords();
+    double Offset = (double)(R[I].timestamp_ns - R[Base].timestamp_ns);
+    return OriginNs + (uint64_t)(Offset / Cfg.Speed);
+  };
+
+  // Picks the record for a response due now (with Lock held); sets Until
+  // to the time the response may be delivered.
+  uint64_t Choose(uint64_t Now, uint64_t &Until) {
+    uint64_t N = Recording.GetCount();
+    Until = Now;
+    if (Next >= N) {
+      if (!Cfg.Loop) {
+        Finished = true;
+        return N - 1;
+      }
+      Count.Wraps.fetch_add(1, std::memory_order_relaxed);
+      Next = 0;
+      Started = false;
+    }
+    if (!Started) {
+      Base = Next;
+      OriginNs = Now;
+      Started = true;
+    }
+    if (Cfg.Speed <= 0)
+      return Next++;
+    uint64_t Due = DueNs(Next);
+    if (Due >= Now) {
+      Until = Due;
+      return Next++;
+    }
+    // Behind the recording: jump to the latest record that is due
+    const FGRecordSample *R = Recording.GetRecords();
+    uint64_t Elapsed = (uint64_t)((Now - OriginNs) * Cfg.Speed);
+    uint64_t Target = R[Base].timestamp_ns + Elapsed;
+    const FGRecordSample *It = std::upper_bound(
+        R + Next, R + N, Target,
+        [](uint64_t T, const FGRecordSample &S) { return T < S.timestamp_ns; });
+    uint64_t Latest = std::max<uint64_t>((uint64_t)(It - R), Next + 1) - 1;
+    Count.Skipped.fetch_add(Latest - Next, std::memory_order_relaxed);
+    Next = Latest + 1;
+    return Latest;
+  };
+
+  static void Encode(const FGRecordSample &R, Status_t &S) {
+    memset(&S, 0, sizeof(S));
+    S.MagicNo = FGAnalogPSUInterface::ExpectedMagic;
+    S.SequenceNo = R.sequence_no;
+    S.Response = (int16_t)R.errors;
+    for (int i = 0; i < 4; ++i) {
+      S.ADCA[i] = R.adca[i];
+      S.ADCB[i] = R.adcb[i];
+    }
+    S.DACA = R.daca;
+    S.DACB = R.dacb;
+    S.Relay = R.relay;
+    S.Checksum = S.ComputeChecksum();
+  };
+
+public:
+  FGReplayBoard(const Config &C = Config())
+      : Cfg(C), Next(0), Base(0), OriginNs(0), Started(false), Pending(false),
+        Finished(false) {};
+  FGReplayBoard(const FGReplayBoard &) = delete;
+
+  // False if Path is not a recording or holds no records.
+  bool Open(const std::string &Path) {
+    std::lock_guard<std::mutex> Guard(Lock);
+    if (!Recording.Open(Path))
+      return false;
+    if (Recording.GetCount() == 0) {
+      Recording.Close();
+      return false;
+    }
+    Next = 0;
+    Started = Pending = Finished = false;
+    return true;
+  };
+  bool IsOpen() const { return Recording.IsOpen(); };
+
+  void Configure(const Config &C) {
+    std::lock_guard<std::mutex> Guard(Lock);
+    Cfg = C;
+    Started = false; // the timeline restarts from the current record
+  };
+  // Starts over from the first record.
+  void Rewind() {
+    std::lock_guard<std::mutex> Guard(Lock);
+    Next = 0;
+    Started = Finished = false;
+  };
+
+  const Counters &GetCounters() const { return Count; };
+  const FGRecordingHeader &GetHeader() const { return Recording.GetHeader(); };
+  uint64_t GetCount() const { return Recording.GetCount(); };
+  uint64_t GetPosition() {
+    std::lock_guard<std::mutex> Guard(Lock);
+    return Next;
+  };
+  bool IsFinished() {
+    std::lock_guard<std::mutex> Guard(Lock);
+    return Finished;
+  };
+  // Seconds of recording between the first and the last record
+  double GetDuration() const {
+    uint64_t N = Recording.GetCount();
+    if (N < 2)
+      return 0;
+    const FGRecordSample *R = Recording.GetRecords();
+    return (R[N - 1].timestamp_ns - R[0].timestamp_ns) * 1e-9;
+  };
+
+  bool Write(unsigned char /*Endpoint*/, unsigned char *Buffer,
+             unsigned int Length) {
+    std::lock_guard<std::mutex> Guard(Lock);
+    if (Length != sizeof(Status_t) || !Recording.IsOpen())
+      return false;
+    Status_t Cmd;
+    memcpy(&Cmd, Buffer, sizeof(Cmd));
+    Count.Commands.fetch_add(1, std::memory_order_relaxed);
+    if (Cmd.MagicNo != FGAnalogPSUInterface::ExpectedMagic ||
+        Cmd.ComputeChecksum() != 0) {
+      Count.Rejected.fetch_add(1, std::memory_order_relaxed);
+      return true; // ignored, as by the board
+    }
+    if (Cmd.SetMask != 0)
+      Count.Setpoints.fetch_add(1, std::memory_order_relaxed);
+    Pending = true;
+    return true;
+  };
+
+  bool Read(unsigned char /*Endpoint*/, unsigned char *Buffer,
+            unsigned int Length) {
+    Status_t Response;
+    uint64_t Now = FGMonotonicNs(), Until;
+    {
+      std::lock_guard<std::mutex> Guard(Lock);
+      if (!Pending || !Recording.IsOpen())
+        return false; // nothing to answer, as if the transfer timed out
+      Pending = false;
+      Encode(Recording.GetRecords()[Choose(Now, Until)], Response);
+    }
+    if (Until > Now) // no sleep syscall when unthrottled or behind
+      FGSleepUntilNs(Until);
+    Count.Replayed.fetch_add(1, std::memory_order_relaxed);
+    memcpy(Buffer, &Response,
+           Length < sizeof(Response) ? Length : sizeof(Response));
+    return Length <= sizeof(Response);
+  };
+
+  // BulkBridgeCallback-compatible entry points
+  static bool WriteCallback(void *Board, unsigned char Endpoint,
+                            unsigned char *Buffer, unsigned int Length) {
+    return static_cast<FGReplayBoard *>(Board)->Write(Endpoint, Buffer,
+                                                      Length);
+  };
+  static bool ReadCallback(void *Board, unsigned char Endpoint,
+                           unsigned char *Buffer, unsigned int Length) {
+    return static_cast<FGReplayBoard *>(Board)->Read(Endpoint, Buffer,
+                                                     Length);
+  };
+
+  FGBulkBridge MakeBridge() {
+    return FGBulkBridge(this, &FGReplayBoard::WriteCallback,
+                        &FGReplayBoard::ReadCallback);
+  };
+};
+
+#endif /* SOURCE_REPLAYBOARD_H_ */
@@ -0,0 +1,89 @@
+/*
+ * SeqLock.h
+ *
+ * Single-writer / many-reader sequence lock for small POD values.
+ *
+ * The writer never blocks and readers never block the writer: a reader
+ * simply retries if it observed a write in progress. The payload is kept in
+ * relaxed atomic words, so concurrent access is race-free without a mutex.
+ */
+
+#ifndef SOURCE_SEQLOCK_H_
+#define SOURCE_SEQLOCK_H_
+
+#include <atomic>
+#include <cstring>
+#include <stdint.h>
+#include <type_traits>
+
+template <class T> class FGSeqLock {
+  static_assert(std::is_trivially_copyable<T>::value,
+                "FGSeqLock payload must be trivially copyable");
+
+  static const size_t WordCount = (sizeof(T) + 7) / 8;
+
+  std::atomic<uint32_t> Sequence;
+  std::atomic<uint64_t> Words[WordCount];
+
+public:
+  FGSeqLock() : Sequence(0) {
+    for (size_t i = 0; i < WordCount; ++i)
+      Words[i].store(0, std::memory_order_relaxed);
+  };
+  FGSeqLock(const FGSeqLock &) = delete;
+
+  // Must only ever be called from one thread at a time.
+  void Store(const T &Value) {
+    uint64_t Temp[WordCount] = {0};
+    memcpy(Temp, &Value, sizeof(T));
+
+    uint32_t Seq = Sequence.load(std::memory_order_relaxed);
+    Sequence.store(Seq + 1, std::memory_order_relaxed); // odd: write ongoing
+    std::atomic_thread_fence(std::memory_order_release);
+    for (size_t i = 0; i < WordCount; ++i)
+      Words[i].store(Temp[i], std::memory_order_relaxed);
+    Sequence.store(Seq + 2, std::memory_order_release);
+  };
+
+  T Load() const {
+    uint64_t Temp[WordCount];
+    uint32_t Before, After;
+    do {
+      Before = Sequence.load(std::memory_order_acquire);
+      for (size_t i = 0; i < WordCount; ++i)
+        Temp[i] = Words[i].load(std::memory_order_relaxed);
+      std::atomic_thread_fence(std::memory_order_acquire);
+      After = Sequence.load(std::memory_order_relaxed);
+    } while ((Before & 1) || Before != After);
+
+    T Value;
+    memcpy(&Value, Temp, sizeof(T));
+    return Value;
+  };
+
+  // Like Load(), but gives up after the given number of attempts, for
+  // readers that must not spin on a writer that died mid-store (e.g. one in
+  // another process).
+  bool TryLoad(T &Value, int Attempts) const {
+    uint64_t Temp[WordCount];
+    for (int a = 0; a < Attempts; ++a) {
+      uint32_t Before = Sequence.load(std::memory_order_acquire);
+      for (size_t i = 0; i < WordCount; ++i)
+        Temp[i] = Words[i].load(std::memory_order_relaxed);
+      std::atomic_thread_fence(std::memory_order_acquire);
+      uint32_t After = Sequence.load(std::memory_order_relaxed);
+      if (!(Before & 1) && Before == After) {
+        memcpy(&Value, Temp, sizeof(T));
+        return true;
+      }
+    }
+    return false;
+  };
+
+  // Number of completed stores, handy to detect fresh data.
+  uint32_t Version() const {
+    return Sequence.load(std::memory_order_acquire) / 2;
+  };
+};
+
+#endif /* SOURCE_SEQLOCK_H_ */
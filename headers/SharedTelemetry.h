@@ -0,0 +1,252 @@
+/*
+ * SharedTelemetry.h
+ *
+ * Publication of the latest decoded snapshot and of a ring of raw samples in
+ * a POSIX shared-memory segment, so that any number of local processes can
+ * read telemetry while a single process owns the USB interface.
+ *
+ * The segment starts with a fixed header (magic, layout version, record
+ * sizes), followed by the latest snapshot behind a seqlock and by the ring
+ * with one seqlock per slot. The owner is the only writer; readers map the
+ * segment read-only and never block it. Timestamps are FGMonotonicNs(),
+ * i.e. CLOCK_MONOTONIC, which is comparable across processes.
+ */
+
+#ifndef SOURCE_SHAREDTELEMETRY_H_
+#define SOURCE_SHAREDTELEMETRY_H_
+
+#include "CaptureRing.h"  // FGCaptureSample
+#include "PeriodicTask.h" // FGMonotonicNs
+#include "SeqLock.h"
+#include <algorithm>
+#include <atomic>
+#include <cerrno>
+#include <fcntl.h>
+#include <new>
+#include <signal.h>
+#include <stdint.h>
+#include <string>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include <vector>
+
+const uint32_t FGTelemetryMagic = 0x4D53485A; // "ZHSM"
+const uint32_t FGTelemetryVersion = 1;
+
+template <class Snapshot> struct FGTelemetryHeader {
+  std::atomic<uint32_t> Magic; // written last by the owner
+  uint32_t Version;
+  uint32_t SnapshotSize;
+  uint32_t SampleSize;
+  uint64_t Capacity; // ring slots
+  int32_t WriterPid;
+  std::atomic<uint64_t> Published;   // snapshots published so far
+  std::atomic<uint64_t> Count;       // samples pushed into the ring so far
+  std::atomic<uint64_t> HeartbeatNs; // FGMonotonicNs() of the last publish
+  FGSeqLock<Snapshot> Latest;
+};
+
+template <class Snapshot> class FGTelemetrySegment {
+protected:
+  typedef FGTelemetryHeader<Snapshot> Header;
+  typedef FGSeqLock<FGCaptureSample> Slot;
+
+  void *Base;
+  size_t Size;
+
+  static size_t RingOffset() { return (sizeof(Header) + 63) & ~(size_t)63; };
+  static size_t SizeFor(uint64_t Capacity) {
+    return RingOffset() + Capacity * sizeof(Slot);
+  };
+  Header *Head() const { return static_cast<Header *>(Base); };
+  Slot *Ring() const {
+    return reinterpret_cast<Slot *>(static_cast<char *>(Base) + RingOffset());
+  };
+  void Unmap() {
+    if (Base != nullptr)
+      munmap(Base, Size);
+    Base = nullptr;
+    Size = 0;
+  };
+
+  FGTelemetrySegment() : Base(nullptr), Size(0) {};
+  ~FGTelemetrySegment() { Unmap(); };
+
+public:
+  FGTelemetrySegment(const FGTelemetrySegment &) = delete;
+  bool IsOpen() const { return Base != nullptr; };
+  uint64_t Capacity() const { return Base ? Head()->Capacity : 0; };
+};
+
+// Owner side: creates the segment (replacing a stale one of the same name)
+// and removes it again on Close().
+template <class Snapshot>
+class FGTelemetryPublisher : public FGTelemetrySegment<Snapshot> {
+  typedef FGTelemetrySegment<Snapshot> Segment;
+  std::string Name;
+
+public:
+  FGTelemetryPublisher() {};
+  ~FGTelemetryPublisher() { Close(); };
+
+  // Name as for shm_open(), e.g. "/heinzinger0".
+  bool Create(const std::string &SegmentName, uint64_t Capacity) {
+    Close();
+    if (Capacity == 0)
+      return false;
+    shm_unlink(SegmentName.c_str());
+    int Fd = shm_open(SegmentName.c_str(), O_CREAT | O_EXCL | O_RDWR, 0644);
+    if (Fd < 0)
+      return false;
+    size_t Bytes = Segment::SizeFor(Capacity);
+    void *Mem = MAP_FAILED;
+    if (ftruncate(Fd, (off_t)Bytes) == 0)
+      Mem = mmap(nullptr, Bytes, PROT_READ | PROT_WRITE, MAP_SHARED, Fd, 0);
+    close(Fd);
+    if (Mem == MAP_FAILED) {
+      shm_unlink(SegmentName.c_str());
+      return false;
+    }
+    this->Base = Mem;
+    this->Size = Bytes;
+    Name = SegmentName;
+
+    typename Segment::Header *H = new (Mem) typename Segment::Header();
+    H->Version = FGTelemetryVersion;
+    H->SnapshotSize = sizeof(Snapshot);
+    H->SampleSize = sizeof(FGCaptureSample);
+    H->Capacity = Capacity;
+    H->WriterPid = (int32_t)getpid();
+    H->Published.store(0);
+    H->Count.store(0);
+    H->HeartbeatNs.store(FGMonotonicNs());
+    typename Segment::Slot *R = this->Ring();
+    for (uint64_t i = 0; i < Capacity; ++i)
+      new (&R[i]) typename Segment::Slot();
+    H->Magic.store(FGTelemetryMagic, std::memory_order_release);
+    return true;
+  };
+
+  void Close() {
+    if (!this->IsOpen())
+      return;
+    this->Head()->Magic.store(0, std::memory_order_release);
+    this->Unmap();
+    shm_unlink(Name.c_str());
+    Name.clear();
+  };
+
+  const std::string &GetName() const { return Name; };
+
+  void Publish(const Snapshot &S) {
+    typename Segment::Header *H = this->Head();
+    H->Latest.Store(S);
+    H->Published.fetch_add(1, std::memory_order_release);
+    H->HeartbeatNs.store(FGMonotonicNs(), std::memory_order_relaxed);
+  };
+
+  void Push(const FGCaptureSample &Sample) {
+    typename Segment::Header *H = this->Head();
+    uint64_t N = H->Count.load(std::memory_order_relaxed);
+    this->Ring()[N % H->Capacity].Store(Sample);
+    H->Count.store(N + 1, std::memory_order_release);
+  };
+};
+
+// Read-only client; attaches to a segment created by another process (or
+// this one) and never writes to it.
+template <class Snapshot>
+class FGTelemetryReader : public FGTelemetrySegment<Snapshot> {
+  typedef FGTelemetrySegment<Snapshot> Segment;
+  static const int LoadAttempts = 1000;
+
+public:
+  FGTelemetryReader() {};
+
+  // False if the segment does not exist or has a different layout.
+  bool Attach(const std::string &Name) {
+    this->Unmap();
+    int Fd = shm_open(Name.c_str(), O_RDONLY, 0);
+    if (Fd < 0)
+      return false;
+    struct stat St;
+    void *Mem = MAP_FAILED;
+    if (fstat(Fd, &St) == 0 &&
+        (size_t)St.st_size >= sizeof(typename Segment::Header))
+      Mem = mmap(nullptr, (size_t)St.st_size, PROT_READ, MAP_SHARED, Fd, 0);
+    close(Fd);
+    if (Mem == MAP_FAILED)
+      return false;
+    this->Base = Mem;
+    this->Size = (size_t)St.st_size;
+    const typename Segment::Header *H = this->Head();
+    if (H->Magic.load(std::memory_order_acquire) != FGTelemetryMagic ||
+        H->Version != FGTelemetryVersion ||
+        H->SnapshotSize != sizeof(Snapshot) ||
+        H->SampleSize != sizeof(FGCaptureSample) ||
+        Segment::SizeFor(H->Capacity) > this->Size) {
+      this->Unmap();
+      return false;
+    }
+    return true;
+  };
+  void Detach() { this->Unmap(); };
+
+  // False while nothing was published yet, or if the writer died mid-store.
+  bool Latest(Snapshot &Out) const {
+    const typename Segment::Header *H = this->Head();
+    if (H->Published.load(std::memory_order_acquire) == 0)
+      return false;
+    return H->Latest.TryLoad(Out, LoadAttempts);
+  };
+
+  uint64_t Published() const {
+    return this->Head()->Published.load(std::memory_order_acquire);
+  };
+  uint64_t Count() const {
+    return this->Head()->Count.load(std::memory_order_acquire);
+  };
+  uint64_t HeartbeatAgeNs() const {
+    uint64_t Beat = this->Head()->HeartbeatNs.load(std::memory_order_relaxed);
+    uint64_t Now = FGMonotonicNs();
+    return Now > Beat ? Now - Beat : 0;
+  };
+  // The writer still exists and has not closed the segment.
+  bool WriterAlive() const {
+    const typename Segment::Header *H = this->Head();
+    return H->Magic.load(std::memory_order_acquire) == FGTelemetryMagic &&
+           (kill(H->WriterPid, 0) == 0 || errno == EPERM);
+  };
+
+  // Appends the ring samples with index >= Since (counted from the first
+  // sample ever pushed) that are still held by the ring, oldest first, and
+  // returns the index to pass as Since next time.
+  uint64_t Read(uint64_t Since, std::vector<FGCaptureSample> &Out) const {
+    const typename Segment::Header *H = this->Head();
+    uint64_t Cap = H->Capacity;
+    uint64_t End = Count();
+    uint64_t Begin = End > Cap ? End - Cap : 0;
+    if (Since > Begin)
+      Begin = Since;
+    size_t First = Out.size();
+    for (uint64_t i = Begin; i < End; ++i) {
+      FGCaptureSample S;
+      if (!this->Ring()[i % Cap].TryLoad(S, LoadAttempts))
+        break;
+      Out.push_back(S);
+    }
+    // Slots the writer may have started to overwrite while we copied: with
+    // the count now at After, every index up to After - Cap is suspect.
+    uint64_t After = Count();
+    uint64_t Valid = After + 1 > Cap ? After + 1 - Cap : 0;
+    if (Valid > Begin) {
+      size_t Drop = (size_t)std::min<uint64_t>(Valid - Begin, Out.size() - First);
+      Out.erase(Out.begin() + First, Out.begin() + First + Drop);
+      Begin += Drop;
+    }
+    return Begin + (Out.size() - First);
+  };
+};
+
+#endif /* SOURCE_SHAREDTELEMETRY_H_ */
@@ -0,0 +1,201 @@
+/*
+ * SimulatedBoard.h
+ *
+ * Software stand-in for the analog interface board, speaking the Status_t
+ * protocol in place of libusb_bulk_transfer(). Used by the benchmark (and
+ * anything else that has to run without hardware) via
+ * FGAnalogPSUInterface::AttachTransfers(), so that the transfer policies,
+ * retries and statistics of FGUSBBulk are exercised as with a real board.
+ *
+ * The board answers each command with its DAC/relay state and monitor ADC
+ * readings that follow the DACs (zero while the relay is open). Response
+ * latency, jitter, lost responses, corrupted responses and a reported error
+ * word are configurable; a lost response makes every read attempt time out,
+ * a late one only those that give up before it arrives.
+ */
+
+#ifndef SOURCE_SIMULATEDBOARD_H_
+#define SOURCE_SIMULATEDBOARD_H_
+
+#include "AnalogPSU.h"
+#include "Calibration.h" // nominal analog chain constants
+#include "PeriodicTask.h" // FGMonotonicNs, FGSleepUntilNs
+#include <atomic>
+#include <cstring>
+#include <mutex>
+#include <random>
+#include <stdint.h>
+
+class FGSimulatedBoard {
+public:
+  typedef FGAnalogPSUInterface::Status_t Status_t;
+
+  struct Config {
+    double LatencyUs;     // mean command-to-response time
+    double JitterUs;      // standard deviation around LatencyUs
+    double DropRate;      // fraction of responses that never arrive
+    double CorruptRate;   // fraction of responses with one bit flipped
+    double DropTimeoutUs; // how long a lost response blocks the reader
+    uint16_t ErrorWord;   // device error word of every response (a fault)
+    uint32_t Seed;
+    Config()
+        : LatencyUs(100.0), JitterUs(20.0), DropRate(0.0), CorruptRate(0.0),
+          DropTimeoutUs(1000.0), ErrorWord(0), Seed(1) {};
+  };
+
+  struct Counters {
+    std::atomic<uint64_t> Commands;
+    std::atomic<uint64_t> Dropped;
+    std::atomic<uint64_t> Corrupted;
+    std::atomic<uint64_t> Rejected; // commands failing magic or checksum
+    Counters() : Commands(0), Dropped(0), Corrupted(0), Rejected(0) {};
+  };
+
+private:
+  Config Cfg;
+  Counters Count;
+  std::mutex Lock;
+  std::mt19937 Random;
+  Status_t State; // last response, without per-exchange corruption
+  bool Pending;   // a response is waiting to be read
+  bool PendingDropped, PendingCorrupted;
+  uint64_t ReadyNs;
+
+  // Monitor ADC count for a DAC register, through the same analog chain the
+  // nominal FGPSUCalibration assumes.
+  static uint16_t MonitorCounts(uint16_t Dac) {
+    double Volts = FGBoardMaxVolt * Dac / UINT16_MAX;
+    double Counts = Volts / FGADCInputScale * UINT16_MAX;
+    return Counts > UINT16_MAX ? UINT16_MAX : (uint16_t)Counts;
+  };
+
+  void Execute(const Status_t &Cmd) {
+    if (Cmd.SetMask & FGAnalogPSUInterface::MaskDACA)
+      State.DACA = Cmd.DACA;
+    if (Cmd.SetMask & FGAnalogPSUInterface::MaskDACB)
+      State.DACB = Cmd.DACB;
+    if (Cmd.SetMask & FGAnalogPSUInterface::MaskRelay)
+      State.Relay = Cmd.Relay;
+    State.SequenceNo++;
+    State.Response = (int16_t)Cfg.ErrorWord;
+    State.SetMask = 0;
+    for (int i = 0; i < 4; ++i)
+      State.ADCA[i] = 0;
+    State.ADCB[0] = State.ADCB[1] = 0;
+    State.ADCB[2] = State.Relay ? MonitorCounts(State.DACA) : 0;
+    State.ADCB[3] = State.Relay ? MonitorCounts(State.DACB) : 0;
+    State.Checksum = 0;
+    State.Checksum = State.ComputeChecksum();
+  };
+
+  bool Chance(double Rate) {
+    return Rate > 0 &&
+           std::uniform_real_distribution<double>(0, 1)(Random) < Rate;
+  };
+
+public:
+  FGSimulatedBoard(const Config &C = Config()) : Cfg(C), Random(C.Seed) {
+    memset(&State, 0, sizeof(State));
+    State.MagicNo = FGAnalogPSUInterface::ExpectedMagic;
+    Pending = PendingDropped = PendingCorrupted = false;
+    ReadyNs = 0;
+  };
+  FGSimulatedBoard(const FGSimulatedBoard &) = delete;
+
+  void Configure(const Config &C) {
+    std::lock_guard<std::mutex> Guard(Lock);
+    Cfg = C;
+  };
+  const Counters &GetCounters() const { return Count; };
+
+  // Accepts one command; a malformed one is swallowed like the board does.
+  // Returns the bytes taken (all of them) or a libusb error code.
+  int Write(const unsigned char *Buffer, int Length) {
+    std::lock_guard<std::mutex> Guard(Lock);
+    if (Length != (int)sizeof(Status_t))
+      return LIBUSB_ERROR_INVALID_PARAM;
+    Status_t Cmd;
+    memcpy(&Cmd, Buffer, sizeof(Cmd));
+    Count.Commands.fetch_add(1, std::memory_order_relaxed);
+    if (Cmd.MagicNo != FGAnalogPSUInterface::ExpectedMagic ||
+        Cmd.ComputeChecksum() != 0) {
+      Count.Rejected.fetch_add(1, std::memory_order_relaxed);
+      return Length; // the board silently ignores malformed commands
+    }
+    Execute(Cmd);
+
+    double Delay = Cfg.LatencyUs;
+    if (Cfg.JitterUs > 0)
+      Delay += std::normal_distribution<double>(0, Cfg.JitterUs)(Random);
+    ReadyNs = FGMonotonicNs() + (uint64_t)(Delay > 0 ? Delay * 1e3 : 0);
+    Pending = true;
+    PendingDropped = Chance(Cfg.DropRate);
+    PendingCorrupted = !PendingDropped && Chance(Cfg.CorruptRate);
+    return Length;
+  };
+
+  // Waits for the pending response, at most TimeoutMs (0: no limit).
+  // Returns the bytes delivered or LIBUSB_ERROR_TIMEOUT; a response that is
+  // merely late stays pending for the next attempt, a lost one never comes.
+  int Read(unsigned char *Buffer, int Length, unsigned int TimeoutMs) {
+    uint64_t Now = FGMonotonicNs();
+    uint64_t Limit = TimeoutMs ? Now + (uint64_t)TimeoutMs * 1000000 : 0;
+    uint64_t Until;
+    bool Arrives, Corrupted = false;
+    Status_t Response;
+    {
+      std::lock_guard<std::mutex> Guard(Lock);
+      if (!Pending || PendingDropped) {
+        if (Pending)
+          Count.Dropped.fetch_add(1, std::memory_order_relaxed);
+        Pending = false;
+        Until = Now + (uint64_t)(Cfg.DropTimeoutUs * 1e3);
+        Arrives = false;
+      } else {
+        Until = ReadyNs;
+        Arrives = true;
+      }
+      if (Limit != 0 && Until > Limit) {
+        Until = Limit; // late: times out, the response stays pending
+        Arrives = false;
+      } else if (Arrives) {
+        Pending = false;
+        Corrupted = PendingCorrupted;
+        Response = State;
+        if (Corrupted) {
+          size_t Bit = Random() % (8 * sizeof(Response));
+          ((uint8_t *)&Response)[Bit / 8] ^= (uint8_t)(1u << (Bit % 8));
+        }
+      }
+    }
+    FGSleepUntilNs(Until);
+    if (!Arrives)
+      return LIBUSB_ERROR_TIMEOUT;
+    if (Corrupted)
+      Count.Corrupted.fetch_add(1, std::memory_order_relaxed);
+    if (Length < (int)sizeof(Response))
+      return LIBUSB_ERROR_OVERFLOW;
+    memcpy(Buffer, &Response, sizeof(Response));
+    return (int)sizeof(Response);
+  };
+
+  // FGUSBTransferHook entry point: the direction bit picks the side
+  static int TransferCallback(void *Board, unsigned char Endpoint,
+                              unsigned char *Data, int Length, int *Actual,
+                              unsigned int TimeoutMs) {
+    FGSimulatedBoard *Self = static_cast<FGSimulatedBoard *>(Board);
+    int Result = (Endpoint & LIBUSB_ENDPOINT_IN)
+                     ? Self->Read(Data, Length, TimeoutMs)
+                     : Self->Write(Data, Length);
+    *Actual = Result > 0 ? Result : 0;
+    return Result > 0 ? 0 : Result;
+  };
+
+  // For FGAnalogPSUInterface::AttachTransfers(): the board stands in for
+  // libusb, below the retrying transfer prototypes.
+  FGUSBTransferHook MakeTransfers() {
+    return FGUSBTransferHook(this, &FGSimulatedBoard::TransferCallback);
+  };
+};
+
+#endif /* SOURCE_SIMULATEDBOARD_H_ */
@@ -0,0 +1,116 @@
+/*
+ * StatusCodec.h
+ *
+ * Encoding and decoding of the board's 32-byte Status_t frames directly in
+ * caller-owned buffers.
+ *
+ * All accesses go through memcpy of whole words, so frames may sit at any
+ * address (no casts of packed structs) and the compiler still emits plain
+ * 64-bit loads. The XOR checksum of the sixteen 16-bit words is folded from
+ * four 64-bit words; validation checks magic and checksum from the same
+ * loads. Everything after the checksum is laid out on the wire exactly as
+ * FGStatusFields, so a valid frame decodes with a single copy. Frames are
+ * little-endian, as is every host this runs on.
+ */
+
+#ifndef SOURCE_STATUSCODEC_H_
+#define SOURCE_STATUSCODEC_H_
+
+#include <cstring>
+#include <stddef.h>
+#include <stdint.h>
+
+const size_t FGStatusFrameSize = 32;
+const uint32_t FGStatusMagic = 0xA4A7051F;
+const size_t FGStatusChecksumOffset = 4;
+const size_t FGStatusFieldsOffset = 6;
+
+// Reusable, aligned frame buffer
+struct alignas(16) FGStatusFrame {
+  uint8_t Bytes[FGStatusFrameSize];
+};
+
+// Frame contents after magic and checksum, in wire order
+struct FGStatusFields {
+  uint16_t SequenceNo;
+  uint16_t Response; // device error word; 0xF00 is non-critical
+  int16_t ADCA[4];
+  uint16_t ADCB[4];  // [2] = voltage, [3] = current monitor
+  uint16_t DACA;
+  uint16_t DACB;
+  uint8_t Relay;
+  uint8_t SetMask;
+};
+static_assert(sizeof(FGStatusFields) ==
+                  FGStatusFrameSize - FGStatusFieldsOffset,
+              "FGStatusFields must mirror the frame");
+static_assert(offsetof(FGStatusFields, DACA) == 20 &&
+                  offsetof(FGStatusFields, Relay) == 24,
+              "FGStatusFields must mirror the frame");
+
+enum FGStatusVerdict { FGStatusValid, FGStatusBadMagic, FGStatusBadChecksum };
+
+// XOR of the sixteen 16-bit words of a frame
+inline uint16_t FGStatusXor(const uint8_t *Frame) {
+  uint64_t W[4];
+  memcpy(W, Frame, sizeof(W));
+  uint64_t X = W[0] ^ W[1] ^ W[2] ^ W[3];
+  X ^= X >> 32;
+  X ^= X >> 16;
+  return (uint16_t)X;
+}
+
+// Magic and checksum in one pass over the frame
+inline FGStatusVerdict FGCheckStatusFrame(const uint8_t *Frame) {
+  uint64_t W[4];
+  memcpy(W, Frame, sizeof(W));
+  if ((uint32_t)W[0] != FGStatusMagic)
+    return FGStatusBadMagic;
+  uint64_t X = W[0] ^ W[1] ^ W[2] ^ W[3];
+  X ^= X >> 32;
+  X ^= X >> 16;
+  return (uint16_t)X == 0xFFFF ? FGStatusValid : FGStatusBadChecksum;
+}
+
+// Verdicts for Count frames Stride bytes apart (e.g. a batch of transfers
+// or a capture); returns the number of valid ones.
+inline size_t FGCheckStatusFrames(const uint8_t *Frames, size_t Count,
+                                  size_t Stride, uint8_t *Verdicts) {
+  size_t Valid = 0;
+  for (size_t i = 0; i < Count; ++i) {
+    FGStatusVerdict V = FGCheckStatusFrame(Frames + i * Stride);
+    if (Verdicts != nullptr)
+      Verdicts[i] = (uint8_t)V;
+    Valid += V == FGStatusValid;
+  }
+  return Valid;
+}
+
+// Sets the checksum so that the frame's words XOR to 0xFFFF.
+inline void FGStampStatusChecksum(uint8_t *Frame) {
+  uint16_t Zero = 0;
+  memcpy(Frame + FGStatusChecksumOffset, &Zero, sizeof(Zero));
+  uint16_t Sum = (uint16_t)(0xFFFF ^ FGStatusXor(Frame));
+  memcpy(Frame + FGStatusChecksumOffset, &Sum, sizeof(Sum));
+}
+
+// Complete command frame: magic, the given setpoints and the checksum.
+inline void FGEncodeStatusCommand(uint8_t *Frame, uint8_t Mask, uint16_t A,
+                                  uint16_t B, uint8_t Relay) {
+  FGStatusFields F;
+  memset(&F, 0, sizeof(F));
+  F.DACA = A;
+  F.DACB = B;
+  F.Relay = Relay;
+  F.SetMask = Mask;
+  uint32_t Magic = FGStatusMagic;
+  memcpy(Frame, &Magic, sizeof(Magic));
+  memcpy(Frame + FGStatusFieldsOffset, &F, sizeof(F));
+  FGStampStatusChecksum(Frame);
+}
+
+inline void FGDecodeStatusFields(const uint8_t *Frame, FGStatusFields &Out) {
+  memcpy(&Out, Frame + FGStatusFieldsOffset, sizeof(Out));
+}
+
+#endif /* SOURCE_STATUSCODEC_H_ */
@@ -0,0 +1,112 @@
+/*
+ * Sweep.h
+ *
+ * Building blocks of set-settle-measure sweeps: the reduction of the
+ * samples taken at one point, and detection of a settled readback.
+ *
+ * A point may be reduced to the mean and standard deviation of its samples,
+ * or to their median with the scaled median absolute deviation as a spread
+ * that ignores occasional outliers. Settling is declared once the last
+ * Window readings lie within Tolerance of each other.
+ */
+
+#ifndef SOURCE_SWEEP_H_
+#define SOURCE_SWEEP_H_
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <string>
+#include <vector>
+
+enum class FGSweepReduce { Mean, Median };
+
+// False for names other than "mean" and "median"
+inline bool FGParseSweepReduce(const std::string &Name, FGSweepReduce &Out) {
+  if (Name == "mean")
+    Out = FGSweepReduce::Mean;
+  else if (Name == "median")
+    Out = FGSweepReduce::Median;
+  else
+    return false;
+  return true;
+}
+
+struct FGSweepConfig {
+  double SettleTime;       // seconds to wait after each step (the maximum
+                           // if settle detection is on)
+  unsigned SamplesPerPoint; // readouts combined into each result
+  FGSweepReduce Reduce;
+  double SampleHz;          // readouts per second, <= 0: as fast as possible
+  // Settle detection ends the wait early once the swept quantity's last
+  // SettleWindow readings lie within SettleTolerance; 0 turns it off.
+  double SettleTolerance;
+  unsigned SettleWindow;
+  bool SweepCurrent; // points are current instead of voltage setpoints
+
+  FGSweepConfig()
+      : SettleTime(5.0), SamplesPerPoint(10), Reduce(FGSweepReduce::Mean),
+        SampleHz(100.0), SettleTolerance(0.0), SettleWindow(10),
+        SweepCurrent(false) {};
+};
+
+// Center and spread of Samples (which is reordered); NaN for no samples.
+inline void FGSweepStats(std::vector<double> &Samples, FGSweepReduce Mode,
+                         double &Center, double &Spread) {
+  size_t N = Samples.size();
+  if (N == 0) {
+    Center = Spread = NAN;
+    return;
+  }
+  if (Mode == FGSweepReduce::Median) {
+    auto Median = [](std::vector<double> &V) {
+      size_t H = V.size() / 2;
+      std::nth_element(V.begin(), V.begin() + H, V.end());
+      double M = V[H];
+      if (V.size() % 2 == 0)
+        M = (M + *std::max_element(V.begin(), V.begin() + H)) / 2;
+      return M;
+    };
+    Center = Median(Samples);
+    for (double &S : Samples)
+      S = std::fabs(S - Center);
+    Spread = 1.4826 * Median(Samples); // MAD, scaled to sigma for a normal
+    return;
+  }
+  double Sum = 0;
+  for (double S : Samples)
+    Sum += S;
+  Center = Sum / N;
+  double Sq = 0;
+  for (double S : Samples)
+    Sq += (S - Center) * (S - Center);
+  Spread = N > 1 ? std::sqrt(Sq / (N - 1)) : 0.0;
+}
+
+// Sliding window over the most recent readings
+class FGSettleDetector {
+  std::vector<double> Window;
+  size_t Next, Filled;
+
+public:
+  FGSettleDetector() : Next(0), Filled(0) {};
+
+  void Reset(unsigned Size) {
+    Window.assign(Size > 0 ? Size : 1, 0.0);
+    Next = Filled = 0;
+  };
+
+  // Adds a reading; true once the window is full and within Tolerance.
+  bool Add(double Value, double Tolerance) {
+    Window[Next] = Value;
+    Next = (Next + 1) % Window.size();
+    if (Filled < Window.size())
+      Filled++;
+    if (Filled < Window.size())
+      return false;
+    auto Range = std::minmax_element(Window.begin(), Window.end());
+    return *Range.second - *Range.first <= Tolerance;
+  };
+};
+
+#endif /* SOURCE_SWEEP_H_ */
@@ -20,29 +20,12 @@ CPP_CLASS_NAME_IN_PYTHON = 'HeinzingerPSU' # Name given in py::class_<...>(m, "H
 # --- Global variable for PSU instance ---
 _psu_instance = None
 _module_loaded = False
+# Wall time of each startup phase in ms, see startup_report()
+_startup_ms = {}
 
-def setup_module_path_and_load():
-    """Adds the build directory to Python's path and tries to load the module."""
-    global _module_loaded
-
-    if not os.path.isdir(MODULE_BUILD_DIR):
-        print(f"ERROR: Build directory not found at {MODULE_BUILD_DIR}")
-        _module_loaded = False
-        return
-
-    sys.path.insert(0, MODULE_BUILD_DIR)
-    print(f"Added '{MODULE_BUILD_DIR}' to sys.path.")
-
-    so_file_path = os.path.join(MODULE_BUILD_DIR, MODULE_FILENAME)
-    if not os.path.exists(so_file_path):
-        print(f"ERROR: Module file not found at {so_file_path}")
-        print("Please ensure you've built the module correctly and it's in the build directory.")
-        _module_loaded = False
-        return
-    else:
-        print(f"Module file found at {so_file_path}")
-
-    # Optional: Check shared library dependencies using otool -L (macOS specific)
+def _check_library_dependencies(so_file_path):
+    """Prints the shared library dependencies of the module (otool -L, macOS).
+    Only run after a failed import: spawning otool on every load slows startup."""
     try:
         if sys.platform == 'darwin': # darwin is macOS
             result = subprocess.run(['otool', '-L', so_file_path], capture_output=True, text=True, check=True)
@@ -64,10 +47,35 @@ def setup_module_path_and_load():
     except Exception as e:
         print(f"WARNING: Could not check shared library dependencies: {e}")
 
+def setup_module_path_and_load():
+    """Adds the build directory to Python's path and tries to load the module."""
+    global _module_loaded
+    phase_start = time.perf_counter()
+
+    if not os.path.isdir(MODULE_BUILD_DIR):
+        print(f"ERROR: Build directory not found at {MODULE_BUILD_DIR}")
+        _module_loaded = False
+        return
+
+    sys.path.insert(0, MODULE_BUILD_DIR)
+    print(f"Added '{MODULE_BUILD_DIR}' to sys.path.")
+
+    so_file_path = os.path.join(MODULE_BUILD_DIR, MODULE_FILENAME)
+    if not os.path.exists(so_file_path):
+        print(f"ERROR: Module file not found at {so_file_path}")
+        print("Please ensure you've built the module correctly and it's in the build directory.")
+        _module_loaded = False
+        return
+    else:
+        print(f"Module file found at {so_file_path}")
+    _startup_ms['path_setup_ms'] = (time.perf_counter() - phase_start) * 1e3
+
     # Try to import the module
     try:
         # The import name is just the module name, without .so or python tags
+        import_start = time.perf_counter()
         module = __import__(PYTHON_MODULE_NAME)
+        _startup_ms['import_ms'] = (time.perf_counter() - import_start) * 1e3
         globals()[PYTHON_MODULE_NAME] = module # Make it available like a normal import
         print(f"\nSuccessfully imported '{PYTHON_MODULE_NAME}' module.")
         _module_loaded = True
@@ -77,6 +85,7 @@ def setup_module_path_and_load():
         print(f"Ensure all dependencies like libusb-1.0.dylib are installed and accessible.")
         print(f"  (On macOS, try 'brew install libusb' and ensure it's linked).")
         print(f"Import error details: {e}")
+        _check_library_dependencies(so_file_path)
         _module_loaded = False
     except Exception as e:
         print(f"An unexpected error occurred during import: {e}")
@@ -99,11 +108,15 @@ def initialize_psu(device_index=0, max_v=30000.0, max_c=25, verb=False, max_in_v
             return False
             
         PSUClass = getattr(psu_module, CPP_CLASS_NAME_IN_PYTHON)
+        init_start = time.perf_counter()
         _psu_instance = PSUClass(device_index=device_index, max_voltage=max_v, max_current=max_c, verbose=verb, max_input_voltage=max_in_v)
+        _startup_ms['psu_init_ms'] = (time.perf_counter() - init_start) * 1e3
         print("PSU C++ object instance created successfully.")
         # The C++ constructor already tries to open the device.
         # A short delay might be good practice after initialization if the device needs it.
+        settle_start = time.perf_counter()
         time.sleep(0.1) # Small delay
+        _startup_ms['settle_ms'] = (time.perf_counter() - settle_start) * 1e3
         
         # You could add a check here if your C++ class had an `is_open()` or similar method
         # if not _psu_instance.is_connected(): # Fictional method
@@ -217,6 +230,19 @@ def cleanup_psu():
         print("PSU instance already None or not initialized.")
     return True
 
+def startup_report():
+    """
+    Returns where the startup time went, in ms: the Python phases (path_setup_ms,
+    import_ms, psu_init_ms, settle_ms) merged with the C++ breakdown of
+    heinzinger_control.startup_timings() (libusb context, bus scans, device
+    opens, first exchange) once the module is loaded.
+    """
+    report = dict(_startup_ms)
+    psu_module = globals().get(PYTHON_MODULE_NAME)
+    if psu_module is not None:
+        report.update(psu_module.startup_timings())
+    return report
+
 def get_psu_instance(device_index=0, verb=False):
     """
     Ensure the PSU is ready and return the singleton instance.
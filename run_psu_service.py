@@ -1,28 +1,35 @@
 #!/usr/bin/env python3 
-from flask import Flask, request, jsonify
+import json
+from flask import Flask, Response, request, jsonify, stream_with_context
 import run_psu                    #(imports heinzinger as well)
 
 psu = run_psu.get_psu_instance(device_index=0, verb=0)
 app = Flask(__name__)
 
+# Setpoints go through the C++ command queue: a burst of requests (e.g. from
+# a slider) is merged into one USB command instead of queueing up behind
+# each other, and every request answers with the command it went out with.
 @app.post("/set_voltage")
 def set_voltage():
     v = float(request.json["value"])
-    ok = psu.set_voltage(v)
+    ok = psu.submit(voltage=v).result().ok
     return jsonify({"ok": ok})
 
 @app.post("/set_current")
 def set_current():
     i = float(request.json["value"])
-    ok = psu.set_current(i)
+    ok = psu.submit(current=i).result().ok
     return jsonify({"ok": ok})
 
 @app.get("/read")
 def read():
+    snap = psu.read_snapshot()     # one USB round trip for all values
+    if not snap.ok:
+        return jsonify({"error": "PSU readout failed"}), 500
     return jsonify({
-        "voltage": psu.read_voltage(),
-        "current": psu.read_current(),
-        "on": False 
+        "voltage": snap.voltage,
+        "current": snap.current,
+        "on": snap.relay
     })
 
 @app.get("/relay")
@@ -60,6 +67,43 @@ def set_relay():
 
     return jsonify({"on": psu.is_relay_on()})   # echo current state
 
+@app.get("/stats")
+def stats():
+    """Query/USB counters and latency percentiles (us) for SLO monitoring."""
+    return jsonify(psu.stats())
+
+@app.get("/events")
+def events():
+    """
+    Server-sent events instead of polling /read and /relay: one "data:" line
+    per change of voltage/current (beyond the thresholds), relay or error
+    word, starting with the current state. Needs the acquisition thread,
+    which is started on first use.
+    """
+    if not psu.acquisition_running():
+        psu.start_acquisition(20.0)
+
+    def stream():
+        # The latest event first (the current state), then every newer one
+        since = max(psu.change_sequence() - 1, 0)
+        while True:
+            event = psu.wait_for_change(timeout=15.0, since=since)
+            if event is None:
+                yield ": keepalive\n\n"
+                continue
+            since = event.sequence
+            snap = event.snapshot
+            yield "data: " + json.dumps({
+                "seq": event.sequence,
+                "reasons": event.reasons,
+                "voltage": snap.voltage,
+                "current": snap.current,
+                "on": snap.relay,
+                "errors": snap.errors,
+            }) + "\n\n"
+
+    return Response(stream_with_context(stream()),
+                    mimetype="text/event-stream")
 
 
 if __name__ == "__main__":
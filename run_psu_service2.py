@@ -21,9 +21,12 @@ def set_current():
 
 @app.get("/read")
 def read():
+    snap = psu.read_snapshot()     # one USB round trip for both values
+    if not snap.ok:
+        return jsonify({"error": "PSU readout failed"}), 500
     return jsonify({
-        "voltage": psu.read_voltage(),
-        "current": psu.read_current()
+        "voltage": snap.voltage,
+        "current": snap.current
     })
 
 @app.post("/relay")
@@ -32,5 +35,11 @@ def relay():
     ok = psu.switch_on() if state else psu.switch_off()
     return jsonify({"ok": ok})
 
+@app.get("/stats")
+def stats():
+    """Query/USB counters and latency percentiles (us) for SLO monitoring."""
+    return jsonify(psu.stats())
+
+
 if __name__ == "__main__":
     app.run(host="0.0.0.0", port=5001, threaded=True)